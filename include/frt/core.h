@@ -15,6 +15,7 @@
 #include "./core/allocators.h"
 #include "./core/bit.h"
 #include "./core/bump_alloc.h"
+#include "./core/concurrent_bump_alloc.h"
 #include "./core/iterators.h"
 #include "./core/limits.h"
 #include "./core/memory.h"
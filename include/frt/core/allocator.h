@@ -10,12 +10,26 @@
 
 #pragma once
 
+#include "../runtime/assert.h"
 #include "../types/basic.h"
 #include "../types/concepts.h"
+#include "../types/move.h"
 #include "../types/traits.h"
+#include "./bit.h"
+#include "./limits.h"
+#include "./memory.h"
 #include "./pointers.h"
 
 namespace frt {
+  /// The result of `allocate_at_least`: the storage, and the number of objects it actually has space for.
+  ///
+  /// \tparam Pointer The pointer type of the allocator
+  /// \tparam SizeType The size type of the allocator
+  template <typename Pointer, typename SizeType> struct AllocationResult {
+    Pointer ptr;
+    SizeType count;
+  };
+
   namespace internal {
     template <typename A>
     concept HasValueType = requires {
@@ -82,9 +96,17 @@ namespace frt {
 
     template <HasValueType A> using AllocSize = typename AllocatorSizeType<A>::type;
 
-    template <typename T> struct FirstTemplateArg;
+    template <typename A, typename U>
+    concept HasMemberRebind = requires {
+      typename A::template rebind<U>::other;
+    };
+
+    // allocators that aren't templates over their value type (or have non-type template parameters, e.g. a size)
+    // can't be checked this way, and neither can ones that rebind themselves. they're trusted to get it right
+    template <typename A> struct FirstTemplateArg { using type = typename A::value_type; };
 
-    template <template <typename...> typename A, typename T, typename... Args> struct FirstTemplateArg<A<T, Args...>> {
+    template <template <typename...> typename A, typename T, typename... Args>
+    requires(!HasMemberRebind<A<T, Args...>, T>) struct FirstTemplateArg<A<T, Args...>> {
       using type = T;
     };
 
@@ -96,12 +118,21 @@ namespace frt {
     };
 
     template <typename U, template <typename, typename...> typename A, typename T, typename... Args>
-    struct AllocatorRebind<U, A<T, Args...>, void> {
+    requires(!HasMemberRebind<A<T, Args...>, U>) struct AllocatorRebind<U, A<T, Args...>, void> {
       using type = A<U, Args...>;
     };
 
     template <HasValueType A, typename U> using AllocRebind = typename AllocatorRebind<U, A>::type;
 
+    // builds the allocator for `U` that `alloc` rebinds to. whatever state `alloc` has (an arena, a
+    // stats block, etc.) has to carry over, so this refuses to compile rather than default-construct one
+    template <typename U, HasValueType A> [[nodiscard]] constexpr AllocRebind<A, U> rebind_allocator(A alloc) noexcept {
+      static_assert(traits::is_constructible<AllocRebind<A, U>, A&&>,
+          "allocator needs a constructor that rebinds it from another value type");
+
+      return AllocRebind<A, U>(frt::move(alloc));
+    }
+
     template <HasValueType A> using AllocValue = typename A::value_type;
 
     struct EmptyTestTypeT {};
@@ -134,6 +165,29 @@ namespace frt {
       { A::is_nothrow } -> SameAs<bool>;
     };
 
+    template <typename A>
+    concept HasAllocateAtLeast = requires(A a, AllocDiff<A> n) {
+      { a.allocate_at_least(n) } -> SameAs<AllocationResult<AllocPtr<A>, AllocDiff<A>>>;
+    };
+
+    template <typename A>
+    concept HasTryExpandInPlace = requires(A a, AllocPtr<A> p, AllocDiff<A> n) {
+      { a.try_expand_in_place(p, n, n) } -> SameAs<bool>;
+    };
+
+    template <typename A>
+    concept HasReallocate = requires(A a, AllocPtr<A> p, AllocDiff<A> n) {
+      { a.reallocate(p, n, n) } -> SameAs<AllocPtr<A>>;
+    };
+
+    template <typename A>
+    concept HasAllocateAligned = requires(A a, AllocPtr<A> p, AllocDiff<A> n, frt::usize align) {
+      { a.allocate_aligned(n, align) } -> SameAs<AllocPtr<A>>;
+      // clang-format off
+      { a.deallocate_aligned(p, n, align) } noexcept;
+      // clang-format on
+    };
+
     template <typename A> inline constexpr bool is_nothrow = noexcept(noexcept(traits::declval<A>().allocate(1)));
 
     template <HasNothrow A> inline constexpr bool is_nothrow<A> = A::is_nothrow;
@@ -146,11 +200,11 @@ namespace frt {
   /// to make this like stack allocators and have the container still be able to be
   /// moved around and whatnot.
   template <typename A>
-  concept Allocator = internal::HasValueType<A>                        //
-      && internal::AllocatorPointerOps<A>                              //
-      && internal::AllocatorStorage<A>                                 //
-      && Regular<A>                                                    //
-      && SameAs<typename A::value_type, internal::FirstTemplateArg<A>> //
+  concept Allocator = internal::HasValueType<A>                                       //
+      && internal::AllocatorPointerOps<A>                                             //
+      && internal::AllocatorStorage<A>                                                //
+      && Regular<A>                                                                   //
+      && SameAs<typename A::value_type, typename internal::FirstTemplateArg<A>::type> //
       && requires(A a, A a1, A a2) {
     typename internal::AllocPtr<A>;
     typename internal::AllocConstPtr<A>;
@@ -184,11 +238,166 @@ namespace frt {
       return alloc.allocate(n);
     }
 
-    static constexpr pointer deallocate(allocator_type& alloc, pointer storage, size_type n) noexcept {
-      return alloc.deallocate(storage, n);
+    static constexpr void deallocate(allocator_type& alloc, pointer storage, size_type n) noexcept {
+      alloc.deallocate(storage, n);
+    }
+
+    /// Allocates space for at least `n` objects. Allocators that round requests up (to a size class, a whole
+    /// block, etc.) can provide `allocate_at_least` to report how much space there really is, so that containers
+    /// can use the slack as extra capacity. Otherwise this is just `allocate(n)`.
+    ///
+    /// The block can be freed with any count between `n` and the count that was returned.
+    ///
+    /// \param alloc The allocator to allocate with
+    /// \param n The minimum number of objects to allocate space for
+    /// \return The storage and the number of objects it has space for, or `{nullptr, 0}` on failure
+    [[nodiscard]] static constexpr AllocationResult<pointer, size_type> allocate_at_least(allocator_type& alloc,
+        size_type n) noexcept {
+      if constexpr (internal::HasAllocateAtLeast<A>) {
+        return alloc.allocate_at_least(n);
+      } else {
+        pointer ptr = alloc.allocate(n);
+
+        return AllocationResult<pointer, size_type>{ptr, ptr == nullptr ? 0 : n};
+      }
+    }
+
+    /// Tries to grow (or shrink) a block without moving it, using the allocator's `try_expand_in_place` if
+    /// it has one. Allocators without one can't resize anything in-place, and this always fails.
+    ///
+    /// \param alloc The allocator that allocated `storage`
+    /// \param storage The block to resize
+    /// \param n The number of objects the block currently has space for
+    /// \param new_n The number of objects the block should have space for
+    /// \return Whether the block was resized. If this is `false`, nothing happened
+    [[nodiscard]] static constexpr bool try_expand_in_place(allocator_type& alloc,
+        pointer storage,
+        size_type n,
+        size_type new_n) noexcept {
+      if constexpr (internal::HasTryExpandInPlace<A>) {
+        return alloc.try_expand_in_place(storage, n, new_n);
+      } else {
+        return false;
+      }
+    }
+
+    /// Resizes a block, moving it if it has to. Uses the allocator's `reallocate` if it has one, otherwise
+    /// this tries `try_expand_in_place` and falls back to allocating a new block, copying and freeing the old one.
+    ///
+    /// Objects are moved bytewise, so this is only available for trivially copyable types. Anything else
+    /// needs to use `try_expand_in_place` and relocate objects itself when it fails.
+    ///
+    /// \param alloc The allocator that allocated `storage`
+    /// \param storage The block to resize
+    /// \param n The number of objects the block currently has space for
+    /// \param new_n The number of objects the block should have space for
+    /// \return The resized block, or `nullptr` if a new block couldn't be allocated (`storage` is still valid)
+    [[nodiscard]] static constexpr pointer reallocate(allocator_type& alloc,
+        pointer storage,
+        size_type n,
+        size_type new_n) noexcept requires TriviallyCopyable<value_type> {
+      if constexpr (internal::HasReallocate<A>) {
+        return alloc.reallocate(storage, n, new_n);
+      } else {
+        if (try_expand_in_place(alloc, storage, n, new_n)) {
+          return storage;
+        }
+
+        auto result = alloc.allocate(new_n);
+
+        if (result != nullptr) {
+          frt::mem_copy(frt::to_address(result),
+              frt::to_address(storage),
+              (n < new_n ? n : new_n) * static_cast<size_type>(sizeof(value_type)));
+          alloc.deallocate(storage, n);
+        }
+
+        return result;
+      }
+    }
+
+    /// Allocates space for `n` objects aligned to at least `align` bytes, e.g. a cache line for data that's
+    /// written from several cores or a page for a DMA buffer. Uses the allocator's `allocate_aligned` if it
+    /// has one. Otherwise this over-allocates, aligns the pointer inside the block and stashes the original
+    /// pointer right in front of it. Alignments no bigger than `alignof(value_type)` are just `allocate(n)`.
+    ///
+    /// The block must be freed with `deallocate_aligned`, with the same `n` and `align`.
+    ///
+    /// \param alloc The allocator to allocate with
+    /// \param n The number of objects to allocate space for
+    /// \param align The alignment of the storage, must be a power of two
+    /// \return The storage, or `nullptr` if the allocator couldn't provide it
+    [[nodiscard]] static pointer allocate_aligned(allocator_type& alloc, size_type n, frt::usize align) noexcept {
+      FRT_ASSERT(frt::has_single_bit(align), "alignment must be a power of two");
+
+      if constexpr (internal::HasAllocateAligned<A>) {
+        return alloc.allocate_aligned(n, align);
+      } else {
+        static_assert(SameAs<pointer, value_type*>, "aligned fallback requires an allocator using raw pointers");
+
+        if (align <= alignof(value_type)) {
+          return alloc.allocate(n);
+        }
+
+        // the padded count has to fit in `size_type`, anything bigger couldn't be allocated anyway
+        if (n > NumericLimits<size_type>::max - aligned_padding(align)) {
+          return nullptr;
+        }
+
+        auto* original = alloc.allocate(n + aligned_padding(align));
+
+        if (original == nullptr) {
+          return nullptr;
+        }
+
+        auto address = (reinterpret_cast<frt::usize>(original) + sizeof(void*) + (align - 1)) & ~(align - 1);
+        auto* storage = reinterpret_cast<value_type*>(address);
+
+        frt::mem_copy(reinterpret_cast<frt::ubyte*>(storage) - sizeof(void*),
+            &original,
+            static_cast<frt::isize>(sizeof(void*)));
+
+        return storage;
+      }
+    }
+
+    /// Frees a block from `allocate_aligned`
+    ///
+    /// \param alloc The allocator that allocated `storage`
+    /// \param storage The block to free, or `nullptr`
+    /// \param n The number of objects that was passed to `allocate_aligned`
+    /// \param align The alignment that was passed to `allocate_aligned`
+    static void deallocate_aligned(allocator_type& alloc, pointer storage, size_type n, frt::usize align) noexcept {
+      // `deallocate` doesn't have to accept `nullptr`, so it never gets one from here
+      if (storage == nullptr) {
+        return;
+      }
+
+      if constexpr (internal::HasAllocateAligned<A>) {
+        alloc.deallocate_aligned(storage, n, align);
+      } else {
+        if (align <= alignof(value_type)) {
+          alloc.deallocate(storage, n);
+        } else {
+          // `storage` only exists if `allocate_aligned` found that the padded count fits, so this can't overflow
+          value_type* original = nullptr;
+
+          frt::mem_copy(&original,
+              reinterpret_cast<frt::ubyte*>(storage) - sizeof(void*),
+              static_cast<frt::isize>(sizeof(void*)));
+          alloc.deallocate(original, n + aligned_padding(align));
+        }
+      }
     }
 
     inline static constexpr bool is_nothrow = internal::is_nothrow<A>;
+
+  private:
+    // the extra objects that the aligned fallback allocates: enough to hold the original pointer, and
+    // then slide the block forward by up to `align - 1` bytes to the next aligned address
+    [[nodiscard]] static constexpr size_type aligned_padding(frt::usize align) noexcept {
+      return static_cast<size_type>((sizeof(void*) + align - 1 + sizeof(value_type) - 1) / sizeof(value_type));
+    }
   };
 
 } // namespace frt
\ No newline at end of file
@@ -10,4 +10,14 @@
 
 #pragma once
 
+#include "./allocators/alloc_ref.h"
+#include "./allocators/buddy_allocator.h"
+#include "./allocators/caching_allocator.h"
+#include "./allocators/failing_allocator.h"
+#include "./allocators/instrumented_allocator.h"
+#include "./allocators/linux_page_source.h"
+#include "./allocators/page_source.h"
+#include "./allocators/pool_allocator.h"
+#include "./allocators/sampling_allocator.h"
+#include "./allocators/small_object_allocator.h"
 #include "./allocators/stack_allocator.h"
\ No newline at end of file
@@ -0,0 +1,269 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include "../../platform/macros.h"
+#include "../../runtime/assert.h"
+#include "../../types/basic.h"
+#include "../../types/concepts.h"
+#include "../../types/traits.h"
+#include "../allocator.h"
+#include "../limits.h"
+
+namespace frt {
+  namespace internal {
+    // memory resources that deal in raw bytes, e.g. `BumpAllocator`
+    template <typename R>
+    concept ByteResource = requires(R& resource, void* ptr, frt::usize size, frt::usize align) {
+      { resource.allocate(size, align) } -> SameAs<void*>;
+      // clang-format off
+      { resource.deallocate(ptr, size) } noexcept;
+      // clang-format on
+    };
+
+    // byte resources that need the alignment back when memory is freed, e.g. `SmallObjectHeap`
+    template <typename R>
+    concept AlignedByteResource = ByteResource<R> && requires(R& resource, void* ptr, frt::usize size) {
+      // clang-format off
+      { resource.deallocate(ptr, size, size) } noexcept;
+      // clang-format on
+    };
+
+    // byte resources that can report how much they really allocated, e.g. `SmallObjectHeap`
+    template <typename R>
+    concept SizedByteResource = ByteResource<R> && requires(R& resource, frt::usize size) {
+      { resource.allocate_at_least(size, size) } -> SameAs<AllocationResult<void*, frt::usize>>;
+    };
+
+    // byte resources that can resize blocks in-place, e.g. `BumpAllocator`
+    template <typename R>
+    concept ExpandableByteResource = ByteResource<R> && requires(R& resource, void* ptr, frt::usize size) {
+      { resource.try_expand_in_place(ptr, size, size) } -> SameAs<bool>;
+    };
+
+    // anything shaped like an allocator that uses raw pointers. it doesn't need to be copyable, e.g. `MagazineCache`
+    template <typename R>
+    concept RawPointerAllocator = HasValueType<R> && requires(R& alloc, typename R::value_type* ptr, frt::isize n) {
+      { alloc.allocate(n) } -> SameAs<typename R::value_type*>;
+      // clang-format off
+      { alloc.deallocate(ptr, n) } noexcept;
+      // clang-format on
+    };
+
+    template <typename R>
+    concept AllocRefTarget = ByteResource<R> || RawPointerAllocator<R>;
+
+    template <typename R> struct AllocRefValue { using type = frt::ubyte; };
+
+    template <HasValueType R> struct AllocRefValue<R> { using type = typename R::value_type; };
+  } // namespace internal
+
+  /// An allocator adapter that gives reference semantics to another allocator (or memory resource).
+  /// Every `AllocRef` to the same object shares that object's memory, so any number of containers
+  /// can allocate out of one arena.
+  ///
+  /// `R` can either be an allocator that uses raw pointers (it doesn't need to be copyable, so allocator-shaped
+  /// objects like `MagazineCache` work too), or a memory resource that deals in bytes
+  /// (anything with `void* allocate(usize size, usize align)` and `void deallocate(void*, usize)`, like
+  /// `BumpAllocator`). If the resource's `deallocate` also takes an alignment, `alignof(T)` is given to it.
+  ///
+  /// Rebinding an `AllocRef` keeps referring to the same `R`, allocations for types other
+  /// than `R::value_type` are carved out of however many `R::value_type`s they need.
+  ///
+  /// A default-constructed `AllocRef` doesn't refer to anything and can't be used to allocate.
+  ///
+  /// \tparam R The allocator or memory resource to refer to
+  /// \tparam T The type being allocated
+  template <internal::AllocRefTarget R, typename T = typename internal::AllocRefValue<R>::type> class AllocRef {
+  public:
+    using value_type = T;
+
+    template <typename U> struct rebind { using other = AllocRef<R, U>; };
+
+    explicit AllocRef() = default;
+
+    /// Creates an `AllocRef` that refers to `resource`. `resource` must outlive
+    /// the `AllocRef` and every copy of it.
+    ///
+    /// \param resource The allocator to refer to
+    explicit constexpr AllocRef(R& resource) noexcept : resource_{&resource} {}
+
+    /// Rebinds `other`, the new `AllocRef` refers to the same object
+    ///
+    /// \param other The `AllocRef` to rebind
+    template <typename U> explicit constexpr AllocRef(const AllocRef<R, U>& other) noexcept : resource_{other.get()} {}
+
+    /// Allocates space for `n` objects from the referred-to allocator
+    ///
+    /// \param n The number of objects to allocate space for
+    /// \return A pointer to the storage, or `nullptr` if `n` objects can't be represented in bytes
+    [[nodiscard]] T* allocate(frt::isize n) noexcept(noexcept(traits::declval<R&>().allocate(1))) {
+      FRT_ASSERT(resource_ != nullptr, "cannot allocate from a null `AllocRef`");
+
+      if constexpr (internal::ByteResource<R>) {
+        if (FRT_UNLIKELY(!in_range(n))) {
+          return nullptr;
+        }
+
+        return static_cast<T*>(resource_->allocate(static_cast<frt::usize>(n) * sizeof(T), alignof(T)));
+      } else if constexpr (SameAs<T, typename R::value_type>) {
+        return resource_->allocate(n);
+      } else {
+        if (FRT_UNLIKELY(!in_range(n))) {
+          return nullptr;
+        }
+
+        return reinterpret_cast<T*>(resource_->allocate(units(n)));
+      }
+    }
+
+    /// Frees a block allocated by any `AllocRef` that refers to the same object
+    ///
+    /// \param ptr The block to free
+    /// \param n The number of objects the block was allocated with
+    void deallocate(T* ptr, frt::isize n) noexcept {
+      if constexpr (internal::AlignedByteResource<R>) {
+        resource_->deallocate(ptr, static_cast<frt::usize>(n) * sizeof(T), alignof(T));
+      } else if constexpr (internal::ByteResource<R>) {
+        resource_->deallocate(ptr, static_cast<frt::usize>(n) * sizeof(T));
+      } else if constexpr (SameAs<T, typename R::value_type>) {
+        resource_->deallocate(ptr, n);
+      } else {
+        resource_->deallocate(reinterpret_cast<typename R::value_type*>(ptr), units(n));
+      }
+    }
+
+    /// Allocates space for at least `n` objects, reporting how many actually fit. Only available when
+    /// referring to a memory resource that provides `allocate_at_least`.
+    ///
+    /// \param n The minimum number of objects to allocate space for
+    /// \return The storage and the number of objects it has space for
+    [[nodiscard]] AllocationResult<T*, frt::isize> allocate_at_least(frt::isize n) noexcept(
+        noexcept(traits::declval<R&>().allocate(1))) requires internal::SizedByteResource<R> {
+      FRT_ASSERT(resource_ != nullptr, "cannot allocate from a null `AllocRef`");
+
+      if (FRT_UNLIKELY(!in_range(n))) {
+        return AllocationResult<T*, frt::isize>{nullptr, 0};
+      }
+
+      auto result = resource_->allocate_at_least(static_cast<frt::usize>(n) * sizeof(T), alignof(T));
+
+      return AllocationResult<T*, frt::isize>{static_cast<T*>(result.ptr),
+          static_cast<frt::isize>(result.count / sizeof(T))};
+    }
+
+    /// Tries to resize a block in-place, if the referred-to object knows how to do that
+    ///
+    /// \param ptr The block to resize
+    /// \param n The number of objects the block currently has space for
+    /// \param new_n The number of objects the block should have space for
+    /// \return Whether the block was resized. If this is `false`, nothing happened
+    [[nodiscard]] bool try_expand_in_place(T* ptr, frt::isize n, frt::isize new_n) noexcept
+        requires internal::ExpandableByteResource<R> || internal::HasTryExpandInPlace<R> {
+      if constexpr (internal::ExpandableByteResource<R>) {
+        if (FRT_UNLIKELY(!in_range(new_n))) {
+          return false;
+        }
+
+        return resource_->try_expand_in_place(ptr,
+            static_cast<frt::usize>(n) * sizeof(T),
+            static_cast<frt::usize>(new_n) * sizeof(T));
+      } else if constexpr (SameAs<T, typename R::value_type>) {
+        return resource_->try_expand_in_place(ptr, n, new_n);
+      } else {
+        return false;
+      }
+    }
+
+    /// Allocates space for `n` objects aligned to `align`. Only available when referring to a memory resource
+    /// (which is asked for the alignment directly) or an allocator with its own `allocate_aligned`,
+    /// anything else gets the generic fallback in `AllocatorTraits::allocate_aligned`.
+    ///
+    /// \param n The number of objects to allocate space for
+    /// \param align The alignment of the storage, must be a power of two
+    /// \return A pointer to the storage
+    [[nodiscard]] T* allocate_aligned(frt::isize n, frt::usize align) noexcept
+        requires internal::ByteResource<R> || internal::HasAllocateAligned<R> {
+      FRT_ASSERT(resource_ != nullptr, "cannot allocate from a null `AllocRef`");
+
+      if constexpr (internal::ByteResource<R>) {
+        if (FRT_UNLIKELY(!in_range(n))) {
+          return nullptr;
+        }
+
+        return static_cast<T*>(resource_->allocate(static_cast<frt::usize>(n) * sizeof(T), aligned(align)));
+      } else if constexpr (SameAs<T, typename R::value_type>) {
+        return resource_->allocate_aligned(n, align);
+      } else {
+        if (FRT_UNLIKELY(!in_range(n))) {
+          return nullptr;
+        }
+
+        return reinterpret_cast<T*>(resource_->allocate_aligned(units(n), aligned(align)));
+      }
+    }
+
+    /// Frees a block from `allocate_aligned`
+    ///
+    /// \param ptr The block to free
+    /// \param n The number of objects the block was allocated with
+    /// \param align The alignment the block was allocated with
+    void deallocate_aligned(T* ptr, frt::isize n, frt::usize align) noexcept
+        requires internal::ByteResource<R> || internal::HasAllocateAligned<R> {
+      if constexpr (internal::AlignedByteResource<R>) {
+        resource_->deallocate(ptr, static_cast<frt::usize>(n) * sizeof(T), aligned(align));
+      } else if constexpr (internal::ByteResource<R>) {
+        resource_->deallocate(ptr, static_cast<frt::usize>(n) * sizeof(T));
+      } else if constexpr (SameAs<T, typename R::value_type>) {
+        resource_->deallocate_aligned(ptr, n, align);
+      } else {
+        resource_->deallocate_aligned(reinterpret_cast<typename R::value_type*>(ptr), units(n), aligned(align));
+      }
+    }
+
+    /// Gets the object being referred to
+    ///
+    /// \return A pointer to the object, or `nullptr`
+    [[nodiscard]] constexpr R* get() const noexcept {
+      return resource_;
+    }
+
+    // two `AllocRef`s are equal if they refer to the same object, since then either can free the other's memory
+    [[nodiscard]] friend constexpr bool operator==(const AllocRef&, const AllocRef&) noexcept = default;
+
+  private:
+    // whether `n` objects can be allocated at all: the size in bytes has to fit in an `isize`, so that it
+    // (and the number of `R::value_type`s from `units`) doesn't wrap around to a small request
+    [[nodiscard]] FRT_ALWAYS_INLINE static constexpr bool in_range(frt::isize n) noexcept {
+      constexpr auto max = static_cast<frt::usize>(NumericLimits<frt::isize>::max) / sizeof(T);
+
+      return n >= 0 && static_cast<frt::usize>(n) <= max;
+    }
+
+    // the number of `R::value_type`s needed to hold `n` `T`s, `n` must be `in_range`
+    [[nodiscard]] static constexpr frt::isize units(frt::isize n) noexcept {
+      using V = typename R::value_type;
+
+      static_assert(alignof(T) <= alignof(V), "`R` cannot provide storage aligned enough for `T`");
+
+      auto bytes = static_cast<frt::usize>(n) * sizeof(T);
+
+      // rounds up without adding to `bytes`, so it can't overflow
+      return static_cast<frt::isize>(bytes / sizeof(V) + (bytes % sizeof(V) != 0 ? 1 : 0));
+    }
+
+    [[nodiscard]] FRT_ALWAYS_INLINE static constexpr frt::usize aligned(frt::usize align) noexcept {
+      return align < alignof(T) ? alignof(T) : align;
+    }
+
+    R* resource_ = nullptr;
+  };
+} // namespace frt
@@ -0,0 +1,305 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include "../../platform/macros.h"
+#include "../../runtime/assert.h"
+#include "../../types/basic.h"
+#include "../bit.h"
+
+namespace frt {
+  /// A binary buddy allocator that hands out power-of-two runs of pages from a caller-provided region.
+  ///
+  /// Every request is rounded up to `2^order` pages. Free blocks of each order are kept on their own
+  /// list, and a bitmap per order records which blocks are free so that a freed block can find out whether
+  /// its buddy is free (and merge with it) in O(1). Both operations are O(max order), and fragmentation is
+  /// bounded: a request never wastes more than half of the block it's given.
+  ///
+  /// The bitmaps are stored in the first pages of the region, so slightly less than the whole region
+  /// is available to allocate. The region must stay valid for the allocator's lifetime.
+  ///
+  /// This models `PageSource`, so it can back a `SmallObjectHeap` directly. Use `PageSourceRef` to share
+  /// one between several allocators.
+  ///
+  /// \tparam PageSize The size (and alignment) of a page, must be a power of two
+  /// \tparam MaxOrder The largest block is `2^MaxOrder` pages
+  template <frt::usize PageSize = 4096, frt::usize MaxOrder = 10> class BuddyAllocator {
+    static_assert(frt::has_single_bit(PageSize), "page size must be a power of two");
+    static_assert(MaxOrder < sizeof(frt::usize) * 8, "`MaxOrder` is too large to keep a bitmap of orders");
+
+    struct FreeBlock {
+      FreeBlock* next;
+      FreeBlock* prev;
+    };
+
+    static_assert(PageSize >= sizeof(FreeBlock), "pages need to be able to hold a free list node");
+
+    inline static constexpr frt::usize order_count = MaxOrder + 1;
+    inline static constexpr frt::usize word_bits = sizeof(frt::usize) * 8;
+
+  public:
+    /// The size (and alignment) of a page in bytes
+    inline static constexpr frt::usize page_size = PageSize;
+
+    /// The largest order that a block can have
+    inline static constexpr frt::usize max_order = MaxOrder;
+
+    /// The largest number of pages that can be allocated at once
+    inline static constexpr frt::usize max_pages = frt::usize{1} << MaxOrder;
+
+    /// Creates an allocator that doesn't manage any memory, every allocation fails
+    explicit BuddyAllocator() = default;
+
+    /// Creates an allocator managing `region`. If the region is too small to hold any pages
+    /// after the bitmaps, it acts like a default-constructed allocator.
+    ///
+    /// \param region The beginning of the region to manage
+    /// \param bytes The size of the region in bytes
+    explicit BuddyAllocator(void* region, frt::usize bytes) noexcept {
+      auto begin = reinterpret_cast<frt::usize>(region);
+      auto start = round_up(begin, page_size);
+
+      if (start < begin || begin + bytes < start) {
+        return;
+      }
+
+      auto total = (begin + bytes - start) / page_size;
+      auto words = bitmap_words(total);
+      auto meta_pages = round_up(words * sizeof(frt::usize), page_size) / page_size;
+
+      if (total <= meta_pages) {
+        return;
+      }
+
+      auto* bits = reinterpret_cast<frt::usize*>(start);
+
+      for (auto i = frt::usize{0}; i < words; ++i) {
+        bits[i] = 0;
+      }
+
+      for (auto order = frt::usize{0}; order < order_count; ++order) {
+        bitmaps_[order] = bits;
+        bits += ((total >> order) / word_bits) + 1;
+      }
+
+      base_ = reinterpret_cast<frt::ubyte*>(start + meta_pages * page_size);
+      pages_ = total - meta_pages;
+
+      // carve the region into the biggest blocks that are aligned (relative to `base_`) and fit
+      for (auto index = frt::usize{0}; index < pages_;) {
+        auto order = static_cast<frt::usize>(frt::countr_zero(index | max_pages));
+        auto fits = frt::bit_width(pages_ - index) - 1;
+
+        order = order < fits ? order : fits;
+        push(index, order);
+        index += frt::usize{1} << order;
+      }
+
+      free_pages_ = pages_;
+    }
+
+    BuddyAllocator(const BuddyAllocator&) = delete;
+
+    BuddyAllocator& operator=(const BuddyAllocator&) = delete;
+
+    // moving leaves `other` empty, it's the same state and the blocks don't point back at the allocator
+    BuddyAllocator(BuddyAllocator&& other) noexcept {
+      take(other);
+    }
+
+    BuddyAllocator& operator=(BuddyAllocator&& other) noexcept {
+      if (this != &other) {
+        take(other);
+      }
+
+      return *this;
+    }
+
+    ~BuddyAllocator() = default;
+
+    /// Allocates `2^order` contiguous pages, where `2^order` is the smallest power of two `>= count`
+    ///
+    /// \param count The number of pages needed
+    /// \return A pointer to the pages, or `nullptr` if there's no free block that big
+    [[nodiscard]] void* allocate_pages(frt::usize count) noexcept {
+      if (FRT_UNLIKELY(count > max_pages)) {
+        return nullptr;
+      }
+
+      auto order = order_for(count);
+      auto available = nonempty_ & ~((frt::usize{1} << order) - 1);
+
+      if (FRT_UNLIKELY(available == 0)) {
+        return nullptr;
+      }
+
+      auto found = static_cast<frt::usize>(frt::countr_zero(available));
+      auto index = index_of(heads_[found]);
+
+      remove(index, found);
+
+      // split down to the right size, the upper half of each split is a free buddy
+      while (found > order) {
+        --found;
+        push(index + (frt::usize{1} << found), found);
+      }
+
+      free_pages_ -= frt::usize{1} << order;
+
+      return block_at(index);
+    }
+
+    /// Frees pages from `allocate_pages`, merging the block with its buddy as long as the buddy is free
+    ///
+    /// \param pages The pages to free, or `nullptr`
+    /// \param count The count that was passed to `allocate_pages`
+    void deallocate_pages(void* pages, frt::usize count) noexcept {
+      if (pages == nullptr) {
+        return;
+      }
+
+      auto order = order_for(count);
+      auto index = index_of(pages);
+
+      FRT_ASSERT(index < pages_ && (index & ((frt::usize{1} << order) - 1)) == 0, "pages are not from this allocator");
+      FRT_ASSERT(!is_free(index, order), "double free of buddy block");
+
+      free_pages_ += frt::usize{1} << order;
+
+      while (order < max_order) {
+        auto buddy = index ^ (frt::usize{1} << order);
+
+        if (buddy + (frt::usize{1} << order) > pages_ || !is_free(buddy, order)) {
+          break;
+        }
+
+        remove(buddy, order);
+        index &= ~(frt::usize{1} << order);
+        ++order;
+      }
+
+      push(index, order);
+    }
+
+    /// Gets the order of the block that a request for `count` pages is given
+    ///
+    /// \param count The number of pages requested
+    /// \return The order of the block, the block is `2^order` pages
+    [[nodiscard]] static constexpr frt::usize order_for(frt::usize count) noexcept {
+      return static_cast<frt::usize>(frt::countr_zero(frt::bit_ceil(count)));
+    }
+
+    /// Gets the number of pages being managed, not counting the ones used for bitmaps
+    ///
+    /// \return The number of pages
+    [[nodiscard]] frt::usize page_count() const noexcept {
+      return pages_;
+    }
+
+    /// Gets the number of pages that aren't currently allocated
+    ///
+    /// \return The number of free pages
+    [[nodiscard]] frt::usize free_page_count() const noexcept {
+      return free_pages_;
+    }
+
+  private:
+    [[nodiscard]] FRT_ALWAYS_INLINE static constexpr frt::usize round_up(frt::usize value, frt::usize align) noexcept {
+      return (value + (align - 1)) & ~(align - 1);
+    }
+
+    // the total size of every order's bitmap, each has a bit for every block of that order
+    [[nodiscard]] static constexpr frt::usize bitmap_words(frt::usize pages) noexcept {
+      auto words = frt::usize{0};
+
+      for (auto order = frt::usize{0}; order < order_count; ++order) {
+        words += ((pages >> order) / word_bits) + 1;
+      }
+
+      return words;
+    }
+
+    [[nodiscard]] FRT_ALWAYS_INLINE FreeBlock* block_at(frt::usize index) const noexcept {
+      return reinterpret_cast<FreeBlock*>(base_ + index * page_size);
+    }
+
+    [[nodiscard]] FRT_ALWAYS_INLINE frt::usize index_of(void* pages) const noexcept {
+      return static_cast<frt::usize>(static_cast<frt::ubyte*>(pages) - base_) / page_size;
+    }
+
+    [[nodiscard]] FRT_ALWAYS_INLINE bool is_free(frt::usize index, frt::usize order) const noexcept {
+      auto bit = index >> order;
+
+      return (bitmaps_[order][bit / word_bits] & (frt::usize{1} << (bit % word_bits))) != 0;
+    }
+
+    FRT_ALWAYS_INLINE void flip(frt::usize index, frt::usize order) noexcept {
+      auto bit = index >> order;
+
+      bitmaps_[order][bit / word_bits] ^= frt::usize{1} << (bit % word_bits);
+    }
+
+    void push(frt::usize index, frt::usize order) noexcept {
+      auto* block = block_at(index);
+      auto* head = heads_[order];
+
+      block->next = head;
+      block->prev = nullptr;
+
+      if (head != nullptr) {
+        head->prev = block;
+      }
+
+      heads_[order] = block;
+      nonempty_ |= frt::usize{1} << order;
+      flip(index, order);
+    }
+
+    void remove(frt::usize index, frt::usize order) noexcept {
+      auto* block = block_at(index);
+
+      if (block->next != nullptr) {
+        block->next->prev = block->prev;
+      }
+
+      if (block->prev != nullptr) {
+        block->prev->next = block->next;
+      } else if ((heads_[order] = block->next) == nullptr) {
+        nonempty_ &= ~(frt::usize{1} << order);
+      }
+
+      flip(index, order);
+    }
+
+    void take(BuddyAllocator& other) noexcept {
+      for (auto order = frt::usize{0}; order < order_count; ++order) {
+        heads_[order] = other.heads_[order];
+        bitmaps_[order] = other.bitmaps_[order];
+      }
+
+      base_ = other.base_;
+      pages_ = other.pages_;
+      free_pages_ = other.free_pages_;
+      nonempty_ = other.nonempty_;
+      other.base_ = nullptr;
+      other.pages_ = 0;
+      other.free_pages_ = 0;
+      other.nonempty_ = 0;
+    }
+
+    FreeBlock* heads_[order_count] = {};         // NOLINT(modernize-avoid-c-arrays)
+    frt::usize* bitmaps_[order_count] = {};      // NOLINT(modernize-avoid-c-arrays)
+    frt::ubyte* base_ = nullptr;
+    frt::usize pages_ = 0;
+    frt::usize free_pages_ = 0;
+    frt::usize nonempty_ = 0;
+  };
+} // namespace frt
@@ -0,0 +1,471 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include "../../platform/macros.h"
+#include "../../runtime/assert.h"
+#include "../../sync/spin_mutex.h"
+#include "../../types/basic.h"
+#include "../../types/concepts.h"
+#include "../../types/move.h"
+#include "../../types/traits.h"
+#include "../../utility/construct.h"
+#include "../../utility/defer.h"
+#include "../allocator.h"
+#include "../bit.h"
+#include "./alloc_ref.h"
+
+namespace frt {
+  namespace internal {
+    // magazines hold blocks of 1, 2, 4, ..., 32 objects, anything bigger goes straight to the backing allocator
+    inline constexpr frt::isize caching_class_count = 6;
+
+    inline constexpr frt::isize caching_max_count = frt::isize{1} << (caching_class_count - 1);
+
+    [[nodiscard]] constexpr frt::isize caching_class(frt::isize n) noexcept {
+      return frt::countr_zero(frt::bit_ceil(static_cast<frt::usize>(n)));
+    }
+
+    // every `MagazineCache` is linked into its heap, so that a heap destroyed before its caches can still
+    // take back what they're holding. `detach` knows the cache's real type, since `MagazineSize` can vary
+    struct CacheLink {
+      CacheLink* previous = nullptr;
+      CacheLink* next = nullptr;
+      void (*detach)(CacheLink*) noexcept = nullptr;
+    };
+  } // namespace internal
+
+  template <Allocator A, frt::isize MagazineSize> class MagazineCache;
+
+  /// The shared half of a `CachingAllocator`: the backing allocator, and the lock that protects it.
+  ///
+  /// Everything that touches the backing allocator goes through the lock. The batch operations exist
+  /// so that a `MagazineCache` can refill or drain a whole magazine while only locking once.
+  ///
+  /// Destroying the heap flushes every cache still in front of it, nothing can be using those caches
+  /// at the time. After that they're empty and no longer refer to the heap.
+  ///
+  /// \tparam A The backing allocator, must use raw pointers
+  template <Allocator A> class CachingHeap {
+    static_assert(SameAs<internal::AllocPtr<A>, typename A::value_type*>, "backing allocator must use raw pointers");
+
+  public:
+    using value_type = typename A::value_type;
+
+    /// Creates a heap that uses `alloc` as the backing allocator
+    ///
+    /// \param alloc The backing allocator
+    explicit CachingHeap(A alloc = A{}) noexcept : alloc_{frt::move(alloc)} {}
+
+    CachingHeap(const CachingHeap&) = delete;
+
+    CachingHeap& operator=(const CachingHeap&) = delete;
+
+    ~CachingHeap() {
+      while (caches_ != nullptr) {
+        auto* link = caches_;
+
+        caches_ = link->next;
+        link->detach(link);
+      }
+    }
+
+    /// Allocates directly from the backing allocator
+    ///
+    /// \param n The number of objects to allocate space for
+    /// \return A pointer to the storage
+    [[nodiscard]] value_type* allocate(frt::isize n) noexcept(noexcept(traits::declval<A&>().allocate(1))) {
+      lock_.lock();
+      auto _ = frt::defer([this] { lock_.unlock(); });
+
+      return alloc_.allocate(n);
+    }
+
+    /// Frees a block directly to the backing allocator
+    ///
+    /// \param ptr The block to free
+    /// \param n The number of objects the block was allocated with
+    void deallocate(value_type* ptr, frt::isize n) noexcept {
+      lock_.lock();
+      alloc_.deallocate(ptr, n);
+      lock_.unlock();
+    }
+
+    /// Allocates up to `count` blocks of `n` objects each, only locking once
+    ///
+    /// \param blocks Where to put the blocks
+    /// \param count The number of blocks to allocate
+    /// \param n The number of objects in each block
+    /// \return The number of blocks allocated, less than `count` if the backing allocator ran out
+    [[nodiscard]] frt::isize allocate_batch(value_type** blocks, frt::isize count, frt::isize n) noexcept(
+        noexcept(traits::declval<A&>().allocate(1))) {
+      lock_.lock();
+      auto _ = frt::defer([this] { lock_.unlock(); });
+
+      for (auto i = frt::isize{0}; i < count; ++i) {
+        if ((blocks[i] = alloc_.allocate(n)) == nullptr) {
+          return i;
+        }
+      }
+
+      return count;
+    }
+
+    /// Frees `count` blocks of `n` objects each, only locking once
+    ///
+    /// \param blocks The blocks to free
+    /// \param count The number of blocks
+    /// \param n The number of objects in each block
+    void deallocate_batch(value_type* const* blocks, frt::isize count, frt::isize n) noexcept {
+      lock_.lock();
+
+      for (auto i = frt::isize{0}; i < count; ++i) {
+        alloc_.deallocate(blocks[i], n);
+      }
+
+      lock_.unlock();
+    }
+
+    /// Gets the backing allocator. Using it directly isn't synchronized with anything.
+    ///
+    /// \return The backing allocator
+    [[nodiscard]] A& backing() noexcept {
+      return alloc_;
+    }
+
+  private:
+    template <Allocator, frt::isize> friend class MagazineCache;
+
+    void attach(internal::CacheLink* link) noexcept {
+      lock_.lock();
+
+      link->next = caches_;
+
+      if (caches_ != nullptr) {
+        caches_->previous = link;
+      }
+
+      caches_ = link;
+      lock_.unlock();
+    }
+
+    void detach(internal::CacheLink* link) noexcept {
+      lock_.lock();
+
+      if (link->previous != nullptr) {
+        link->previous->next = link->next;
+      } else {
+        caches_ = link->next;
+      }
+
+      if (link->next != nullptr) {
+        link->next->previous = link->previous;
+      }
+
+      lock_.unlock();
+    }
+
+    frt::SpinMutex lock_;
+    A alloc_;
+    internal::CacheLink* caches_ = nullptr;
+  };
+
+  /// A cache of recently freed blocks in front of a `CachingHeap`, meant to be owned by a single
+  /// thread (or CPU). In hosted code that means a `thread_local` one per thread (see `ThreadLocalCache`),
+  /// in a kernel it means one in each CPU's per-CPU data that's only used with preemption disabled.
+  ///
+  /// Blocks of up to 32 objects are rounded up to a power of two, and each of those size classes has
+  /// a magazine of free blocks. Allocating pops from the magazine and freeing pushes to it, neither
+  /// touches the shared heap unless the magazine is empty (refilled with half a magazine of blocks) or
+  /// full (half of it is given back). Either way the lock is taken once for the whole batch.
+  ///
+  /// Memory can be freed through a different cache than it was allocated from, it just ends up in
+  /// that cache's magazine instead. Everything cached is given back when the cache is destroyed.
+  ///
+  /// \tparam A The backing allocator of the heap
+  /// \tparam MagazineSize The number of blocks each magazine can hold
+  template <Allocator A, frt::isize MagazineSize = 32> class MagazineCache : private internal::CacheLink {
+    static_assert(MagazineSize >= 2 && MagazineSize % 2 == 0, "magazines need to be able to be split in half");
+
+    using T = typename A::value_type;
+
+    struct Magazine {
+      T* rounds[MagazineSize]; // NOLINT(modernize-avoid-c-arrays)
+      frt::isize count = 0;
+    };
+
+  public:
+    using value_type = T;
+
+    /// Creates an empty cache in front of `heap`
+    ///
+    /// \param heap The shared heap to refill from
+    explicit MagazineCache(CachingHeap<A>& heap) noexcept
+        : internal::CacheLink{nullptr, nullptr, heap_destroyed},
+          heap_{&heap} {
+      heap_->attach(this);
+    }
+
+    MagazineCache(const MagazineCache&) = delete;
+
+    MagazineCache& operator=(const MagazineCache&) = delete;
+
+    ~MagazineCache() {
+      if (heap_ != nullptr) {
+        flush();
+        heap_->detach(this);
+      }
+    }
+
+    /// Allocates space for `n` objects, from a magazine if possible
+    ///
+    /// \param n The number of objects to allocate space for
+    /// \return A pointer to the storage
+    [[nodiscard]] FRT_ALWAYS_INLINE T* allocate(frt::isize n) noexcept(noexcept(traits::declval<A&>().allocate(1))) {
+      if (FRT_UNLIKELY(n > internal::caching_max_count)) {
+        return heap_->allocate(n);
+      }
+
+      auto index = internal::caching_class(n);
+      auto& magazine = magazines_[index];
+
+      if (FRT_UNLIKELY(magazine.count == 0)) {
+        return refill(index);
+      }
+
+      return magazine.rounds[--magazine.count];
+    }
+
+    /// Frees space for `n` objects into a magazine, allocated through any cache in front of the same heap
+    ///
+    /// \param ptr The block to free
+    /// \param n The number of objects the block was allocated with
+    FRT_ALWAYS_INLINE void deallocate(T* ptr, frt::isize n) noexcept {
+      if (FRT_UNLIKELY(n > internal::caching_max_count)) {
+        heap_->deallocate(ptr, n);
+
+        return;
+      }
+
+      auto index = internal::caching_class(n);
+      auto& magazine = magazines_[index];
+
+      if (FRT_UNLIKELY(magazine.count == MagazineSize)) {
+        spill(index);
+      }
+
+      magazine.rounds[magazine.count++] = ptr;
+    }
+
+    /// Gives every cached block back to the heap
+    void flush() noexcept {
+      for (auto index = frt::isize{0}; index < internal::caching_class_count; ++index) {
+        auto& magazine = magazines_[index];
+
+        if (magazine.count != 0) {
+          heap_->deallocate_batch(magazine.rounds, magazine.count, frt::isize{1} << index);
+          magazine.count = 0;
+        }
+      }
+    }
+
+    /// Gets the heap that the cache is in front of
+    ///
+    /// \return The heap
+    [[nodiscard]] CachingHeap<A>& heap() const noexcept {
+      return *heap_;
+    }
+
+    /// Checks if the cache is in front of `heap`. This is `false` for every heap once the cache's
+    /// heap has been destroyed.
+    ///
+    /// \param heap The heap to check
+    /// \return Whether the cache refills from (and drains to) `heap`
+    [[nodiscard]] bool is_in_front_of(const CachingHeap<A>& heap) const noexcept {
+      return heap_ == &heap;
+    }
+
+  private:
+    // called by a heap being destroyed, which has already unlinked the cache
+    static void heap_destroyed(internal::CacheLink* link) noexcept {
+      auto* cache = static_cast<MagazineCache*>(link);
+
+      cache->flush();
+      cache->heap_ = nullptr;
+    }
+
+    FRT_COLD T* refill(frt::isize index) noexcept(noexcept(traits::declval<A&>().allocate(1))) {
+      auto& magazine = magazines_[index];
+
+      magazine.count = heap_->allocate_batch(magazine.rounds, MagazineSize / 2, frt::isize{1} << index);
+
+      return magazine.count == 0 ? nullptr : magazine.rounds[--magazine.count];
+    }
+
+    // gives back the older half, the most recently freed blocks are the ones most likely to still be in cache
+    FRT_COLD void spill(frt::isize index) noexcept {
+      auto& magazine = magazines_[index];
+      constexpr auto half = MagazineSize / 2;
+
+      heap_->deallocate_batch(magazine.rounds, half, frt::isize{1} << index);
+
+      for (auto i = frt::isize{0}; i < half; ++i) {
+        magazine.rounds[i] = magazine.rounds[i + half];
+      }
+
+      magazine.count = half;
+    }
+
+    CachingHeap<A>* heap_;
+    Magazine magazines_[internal::caching_class_count] = {}; // NOLINT(modernize-avoid-c-arrays)
+  };
+
+  /// A policy for finding the calling thread's (or CPU's) cache in front of a heap. `L::current(heap)`
+  /// has to return a cache in front of `heap` that nothing else can be using until the caller is done with it.
+  template <typename L, typename A, frt::isize MagazineSize>
+  concept CacheLookup = Allocator<A> && requires(CachingHeap<A>& heap) {
+    { L::current(heap) } noexcept -> SameAs<MagazineCache<A, MagazineSize>&>;
+  };
+
+#if __STDC_HOSTED__
+  /// The default `CacheLookup` in hosted code, which gives each thread its own `thread_local` cache.
+  ///
+  /// A thread has one cache for each `A` and `MagazineSize`. If it uses a different heap than last time,
+  /// the old cache is flushed and a new one is put in front of the new heap. The cache is flushed
+  /// when the thread exits, so heaps need to outlive the threads using them (or be destroyed
+  /// after those threads are done, in which case the heap takes the blocks back itself).
+  ///
+  /// \tparam A The backing allocator
+  /// \tparam MagazineSize The number of blocks each magazine can hold
+  template <Allocator A, frt::isize MagazineSize = 32> class ThreadLocalCache {
+    using Cache = MagazineCache<A, MagazineSize>;
+
+    struct Slot {
+      Slot() noexcept {} // NOLINT(modernize-use-equals-default)
+
+      Slot(const Slot&) = delete;
+
+      Slot& operator=(const Slot&) = delete;
+
+      ~Slot() {
+        if (engaged) {
+          cache.~Cache();
+        }
+      }
+
+      union {
+        Cache cache;
+      };
+
+      bool engaged = false;
+    };
+
+  public:
+    /// Gets the calling thread's cache in front of `heap`
+    ///
+    /// \param heap The heap to get a cache in front of
+    /// \return The cache
+    [[nodiscard]] static Cache& current(CachingHeap<A>& heap) noexcept {
+      thread_local Slot slot;
+
+      if (FRT_UNLIKELY(!slot.engaged || !slot.cache.is_in_front_of(heap))) {
+        rebind(slot, heap);
+      }
+
+      return slot.cache;
+    }
+
+  private:
+    FRT_COLD static void rebind(Slot& slot, CachingHeap<A>& heap) noexcept {
+      if (slot.engaged) {
+        slot.cache.~Cache();
+      }
+
+      frt::construct_at(&slot.cache, heap);
+      slot.engaged = true;
+    }
+  };
+#endif
+
+  /// An `Allocator` that allocates through whichever `MagazineCache` in front of a heap belongs to the
+  /// calling thread (or CPU), as found by `Lookup`. Every copy refers to the same heap, and memory
+  /// can be freed on a different thread than it was allocated on.
+  ///
+  /// In hosted code `Lookup` defaults to `ThreadLocalCache`, kernels provide their own that
+  /// looks in per-CPU data.
+  ///
+  /// \tparam A The backing allocator
+  /// \tparam MagazineSize The number of blocks each magazine can hold
+  /// \tparam Lookup The way to find the calling thread's cache
+  /// \tparam T The type being allocated
+  template <Allocator A,
+      frt::isize MagazineSize = 32,
+#if __STDC_HOSTED__
+      CacheLookup<A, MagazineSize> Lookup = ThreadLocalCache<A, MagazineSize>,
+#else
+      CacheLookup<A, MagazineSize> Lookup,
+#endif
+      typename T = typename A::value_type>
+  class CachingAllocator {
+    using Cache = MagazineCache<A, MagazineSize>;
+    using Ref = AllocRef<Cache, T>;
+
+  public:
+    using value_type = T;
+
+    template <typename U> struct rebind { using other = CachingAllocator<A, MagazineSize, Lookup, U>; };
+
+    explicit CachingAllocator() = default;
+
+    /// Creates an allocator that allocates from `heap`, which must outlive it and every copy of it
+    ///
+    /// \param heap The heap to allocate from
+    explicit constexpr CachingAllocator(CachingHeap<A>& heap) noexcept : heap_{&heap} {}
+
+    /// Rebinds `other`, the new allocator uses the same heap
+    ///
+    /// \param other The allocator to rebind
+    template <typename U>
+    explicit constexpr CachingAllocator(const CachingAllocator<A, MagazineSize, Lookup, U>& other) noexcept
+        : heap_{other.heap()} {}
+
+    /// Allocates space for `n` objects through the calling thread's cache
+    ///
+    /// \param n The number of objects to allocate space for
+    /// \return A pointer to the storage
+    [[nodiscard]] FRT_ALWAYS_INLINE T* allocate(frt::isize n) noexcept(noexcept(traits::declval<Ref&>().allocate(1))) {
+      FRT_ASSERT(heap_ != nullptr, "cannot allocate from a null `CachingAllocator`");
+
+      return Ref{Lookup::current(*heap_)}.allocate(n);
+    }
+
+    /// Frees a block into the calling thread's cache, it can come from any allocator using the same heap
+    ///
+    /// \param ptr The block to free
+    /// \param n The number of objects the block was allocated with
+    FRT_ALWAYS_INLINE void deallocate(T* ptr, frt::isize n) noexcept {
+      Ref{Lookup::current(*heap_)}.deallocate(ptr, n);
+    }
+
+    /// Gets the heap being allocated from
+    ///
+    /// \return A pointer to the heap, or `nullptr`
+    [[nodiscard]] constexpr CachingHeap<A>* heap() const noexcept {
+      return heap_;
+    }
+
+    // blocks can be freed through any cache in front of the same heap
+    [[nodiscard]] friend constexpr bool operator==(const CachingAllocator&, const CachingAllocator&) noexcept = default;
+
+  private:
+    CachingHeap<A>* heap_ = nullptr;
+  };
+} // namespace frt
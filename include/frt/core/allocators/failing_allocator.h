@@ -0,0 +1,39 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include "../../runtime/failures.h"
+#include "../../types/basic.h"
+#include "../allocator.h"
+
+namespace frt {
+  /// An allocator that never successfully allocates, every call to `allocate` ends in `frt::tried_alloc`.
+  ///
+  /// This is meant as the fallback for allocators with a fixed amount of memory, for when running out
+  /// of memory is a bug rather than something to recover from.
+  template <typename T> class FailingAllocator {
+  public:
+    using value_type = T;
+
+    explicit FailingAllocator() = default;
+
+    template <typename U> explicit constexpr FailingAllocator(const FailingAllocator<U>& /*unused*/) noexcept {}
+
+    [[noreturn]] T* allocate(frt::isize /*unused*/) noexcept {
+      frt::tried_alloc("fixed-size allocator was exhausted");
+    }
+
+    // nothing is ever allocated, so there's never anything to deallocate
+    constexpr void deallocate(T* /*unused*/, frt::isize /*unused*/) noexcept {}
+
+    friend constexpr bool operator==(const FailingAllocator&, const FailingAllocator&) noexcept = default;
+  };
+} // namespace frt
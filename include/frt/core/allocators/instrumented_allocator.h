@@ -0,0 +1,277 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include "../../collections/array.h"
+#include "../../platform/cpu.h"
+#include "../../platform/macros.h"
+#include "../../runtime/assert.h"
+#include "../../sync/atomic.h"
+#include "../../types/basic.h"
+#include "../../types/concepts.h"
+#include "../../types/move.h"
+#include "../../types/traits.h"
+#include "../allocator.h"
+#include "../bit.h"
+
+namespace frt {
+  /// A point-in-time copy of an `AllocationStats`.
+  struct AllocationSnapshot {
+    /// Bucket `i` counts requests of `(2^(i - 1), 2^i]` bytes, the last bucket also counts everything bigger
+    inline static constexpr frt::usize size_buckets = 32;
+
+    /// Bucket `i` counts allocations that took `[2^(i - 1), 2^i)` cycles, the last bucket also counts anything slower
+    inline static constexpr frt::usize latency_buckets = 24;
+
+    frt::usize allocations = 0;
+    frt::usize deallocations = 0;
+    frt::usize failed_allocations = 0;
+    frt::usize live_bytes = 0;
+    frt::usize peak_bytes = 0;
+    frt::usize total_bytes = 0;
+    frt::u64 allocation_cycles = 0;
+    frt::Array<frt::usize, size_buckets> sizes = {};
+    frt::Array<frt::usize, latency_buckets> latencies = {};
+  };
+
+  /// Statistics collected by any number of `InstrumentedAllocator`s.
+  ///
+  /// Every counter is updated with relaxed atomics, so recording is cheap and safe from any thread. The flip
+  /// side is that a snapshot taken while other threads are allocating isn't a consistent cut, e.g. the
+  /// histograms might not add up to exactly `allocations`.
+  class AllocationStats {
+  public:
+    explicit AllocationStats() noexcept = default;
+
+    AllocationStats(const AllocationStats&) = delete;
+
+    AllocationStats& operator=(const AllocationStats&) = delete;
+
+    ~AllocationStats() = default;
+
+    /// Records an allocation
+    ///
+    /// \param bytes The size of the allocation
+    /// \param cycles How long the allocation took, see `frt::cycle_count`
+    FRT_ALWAYS_INLINE void record_allocate(frt::usize bytes, frt::u64 cycles) noexcept {
+      allocations_.fetch_add(1, frt::memory_order_relaxed);
+      total_bytes_.fetch_add(bytes, frt::memory_order_relaxed);
+      allocation_cycles_.fetch_add(cycles, frt::memory_order_relaxed);
+      sizes_[size_bucket(bytes)].fetch_add(1, frt::memory_order_relaxed);
+      latencies_[latency_bucket(cycles)].fetch_add(1, frt::memory_order_relaxed);
+
+      auto live = live_bytes_.add_fetch(bytes, frt::memory_order_relaxed);
+      auto peak = peak_bytes_.load(frt::memory_order_relaxed);
+
+      while (live > peak && !peak_bytes_.compare_exchange_weak(peak, live, frt::memory_order_relaxed)) {
+      }
+    }
+
+    /// Records an allocation that the inner allocator failed, it isn't counted in any other statistic
+    FRT_ALWAYS_INLINE void record_failure() noexcept {
+      failed_allocations_.fetch_add(1, frt::memory_order_relaxed);
+    }
+
+    /// Records a deallocation
+    ///
+    /// \param bytes The size of the allocation being freed
+    FRT_ALWAYS_INLINE void record_deallocate(frt::usize bytes) noexcept {
+      deallocations_.fetch_add(1, frt::memory_order_relaxed);
+      live_bytes_.fetch_sub(bytes, frt::memory_order_relaxed);
+    }
+
+    /// Copies every counter
+    ///
+    /// \return The current values of the counters
+    [[nodiscard]] AllocationSnapshot snapshot() const noexcept {
+      auto result = AllocationSnapshot{};
+
+      result.allocations = allocations_.load(frt::memory_order_relaxed);
+      result.deallocations = deallocations_.load(frt::memory_order_relaxed);
+      result.failed_allocations = failed_allocations_.load(frt::memory_order_relaxed);
+      result.live_bytes = live_bytes_.load(frt::memory_order_relaxed);
+      result.peak_bytes = peak_bytes_.load(frt::memory_order_relaxed);
+      result.total_bytes = total_bytes_.load(frt::memory_order_relaxed);
+      result.allocation_cycles = allocation_cycles_.load(frt::memory_order_relaxed);
+
+      for (auto i = frt::usize{0}; i < AllocationSnapshot::size_buckets; ++i) {
+        result.sizes[i] = sizes_[i].load(frt::memory_order_relaxed);
+      }
+
+      for (auto i = frt::usize{0}; i < AllocationSnapshot::latency_buckets; ++i) {
+        result.latencies[i] = latencies_[i].load(frt::memory_order_relaxed);
+      }
+
+      return result;
+    }
+
+    /// Gets the histogram bucket that a request of `bytes` bytes is counted in
+    ///
+    /// \param bytes The size of the request
+    /// \return The index into `AllocationSnapshot::sizes`
+    [[nodiscard]] FRT_ALWAYS_INLINE static constexpr frt::usize size_bucket(frt::usize bytes) noexcept {
+      auto bucket = bytes <= 1 ? 0 : frt::bit_width(bytes - 1);
+
+      return bucket < AllocationSnapshot::size_buckets ? bucket : AllocationSnapshot::size_buckets - 1;
+    }
+
+    /// Gets the histogram bucket that an allocation taking `cycles` cycles is counted in
+    ///
+    /// \param cycles The number of cycles
+    /// \return The index into `AllocationSnapshot::latencies`
+    [[nodiscard]] FRT_ALWAYS_INLINE static constexpr frt::usize latency_bucket(frt::u64 cycles) noexcept {
+      auto bucket = static_cast<frt::usize>(frt::bit_width(cycles));
+
+      return bucket < AllocationSnapshot::latency_buckets ? bucket : AllocationSnapshot::latency_buckets - 1;
+    }
+
+  private:
+    frt::Atomic<frt::usize> allocations_;
+    frt::Atomic<frt::usize> deallocations_;
+    frt::Atomic<frt::usize> failed_allocations_;
+    frt::Atomic<frt::usize> live_bytes_;
+    frt::Atomic<frt::usize> peak_bytes_;
+    frt::Atomic<frt::usize> total_bytes_;
+    frt::Atomic<frt::u64> allocation_cycles_;
+    frt::Atomic<frt::usize> sizes_[AllocationSnapshot::size_buckets];         // NOLINT(modernize-avoid-c-arrays)
+    frt::Atomic<frt::usize> latencies_[AllocationSnapshot::latency_buckets]; // NOLINT(modernize-avoid-c-arrays)
+  };
+
+  /// An allocator adapter that records statistics about everything allocated through it into an
+  /// `AllocationStats`, while forwarding the actual work to another allocator.
+  ///
+  /// Copies (and rebinds) record into the same `AllocationStats`, so one object can collect
+  /// statistics for every container of a subsystem. The cost is a handful of relaxed atomic adds
+  /// and two reads of the cycle counter per allocation.
+  ///
+  /// \tparam A The allocator to forward to
+  template <Allocator A> class InstrumentedAllocator {
+    static_assert(SameAs<internal::AllocPtr<A>, typename A::value_type*>, "inner allocator must use raw pointers");
+
+  public:
+    using value_type = typename A::value_type;
+
+    template <typename U> struct rebind { using other = InstrumentedAllocator<internal::AllocRebind<A, U>>; };
+
+    explicit InstrumentedAllocator() = default;
+
+    /// Creates an allocator that records into `stats`. `stats` must outlive the allocator and every copy of it.
+    ///
+    /// \param stats Where to record statistics
+    /// \param alloc The allocator to forward to
+    explicit InstrumentedAllocator(AllocationStats& stats, A alloc = A{}) noexcept
+        : alloc_{frt::move(alloc)},
+          stats_{&stats} {}
+
+    /// Rebinds `other`, the new allocator records into the same statistics
+    ///
+    /// \param other The allocator to rebind
+    template <typename U>
+    requires traits::is_constructible<A, const U&>
+    explicit InstrumentedAllocator(const InstrumentedAllocator<U>& other) noexcept
+        : alloc_{other.inner()},
+          stats_{other.stats()} {}
+
+    /// Allocates space for `n` objects, recording how big it was and how long it took
+    ///
+    /// \param n The number of objects to allocate space for
+    /// \return A pointer to the storage, failures are only counted in `failed_allocations`
+    [[nodiscard]] value_type* allocate(frt::isize n) noexcept(noexcept(traits::declval<A&>().allocate(1))) {
+      FRT_ASSERT(stats_ != nullptr, "cannot allocate from a default-constructed `InstrumentedAllocator`");
+
+      auto start = frt::cycle_count();
+      auto ptr = alloc_.allocate(n);
+
+      record(ptr, n, start);
+
+      return ptr;
+    }
+
+    /// Frees space for `n` objects
+    ///
+    /// \param ptr The block to free, or `nullptr`
+    /// \param n The number of objects the block was allocated with
+    void deallocate(value_type* ptr, frt::isize n) noexcept {
+      FRT_ASSERT(stats_ != nullptr, "cannot deallocate with a default-constructed `InstrumentedAllocator`");
+
+      if (ptr == nullptr) {
+        return;
+      }
+
+      alloc_.deallocate(ptr, n);
+      stats_->record_deallocate(bytes(n));
+    }
+
+    /// Allocates space for `n` objects aligned to `align`, recording it like any other allocation
+    ///
+    /// \param n The number of objects to allocate space for
+    /// \param align The alignment of the storage, must be a power of two
+    /// \return A pointer to the storage
+    [[nodiscard]] value_type* allocate_aligned(frt::isize n, frt::usize align) noexcept {
+      FRT_ASSERT(stats_ != nullptr, "cannot allocate from a default-constructed `InstrumentedAllocator`");
+
+      auto start = frt::cycle_count();
+      auto ptr = AllocatorTraits<A>::allocate_aligned(alloc_, n, align);
+
+      record(ptr, n, start);
+
+      return ptr;
+    }
+
+    /// Frees a block from `allocate_aligned`
+    ///
+    /// \param ptr The block to free, or `nullptr`
+    /// \param n The number of objects the block was allocated with
+    /// \param align The alignment the block was allocated with
+    void deallocate_aligned(value_type* ptr, frt::isize n, frt::usize align) noexcept {
+      FRT_ASSERT(stats_ != nullptr, "cannot deallocate with a default-constructed `InstrumentedAllocator`");
+
+      if (ptr == nullptr) {
+        return;
+      }
+
+      AllocatorTraits<A>::deallocate_aligned(alloc_, ptr, n, align);
+      stats_->record_deallocate(bytes(n));
+    }
+
+    /// Gets the allocator being forwarded to
+    ///
+    /// \return The inner allocator
+    [[nodiscard]] const A& inner() const noexcept {
+      return alloc_;
+    }
+
+    /// Gets the statistics being recorded into
+    ///
+    /// \return The statistics, or `nullptr` if default-constructed
+    [[nodiscard]] AllocationStats* stats() const noexcept {
+      return stats_;
+    }
+
+    [[nodiscard]] friend bool operator==(const InstrumentedAllocator&, const InstrumentedAllocator&) noexcept = default;
+
+  private:
+    FRT_ALWAYS_INLINE void record(value_type* ptr, frt::isize n, frt::u64 start) noexcept {
+      if (ptr != nullptr) {
+        stats_->record_allocate(bytes(n), frt::cycle_count() - start);
+      } else {
+        stats_->record_failure();
+      }
+    }
+
+    [[nodiscard]] FRT_ALWAYS_INLINE static constexpr frt::usize bytes(frt::isize n) noexcept {
+      return static_cast<frt::usize>(n) * sizeof(value_type);
+    }
+
+    A alloc_;
+    AllocationStats* stats_ = nullptr;
+  };
+} // namespace frt
@@ -0,0 +1,123 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include "../../platform/architecture.h"
+#include "../../platform/macros.h"
+#include "../../runtime/assert.h"
+#include "../../types/basic.h"
+#include "../bit.h"
+
+#if defined(FRT_OS_LINUX)
+
+namespace frt {
+  /// How a `LinuxPageSource` asks the kernel for huge pages
+  enum class LinuxHugePages : int {
+    none,        // ordinary 4KiB pages
+    transparent, // `MADV_HUGEPAGE`, the kernel backs the mapping with 2MiB pages whenever it can
+    explicit_2m, // `MAP_HUGETLB`, 2MiB pages out of the pool reserved through `/proc/sys/vm/nr_hugepages`
+  };
+
+  /// How `LinuxPageSource::release_pages` gives idle pages back to the kernel
+  enum class LinuxPageRelease : int {
+    dont_need, // `MADV_DONTNEED`, the memory is freed immediately and reads back as zeroes
+    free,      // `MADV_FREE`, the memory is only reclaimed under memory pressure, cheaper if it's reused soon
+  };
+
+  /// Options for a `LinuxPageSource`
+  struct LinuxPageOptions {
+    LinuxHugePages huge_pages = LinuxHugePages::none;
+    LinuxPageRelease release = LinuxPageRelease::dont_need;
+    bool populate = false;     // fault every page in when it's mapped (`MAP_POPULATE`) instead of on first touch
+    bool huge_fallback = true; // use transparent huge pages when the hugetlb pool can't satisfy a mapping
+  };
+
+  namespace internal {
+    // `bytes` must be a multiple of 4KiB (or 2MiB for hugetlb), `align` must be a power of two
+    [[nodiscard]] void* linux_map_pages(frt::usize bytes, frt::usize align, LinuxPageOptions options) noexcept;
+
+    void linux_unmap_pages(void* pages, frt::usize bytes) noexcept;
+
+    void linux_release_pages(void* pages, frt::usize bytes, LinuxPageRelease release) noexcept;
+  } // namespace internal
+
+  /// A `PageSource` that maps pages straight from the Linux kernel with raw `mmap`, `munmap` and
+  /// `madvise` system calls, so it works without a libc.
+  ///
+  /// Every `allocate_pages` is its own mapping, so this is meant to sit under something that carves
+  /// big runs of pages up (a `BuddyAllocator` region, `SmallObjectHeap` slabs, `BumpAllocator` chunks)
+  /// rather than being called for every object. With a 2MiB `PageSize` and huge pages, each of those
+  /// pages needs a single TLB entry instead of 512 of them.
+  ///
+  /// Explicit huge pages come from a pool that has to be reserved ahead of time. If the pool is empty,
+  /// the mapping falls back to transparent huge pages unless `huge_fallback` is turned off. A `PageSize`
+  /// bigger than 2MiB is still made of 2MiB huge pages, mappings are just trimmed to the bigger alignment.
+  ///
+  /// \tparam PageSize The size (and alignment) of a page, a power of two that's at least 4KiB
+  template <frt::usize PageSize = 4096> class LinuxPageSource {
+    static_assert(frt::has_single_bit(PageSize) && PageSize >= 4096, "page size must be a power of two >= 4KiB");
+
+  public:
+    /// The size (and alignment) of a page in bytes
+    inline static constexpr frt::usize page_size = PageSize;
+
+    /// Creates a page source that maps pages according to `options`
+    ///
+    /// \param options How to map pages
+    explicit LinuxPageSource(LinuxPageOptions options = {}) noexcept : options_{options} {
+      FRT_ASSERT(options.huge_pages != LinuxHugePages::explicit_2m || page_size % (frt::usize{2} << 20) == 0,
+          "explicit huge pages need a page size that's a multiple of 2MiB");
+    }
+
+    /// Maps `count` pages
+    ///
+    /// \param count The number of pages
+    /// \return The pages, or `nullptr` if the kernel refused
+    [[nodiscard]] void* allocate_pages(frt::usize count) noexcept {
+      if (FRT_UNLIKELY(count == 0 || count > ~frt::usize{0} / page_size)) {
+        return nullptr;
+      }
+
+      return internal::linux_map_pages(count * page_size, page_size, options_);
+    }
+
+    /// Unmaps pages from `allocate_pages`
+    ///
+    /// \param pages The pages to unmap, or `nullptr`
+    /// \param count The count that was passed to `allocate_pages`
+    void deallocate_pages(void* pages, frt::usize count) noexcept {
+      if (pages != nullptr) {
+        internal::linux_unmap_pages(pages, count * page_size);
+      }
+    }
+
+    /// Gives the physical memory behind some pages back to the kernel while keeping them mapped, so they
+    /// can be reused later without another `allocate_pages`. Their contents are lost.
+    ///
+    /// \param pages The first page, from `allocate_pages`
+    /// \param count The number of pages to release
+    void release_pages(void* pages, frt::usize count) noexcept {
+      internal::linux_release_pages(pages, count * page_size, options_.release);
+    }
+
+    /// Gets the options that pages are mapped with
+    ///
+    /// \return The options
+    [[nodiscard]] LinuxPageOptions options() const noexcept {
+      return options_;
+    }
+
+  private:
+    LinuxPageOptions options_;
+  };
+} // namespace frt
+
+#endif
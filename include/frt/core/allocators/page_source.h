@@ -0,0 +1,74 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include "../../types/basic.h"
+#include "../../types/concepts.h"
+
+namespace frt {
+  /// Models a source of whole pages of memory, which is what heap-style allocators are built on
+  /// top of. What a "page" is is up to the source, it just needs to be a power of two.
+  ///
+  /// - `P::page_size` is the size (and alignment) of a page in bytes
+  /// - `allocate_pages(count)` returns `count` contiguous pages, or `nullptr` if it can't
+  /// - `deallocate_pages(pages, count)` gives back pages returned by `allocate_pages(count)`
+  template <typename P>
+  concept PageSource = requires(P& source, void* pages, frt::usize count) {
+    { P::page_size } -> ConvertibleTo<frt::usize>;
+    { source.allocate_pages(count) } -> SameAs<void*>;
+    // clang-format off
+    { source.deallocate_pages(pages, count) } noexcept;
+    // clang-format on
+  };
+
+  /// A `PageSource` that refers to another page source, so that several allocators can share one
+  /// (e.g. a few `SmallObjectHeap`s on top of one `BuddyAllocator`).
+  ///
+  /// \tparam P The page source to refer to
+  template <PageSource P> class PageSourceRef {
+  public:
+    /// The page size of the referred-to source
+    inline static constexpr frt::usize page_size = P::page_size;
+
+    explicit PageSourceRef() = default;
+
+    /// Creates a reference to `source`, which must outlive every copy of the reference
+    ///
+    /// \param source The page source to refer to
+    explicit constexpr PageSourceRef(P& source) noexcept : source_{&source} {}
+
+    /// Allocates pages from the referred-to source
+    ///
+    /// \param count The number of pages
+    /// \return The pages, or `nullptr`
+    [[nodiscard]] void* allocate_pages(frt::usize count) noexcept(noexcept(source_->allocate_pages(count))) {
+      return source_->allocate_pages(count);
+    }
+
+    /// Gives pages back to the referred-to source
+    ///
+    /// \param pages The pages to free
+    /// \param count The number of pages
+    void deallocate_pages(void* pages, frt::usize count) noexcept {
+      source_->deallocate_pages(pages, count);
+    }
+
+    /// Gets the source being referred to
+    ///
+    /// \return A pointer to the source, or `nullptr`
+    [[nodiscard]] constexpr P* get() const noexcept {
+      return source_;
+    }
+
+  private:
+    P* source_ = nullptr;
+  };
+} // namespace frt
@@ -0,0 +1,452 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include "../../platform/macros.h"
+#include "../../runtime/assert.h"
+#include "../../types/basic.h"
+#include "../../types/move.h"
+#include "../../types/traits.h"
+#include "../allocator.h"
+#include "./failing_allocator.h"
+
+namespace frt {
+  namespace internal {
+    // a free slot holds the link to the next free slot, so free slots need no extra memory.
+    // the count member is only used by the header slots of `GrowablePoolArena` chunks
+    template <typename T> union PoolSlot {
+      PoolSlot* next;
+      frt::usize count;
+      alignas(T) frt::ubyte storage[sizeof(T)]; // NOLINT(modernize-avoid-c-arrays)
+    };
+
+    // pops a slot off of a free list, or returns `nullptr` if it's empty
+    template <typename T> FRT_ALWAYS_INLINE PoolSlot<T>* pool_pop(PoolSlot<T>** head) noexcept {
+      auto* slot = *head;
+
+      if (slot != nullptr) {
+        *head = slot->next;
+      }
+
+      return slot;
+    }
+
+    template <typename T> FRT_ALWAYS_INLINE void pool_push(PoolSlot<T>** head, PoolSlot<T>* slot) noexcept {
+      slot->next = *head;
+      *head = slot;
+    }
+  } // namespace internal
+
+  /// A fixed-size pool of slots for single objects, meant to be put somewhere with a known lifetime and allocated
+  /// from through `PoolAllocator`s. Freed slots are kept on an intrusive free list, allocation and deallocation
+  /// are O(1) and slots have no per-allocation header. Slots that have never been used are handed out in address
+  /// order before any freed slot is reused, so the pool doesn't need any initialization pass.
+  ///
+  /// \tparam T The type that slots are sized and aligned for
+  /// \tparam BlockCount The number of slots in the pool
+  template <typename T, frt::usize BlockCount> class PoolArena {
+    using Slot = internal::PoolSlot<T>;
+
+  public:
+    using value_type = T;
+
+    explicit PoolArena() = default;
+
+    // allocators refer to the pool by address, so it can't move
+    PoolArena(const PoolArena&) = delete;
+
+    PoolArena& operator=(const PoolArena&) = delete;
+
+    ~PoolArena() = default;
+
+    /// Takes a slot out of the pool
+    ///
+    /// \return The slot, or `nullptr` if every slot is in use
+    [[nodiscard]] FRT_ALWAYS_INLINE T* allocate() noexcept {
+      if (auto* slot = internal::pool_pop(&free_); FRT_LIKELY(slot != nullptr)) {
+        return reinterpret_cast<T*>(slot);
+      }
+
+      if (FRT_LIKELY(untouched_ < BlockCount)) {
+        return reinterpret_cast<T*>(&slots_[untouched_++]);
+      }
+
+      return nullptr;
+    }
+
+    /// Gives a slot back to the pool
+    ///
+    /// \param ptr The slot to free, must have come from `allocate`
+    FRT_ALWAYS_INLINE void deallocate(T* ptr) noexcept {
+      internal::pool_push(&free_, reinterpret_cast<Slot*>(ptr));
+    }
+
+    /// Checks if `ptr` is a slot in the pool
+    ///
+    /// \param ptr The pointer to check
+    /// \return Whether `ptr` was allocated from the pool
+    [[nodiscard]] bool owns(const void* ptr) const noexcept {
+      auto address = reinterpret_cast<frt::usize>(ptr);
+      auto begin = reinterpret_cast<frt::usize>(&slots_[0]);
+
+      return address >= begin && address < begin + sizeof(slots_);
+    }
+
+    /// Gets the number of slots in the pool
+    ///
+    /// \return `BlockCount`
+    [[nodiscard]] static constexpr frt::usize capacity() noexcept {
+      return BlockCount;
+    }
+
+  private:
+    Slot slots_[BlockCount]; // NOLINT(modernize-avoid-c-arrays)
+    Slot* free_ = nullptr;
+    frt::usize untouched_ = 0;
+  };
+
+  /// An allocator for single objects that hands out slots from a `PoolArena` owned by someone else,
+  /// usually a local variable next to the container using it.
+  ///
+  /// The allocator only holds a pointer to the pool, so copies (and rebinds) share it: memory allocated
+  /// through one can be freed through any other, and two pool allocators compare equal when they use the
+  /// same pool and equal fallbacks. The pool must outlive every allocator referring to it.
+  ///
+  /// Requests for anything other than exactly one object, requests for types that don't fit in a slot of `Block`,
+  /// and any requests made once every slot is in use, go to `Fallback`. By default that's `FailingAllocator`.
+  ///
+  /// A default-constructed pool allocator has no pool and can't be used to allocate.
+  ///
+  /// \tparam T The type being allocated
+  /// \tparam BlockCount The number of slots in the pool
+  /// \tparam Fallback The allocator to use for requests that the pool can't fulfill
+  /// \tparam Block The type that the pool's slots are sized for, rebinding keeps it the same
+  template <typename T, frt::usize BlockCount, Allocator Fallback = FailingAllocator<T>, typename Block = T>
+  class PoolAllocator {
+  public:
+    using value_type = T;
+
+    using arena_type = PoolArena<Block, BlockCount>;
+
+    template <typename U> struct rebind {
+      using other = PoolAllocator<U, BlockCount, typename AllocatorTraits<Fallback>::template rebind_alloc<U>, Block>;
+    };
+
+    explicit PoolAllocator() = default;
+
+    /// Creates a pool allocator that allocates out of `pool`. `pool` must outlive the allocator and every
+    /// copy of it.
+    ///
+    /// \param pool The pool to allocate out of
+    /// \param fallback The allocator to use for requests that the pool can't fulfill
+    explicit constexpr PoolAllocator(arena_type& pool, Fallback fallback = Fallback{}) noexcept
+        : pool_{&pool},
+          fallback_{frt::move(fallback)} {}
+
+    /// Rebinds `other`, the new allocator uses the same pool and a rebound copy of `other`'s fallback
+    ///
+    /// \param other The allocator being rebound
+    template <typename U, typename F>
+    explicit constexpr PoolAllocator(const PoolAllocator<U, BlockCount, F, Block>& other) noexcept
+        : pool_{other.arena()},
+          fallback_{other.fallback()} {}
+
+    /// Allocates space for `n` objects. Single objects come from the pool if it has a free slot.
+    ///
+    /// \param n The number of objects to allocate space for
+    /// \return A pointer to the storage
+    [[nodiscard]] FRT_ALWAYS_INLINE T* allocate(frt::isize n) noexcept(
+        noexcept(traits::declval<Fallback&>().allocate(n))) {
+      FRT_ASSERT(pool_ != nullptr, "cannot allocate from a default-constructed `PoolAllocator`");
+
+      if constexpr (pooled) {
+        if (FRT_LIKELY(n == 1)) {
+          if (auto* slot = pool_->allocate(); FRT_LIKELY(slot != nullptr)) {
+            return reinterpret_cast<T*>(slot);
+          }
+        }
+      }
+
+      return fallback_.allocate(n);
+    }
+
+    /// Frees space for `n` objects
+    ///
+    /// \param ptr The storage to free
+    /// \param n The number of objects `ptr` was allocated with
+    FRT_ALWAYS_INLINE void deallocate(T* ptr, frt::isize n) noexcept {
+      if (FRT_LIKELY(pooled && n == 1 && owns(ptr))) {
+        pool_->deallocate(reinterpret_cast<Block*>(ptr));
+      } else {
+        fallback_.deallocate(ptr, n);
+      }
+    }
+
+    /// Checks if `ptr` is a slot in the pool
+    ///
+    /// \param ptr The pointer to check
+    /// \return Whether `ptr` was allocated from the pool
+    [[nodiscard]] bool owns(const T* ptr) const noexcept {
+      return pool_ != nullptr && pool_->owns(ptr);
+    }
+
+    /// Gets the number of slots in the pool
+    ///
+    /// \return `BlockCount`
+    [[nodiscard]] static constexpr frt::usize capacity() noexcept {
+      return BlockCount;
+    }
+
+    /// Gets the pool being allocated out of
+    ///
+    /// \return The pool, or `nullptr` if default-constructed
+    [[nodiscard]] constexpr arena_type* arena() const noexcept {
+      return pool_;
+    }
+
+    /// Gets the fallback allocator
+    ///
+    /// \return The fallback allocator
+    [[nodiscard]] constexpr const Fallback& fallback() const noexcept {
+      return fallback_;
+    }
+
+    [[nodiscard]] friend bool operator==(const PoolAllocator&, const PoolAllocator&) noexcept = default;
+
+  private:
+    // rebinds to types that don't fit in a slot go straight to the fallback
+    inline static constexpr bool pooled = sizeof(T) <= sizeof(Block) && alignof(T) <= alignof(Block);
+
+    arena_type* pool_ = nullptr;
+    [[no_unique_address]] Fallback fallback_;
+  };
+
+  /// A pool of slots for single objects that grows by obtaining chunks of slots from `A`, allocated from
+  /// through `GrowablePoolAllocator`s. Each chunk has twice as many slots as the last (up to `max_chunk_blocks`),
+  /// and chunks are only given back to `A` when the pool is destroyed.
+  ///
+  /// Slots are O(1) to allocate and free through an intrusive free list, exactly like `PoolArena`.
+  ///
+  /// `A` is rebound once, when the pool is created, and every chunk goes through that rebound copy.
+  /// That keeps the pool correct over allocators whose copies don't share state.
+  ///
+  /// \tparam T The type that slots are sized and aligned for
+  /// \tparam A The allocator to obtain chunks from
+  template <typename T, Allocator A> class GrowablePoolArena {
+    using Slot = internal::PoolSlot<T>;
+    using SlotAlloc = typename AllocatorTraits<A>::template rebind_alloc<Slot>;
+
+  public:
+    using value_type = T;
+
+    using allocator_type = A;
+
+    /// The number of slots in the first chunk, if not specified
+    inline static constexpr frt::usize default_chunk_blocks = 64;
+
+    /// The number of slots that chunks stop growing at
+    inline static constexpr frt::usize max_chunk_blocks = 4096;
+
+    /// Creates a pool. No memory is obtained from `alloc` until the first allocation.
+    ///
+    /// \param first_chunk_blocks The number of slots in the first chunk
+    /// \param alloc The allocator to obtain chunks from
+    explicit GrowablePoolArena(frt::usize first_chunk_blocks = default_chunk_blocks, A alloc = A{}) noexcept
+        : alloc_{alloc},
+          slots_alloc_{internal::rebind_allocator<Slot>(frt::move(alloc))},
+          next_chunk_blocks_{first_chunk_blocks == 0 ? 1 : first_chunk_blocks} {}
+
+    // allocators refer to the pool by address, so it can't move
+    GrowablePoolArena(const GrowablePoolArena&) = delete;
+
+    GrowablePoolArena& operator=(const GrowablePoolArena&) = delete;
+
+    ~GrowablePoolArena() {
+      while (chunks_ != nullptr) {
+        auto* previous = chunks_[0].next;
+
+        slots_alloc_.deallocate(chunks_, static_cast<frt::isize>(chunks_[1].count));
+        chunks_ = previous;
+      }
+    }
+
+    /// Takes a slot out of the pool, obtaining a new chunk from `A` if every slot is in use
+    ///
+    /// \return The slot, or `nullptr` if `A` failed to provide memory
+    [[nodiscard]] FRT_ALWAYS_INLINE T* allocate() noexcept(noexcept(traits::declval<SlotAlloc&>().allocate(1))) {
+      if (auto* slot = internal::pool_pop(&free_); FRT_LIKELY(slot != nullptr)) {
+        return reinterpret_cast<T*>(slot);
+      }
+
+      if (FRT_LIKELY(untouched_ != end_)) {
+        return reinterpret_cast<T*>(untouched_++);
+      }
+
+      return allocate_slow();
+    }
+
+    /// Gives a slot back to the pool
+    ///
+    /// \param ptr The slot to free, must have come from `allocate`
+    FRT_ALWAYS_INLINE void deallocate(T* ptr) noexcept {
+      internal::pool_push(&free_, reinterpret_cast<Slot*>(ptr));
+    }
+
+    /// Gets the number of slots obtained from `A` so far
+    ///
+    /// \return The number of slots
+    [[nodiscard]] frt::usize capacity() const noexcept {
+      auto total = frt::usize{0};
+
+      for (auto* chunk = chunks_; chunk != nullptr; chunk = chunk[0].next) {
+        total += chunk[1].count - header_slots;
+      }
+
+      return total;
+    }
+
+    /// Gets the allocator that the pool was created with
+    ///
+    /// \return The backing allocator
+    [[nodiscard]] const A& backing() const noexcept {
+      return alloc_;
+    }
+
+  private:
+    // each chunk starts with two slots of header: a link to the previous chunk, and the chunk's size in slots
+    inline static constexpr frt::usize header_slots = 2;
+
+    FRT_COLD T* allocate_slow() noexcept(noexcept(traits::declval<SlotAlloc&>().allocate(1))) {
+      auto count = next_chunk_blocks_ + header_slots;
+      auto* chunk = slots_alloc_.allocate(static_cast<frt::isize>(count));
+
+      if (chunk == nullptr) {
+        return nullptr;
+      }
+
+      chunk[0].next = chunks_;
+      chunk[1].count = count;
+      chunks_ = chunk;
+      untouched_ = chunk + header_slots;
+      end_ = chunk + count;
+
+      if (next_chunk_blocks_ < max_chunk_blocks) {
+        next_chunk_blocks_ *= 2;
+      }
+
+      return reinterpret_cast<T*>(untouched_++);
+    }
+
+    A alloc_;
+    SlotAlloc slots_alloc_;
+    Slot* chunks_ = nullptr;
+    Slot* free_ = nullptr;
+    Slot* untouched_ = nullptr;
+    Slot* end_ = nullptr;
+    frt::usize next_chunk_blocks_;
+  };
+
+  /// A pool allocator for single objects that allocates out of a `GrowablePoolArena` owned by someone else.
+  ///
+  /// The allocator only holds a pointer to the pool (and a copy of the pool's backing allocator, rebound to `T`),
+  /// so copies and rebinds share every chunk and one free list: memory allocated through one can be freed through
+  /// any other, and two growable pool allocators compare equal when they use the same pool. The pool must outlive
+  /// every allocator referring to it.
+  ///
+  /// Requests for anything other than one object, and requests for types that don't fit in a slot of `Block`,
+  /// go straight to the backing allocator.
+  ///
+  /// A default-constructed growable pool allocator has no pool and can't be used to allocate.
+  ///
+  /// \tparam T The type being allocated
+  /// \tparam A The allocator the pool obtains chunks from
+  /// \tparam Block The type that the pool's slots are sized for, rebinding keeps it the same
+  template <typename T, Allocator A, typename Block = T> class GrowablePoolAllocator {
+    using ValueAlloc = typename AllocatorTraits<A>::template rebind_alloc<T>;
+
+  public:
+    using value_type = T;
+
+    using arena_type = GrowablePoolArena<Block, A>;
+
+    template <typename U> struct rebind { using other = GrowablePoolAllocator<U, A, Block>; };
+
+    explicit GrowablePoolAllocator() = default;
+
+    /// Creates a pool allocator that allocates out of `pool`. `pool` must outlive the allocator and every
+    /// copy of it.
+    ///
+    /// \param pool The pool to allocate out of
+    explicit GrowablePoolAllocator(arena_type& pool) noexcept
+        : pool_{&pool},
+          values_alloc_{internal::rebind_allocator<T>(pool.backing())} {}
+
+    /// Rebinds `other`, the new allocator uses the same pool
+    ///
+    /// \param other The allocator being rebound
+    template <typename U>
+    explicit GrowablePoolAllocator(const GrowablePoolAllocator<U, A, Block>& other) noexcept
+        : pool_{other.arena()},
+          values_alloc_{internal::rebind_allocator<T>(other.backing())} {}
+
+    /// Allocates space for `n` objects. Single objects come from the pool, anything else comes from `A`.
+    ///
+    /// \param n The number of objects to allocate space for
+    /// \return A pointer to the storage, or `nullptr` if `A` failed to provide memory
+    [[nodiscard]] FRT_ALWAYS_INLINE T* allocate(frt::isize n) noexcept(noexcept(traits::declval<A&>().allocate(n))) {
+      FRT_ASSERT(pool_ != nullptr, "cannot allocate from a default-constructed `GrowablePoolAllocator`");
+
+      if constexpr (pooled) {
+        if (FRT_LIKELY(n == 1)) {
+          return reinterpret_cast<T*>(pool_->allocate());
+        }
+      }
+
+      return values_alloc_.allocate(n);
+    }
+
+    /// Frees space for `n` objects
+    ///
+    /// \param ptr The storage to free
+    /// \param n The number of objects `ptr` was allocated with
+    FRT_ALWAYS_INLINE void deallocate(T* ptr, frt::isize n) noexcept {
+      if (FRT_LIKELY(pooled && n == 1)) {
+        pool_->deallocate(reinterpret_cast<Block*>(ptr));
+      } else {
+        values_alloc_.deallocate(ptr, n);
+      }
+    }
+
+    /// Gets the pool being allocated out of
+    ///
+    /// \return The pool, or `nullptr` if default-constructed
+    [[nodiscard]] arena_type* arena() const noexcept {
+      return pool_;
+    }
+
+    /// Gets the backing allocator
+    ///
+    /// \return The backing allocator, rebound to `T`
+    [[nodiscard]] const ValueAlloc& backing() const noexcept {
+      return values_alloc_;
+    }
+
+    [[nodiscard]] friend bool operator==(const GrowablePoolAllocator&,
+        const GrowablePoolAllocator&) noexcept = default;
+
+  private:
+    // rebinds to types that don't fit in a slot go straight to the backing allocator
+    inline static constexpr bool pooled = sizeof(T) <= sizeof(Block) && alignof(T) <= alignof(Block);
+
+    arena_type* pool_ = nullptr;
+    ValueAlloc values_alloc_;
+  };
+} // namespace frt
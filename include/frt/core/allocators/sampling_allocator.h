@@ -0,0 +1,430 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include "../../collections/array.h"
+#include "../../platform/backtrace.h"
+#include "../../platform/macros.h"
+#include "../../runtime/assert.h"
+#include "../../sync/atomic.h"
+#include "../../sync/spin_mutex.h"
+#include "../../types/basic.h"
+#include "../../types/concepts.h"
+#include "../../types/move.h"
+#include "../../types/traits.h"
+#include "../allocator.h"
+#include "../bit.h"
+
+namespace frt {
+  namespace internal {
+    // a xorshift64* step, plenty for picking sample points
+    [[nodiscard]] FRT_ALWAYS_INLINE constexpr frt::u64 sampler_random(frt::u64& state) noexcept {
+      state ^= state >> 12;
+      state ^= state << 25;
+      state ^= state >> 27;
+
+      return state * 0x2545F4914F6CDD1DULL;
+    }
+
+    // `log2(value)` in 24.8 fixed point, for `value` in `[1, 2^26]`. the fraction is found a bit at a time by
+    // repeatedly squaring the mantissa, which keeps floating point out of the allocation path
+    [[nodiscard]] constexpr frt::u64 sampler_log2(frt::u64 value) noexcept {
+      auto exponent = static_cast<frt::u64>(frt::bit_width(value) - 1);
+      auto mantissa = value << (31 - exponent); // 1.31 fixed point, in [1, 2)
+      auto fraction = frt::u64{0};
+
+      for (auto i = 0; i < 8; ++i) {
+        mantissa = (mantissa * mantissa) >> 31;
+        fraction <<= 1;
+
+        if (mantissa >= (frt::u64{2} << 31)) {
+          mantissa >>= 1;
+          fraction |= 1;
+        }
+      }
+
+      return (exponent << 8) | fraction;
+    }
+
+    // the distance to the next sample point, exponentially distributed with a mean of `period`. this is
+    // `-ln(u) * period` for a uniform `u` in `(0, 1]`, with 26 bits of `u` and `ln(2)` as 45426 / 2^16
+    [[nodiscard]] constexpr frt::usize sampler_interval(frt::u64& state, frt::usize period) noexcept {
+      auto uniform = (sampler_random(state) >> 38) + 1;
+      auto neg_log2 = (frt::u64{26} << 8) - sampler_log2(uniform);
+
+      return static_cast<frt::usize>((((period * neg_log2) >> 8) * 45426) >> 16) + 1;
+    }
+  } // namespace internal
+
+  /// A sampled allocation that's still live
+  struct HeapSample {
+    /// The most frames that are captured for each sample
+    inline static constexpr frt::usize max_depth = 16;
+
+    void* address = nullptr;
+    frt::usize size = 0;            // the size of the allocation in bytes
+    frt::usize estimated_bytes = 0; // how many live bytes this sample stands for, see `HeapProfile`
+    frt::usize depth = 0;           // the number of frames captured
+    frt::Array<void*, max_depth> frames = {};
+  };
+
+  /// Totals for a `HeapProfile`
+  struct HeapProfileSummary {
+    frt::usize live_samples = 0;
+    frt::usize estimated_live_bytes = 0;
+    frt::usize total_samples = 0;   // every sample ever taken, including ones that have been freed
+    frt::usize dropped_samples = 0; // samples that didn't fit in the table
+  };
+
+  /// The live samples recorded by any number of `SampledAllocator`s, kept in a fixed-size table so that
+  /// recording never allocates.
+  ///
+  /// Sampling is geometric (like tcmalloc): on average, one sample point falls in every `sample_period`
+  /// bytes allocated, and an allocation is sampled if one or more points fall inside of it. Each point stands
+  /// for `sample_period` bytes, so summing `estimated_bytes` over the live samples gives an unbiased estimate
+  /// of the live heap, and grouping them by backtrace shows where it was allocated from.
+  ///
+  /// The table is split into buckets of `bucket_size` slots, and a sample whose bucket is full is dropped
+  /// (and counted in `dropped_samples`). Entries never move, which is what lets deallocation check
+  /// whether a pointer was sampled with a few relaxed loads and without taking the lock.
+  ///
+  /// \tparam Capacity The number of samples the table can hold, a power of two
+  template <frt::usize Capacity = 1024> class HeapProfile {
+    static_assert(frt::has_single_bit(Capacity) && Capacity >= 4, "capacity must be a power of two >= 4");
+
+  public:
+    /// The default mean distance between sample points, in bytes
+    inline static constexpr frt::usize default_sample_period = frt::usize{512} * 1024;
+
+    /// The number of slots a pointer can be put in
+    inline static constexpr frt::usize bucket_size = 4;
+
+    /// Creates an empty profile
+    ///
+    /// \param sample_period The mean distance between sample points in bytes
+    /// \param depth The maximum number of frames to capture for each sample, at most `HeapSample::max_depth`
+    explicit HeapProfile(frt::usize sample_period = default_sample_period,
+        frt::usize depth = HeapSample::max_depth) noexcept
+        : period_{sample_period},
+          depth_{depth < HeapSample::max_depth ? depth : HeapSample::max_depth} {
+      FRT_ASSERT(sample_period != 0, "sample period must be non-zero");
+    }
+
+    HeapProfile(const HeapProfile&) = delete;
+
+    HeapProfile& operator=(const HeapProfile&) = delete;
+
+    ~HeapProfile() = default;
+
+    /// Gets the mean distance between sample points
+    ///
+    /// \return The sample period in bytes
+    [[nodiscard]] frt::usize sample_period() const noexcept {
+      return period_;
+    }
+
+    /// Gets a new seed for an allocator's sampler, so that different allocators don't pick the same points
+    ///
+    /// \return A non-zero seed
+    [[nodiscard]] frt::u64 next_seed() noexcept {
+      // splitmix64's finalizer, over a counter that's stepped by the golden ratio
+      auto seed = seeds_.add_fetch(0x9E3779B97F4A7C15ULL, frt::memory_order_relaxed);
+
+      seed = (seed ^ (seed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      seed = (seed ^ (seed >> 27)) * 0x94D049BB133111EBULL;
+      seed ^= seed >> 31;
+
+      return seed == 0 ? 1 : seed;
+    }
+
+    /// Records a sampled allocation, along with the backtrace of whoever called this
+    ///
+    /// \param address The allocation
+    /// \param size The size of the allocation in bytes
+    /// \param points The number of sample points that fell inside the allocation
+    /// \param skip The number of the caller's own frames to leave out of the backtrace
+    FRT_NEVER_INLINE FRT_COLD void record(void* address,
+        frt::usize size,
+        frt::usize points,
+        frt::usize skip = 0) noexcept {
+      auto sample = HeapSample{address, size, points * period_, 0, {}};
+
+      sample.depth = frt::frame_backtrace(sample.frames.data(), depth_, skip);
+
+      lock_.lock();
+
+      auto first = bucket_of(address);
+
+      ++total_;
+
+      for (auto i = first; i < first + bucket_size; ++i) {
+        if (keys_[i].load(frt::memory_order_relaxed) == 0) {
+          samples_[i] = sample;
+          live_.fetch_add(1, frt::memory_order_relaxed);
+          keys_[i].store(reinterpret_cast<frt::usize>(address), frt::memory_order_release);
+          lock_.unlock();
+
+          return;
+        }
+      }
+
+      ++dropped_;
+      lock_.unlock();
+    }
+
+    /// Forgets about an allocation if it was sampled. This needs to happen before the memory is actually
+    /// freed, otherwise another thread could get the same address and sample it first.
+    ///
+    /// \param address The allocation being freed
+    FRT_ALWAYS_INLINE void forget(void* address) noexcept {
+      // a null key would match an empty entry
+      if (address == nullptr || live_.load(frt::memory_order_relaxed) == 0) {
+        return;
+      }
+
+      auto key = reinterpret_cast<frt::usize>(address);
+      auto first = bucket_of(address);
+
+      for (auto i = first; i < first + bucket_size; ++i) {
+        if (FRT_UNLIKELY(keys_[i].load(frt::memory_order_relaxed) == key)) {
+          remove(i, key);
+
+          return;
+        }
+      }
+    }
+
+    /// Copies the live samples out of the table
+    ///
+    /// \param samples Where to copy the samples to
+    /// \param max The most samples to copy
+    /// \return The number of samples copied
+    [[nodiscard]] frt::usize dump(HeapSample* samples, frt::usize max) const noexcept {
+      auto count = frt::usize{0};
+
+      lock_.lock();
+
+      for (auto i = frt::usize{0}; i < Capacity && count < max; ++i) {
+        if (keys_[i].load(frt::memory_order_relaxed) != 0) {
+          samples[count++] = samples_[i];
+        }
+      }
+
+      lock_.unlock();
+
+      return count;
+    }
+
+    /// Totals up the live samples
+    ///
+    /// \return The summary
+    [[nodiscard]] HeapProfileSummary summary() const noexcept {
+      auto result = HeapProfileSummary{};
+
+      lock_.lock();
+
+      for (auto i = frt::usize{0}; i < Capacity; ++i) {
+        if (keys_[i].load(frt::memory_order_relaxed) != 0) {
+          ++result.live_samples;
+          result.estimated_live_bytes += samples_[i].estimated_bytes;
+        }
+      }
+
+      result.total_samples = total_;
+      result.dropped_samples = dropped_;
+      lock_.unlock();
+
+      return result;
+    }
+
+  private:
+    [[nodiscard]] FRT_ALWAYS_INLINE static frt::usize bucket_of(void* address) noexcept {
+      constexpr auto buckets = Capacity / bucket_size;
+
+      // fibonacci hashing, the low bits of an address are mostly alignment
+      auto hash = static_cast<frt::u64>(reinterpret_cast<frt::usize>(address)) * 0x9E3779B97F4A7C15ULL;
+
+      return (static_cast<frt::usize>(hash >> 32) % buckets) * bucket_size;
+    }
+
+    FRT_COLD void remove(frt::usize slot, frt::usize key) noexcept {
+      lock_.lock();
+
+      // it can't have changed, nothing else can free the same pointer at the same time
+      if (keys_[slot].load(frt::memory_order_relaxed) == key) {
+        keys_[slot].store(0, frt::memory_order_relaxed);
+        live_.fetch_sub(1, frt::memory_order_relaxed);
+      }
+
+      lock_.unlock();
+    }
+
+    frt::usize period_;
+    frt::usize depth_;
+    frt::Atomic<frt::u64> seeds_;
+    frt::Atomic<frt::usize> live_;
+    mutable frt::SpinMutex lock_;
+    frt::usize total_ = 0;
+    frt::usize dropped_ = 0;
+    frt::Atomic<frt::usize> keys_[Capacity]; // NOLINT(modernize-avoid-c-arrays)
+    HeapSample samples_[Capacity];           // NOLINT(modernize-avoid-c-arrays)
+  };
+
+  /// An allocator adapter that samples allocations into a `HeapProfile`, while forwarding the actual
+  /// work to another allocator. This is cheap enough to leave on in production: an allocation that isn't
+  /// sampled costs a compare and a subtraction, and a deallocation costs a few relaxed loads while there are
+  /// live samples.
+  ///
+  /// Each allocator has its own sampler, so copies (and rebinds) don't share any mutable state besides
+  /// the profile they record into. That doesn't bias anything, since the distance to the next sample point
+  /// is memoryless.
+  ///
+  /// Backtraces are captured by walking frame pointers, so code allocating through this must be built with
+  /// them. See `frt::frame_backtrace`.
+  ///
+  /// \tparam A The allocator to forward to
+  /// \tparam Profile The profile to record into
+  template <Allocator A, typename Profile = HeapProfile<>> class SampledAllocator {
+    static_assert(SameAs<internal::AllocPtr<A>, typename A::value_type*>, "inner allocator must use raw pointers");
+
+  public:
+    using value_type = typename A::value_type;
+
+    template <typename U> struct rebind { using other = SampledAllocator<internal::AllocRebind<A, U>, Profile>; };
+
+    explicit SampledAllocator() = default;
+
+    /// Creates an allocator that samples into `profile`. `profile` must outlive the allocator and every copy of it.
+    ///
+    /// \param profile Where to record samples
+    /// \param alloc The allocator to forward to
+    explicit SampledAllocator(Profile& profile, A alloc = A{}) noexcept
+        : SampledAllocator(&profile, frt::move(alloc)) {}
+
+    /// Copies `other`, the new allocator samples into the same profile
+    ///
+    /// \param other The allocator to copy
+    SampledAllocator(const SampledAllocator& other) noexcept : SampledAllocator(other.profile_, other.alloc_) {}
+
+    /// Rebinds `other`, the new allocator samples into the same profile
+    ///
+    /// \param other The allocator to rebind
+    template <typename U>
+    requires traits::is_constructible<A, const U&>
+    explicit SampledAllocator(const SampledAllocator<U, Profile>& other) noexcept
+        : SampledAllocator(other.profile(), A(other.inner())) {}
+
+    SampledAllocator& operator=(const SampledAllocator& other) noexcept {
+      alloc_ = other.alloc_;
+
+      // the sampler is only meaningful for the profile it was seeded for
+      if (profile_ != other.profile_) {
+        profile_ = other.profile_;
+        reseed();
+      }
+
+      return *this;
+    }
+
+    ~SampledAllocator() = default;
+
+    /// Allocates space for `n` objects, sampling it if a sample point falls inside of it
+    ///
+    /// \param n The number of objects to allocate space for
+    /// \return A pointer to the storage
+    [[nodiscard]] FRT_ALWAYS_INLINE value_type* allocate(frt::isize n) noexcept(
+        noexcept(traits::declval<A&>().allocate(1))) {
+      FRT_ASSERT(profile_ != nullptr, "cannot allocate from a default-constructed `SampledAllocator`");
+
+      auto ptr = alloc_.allocate(n);
+      auto size = static_cast<frt::usize>(n) * sizeof(value_type);
+
+      if (FRT_LIKELY(size < until_sample_)) {
+        until_sample_ -= size;
+      } else {
+        sample(ptr, size);
+      }
+
+      return ptr;
+    }
+
+    /// Frees space for `n` objects, removing it from the profile if it was sampled
+    ///
+    /// \param ptr The block to free
+    /// \param n The number of objects the block was allocated with
+    FRT_ALWAYS_INLINE void deallocate(value_type* ptr, frt::isize n) noexcept {
+      if (profile_ != nullptr) {
+        profile_->forget(ptr);
+      }
+
+      alloc_.deallocate(ptr, n);
+    }
+
+    /// Gets the allocator being forwarded to
+    ///
+    /// \return The inner allocator
+    [[nodiscard]] const A& inner() const noexcept {
+      return alloc_;
+    }
+
+    /// Gets the profile being sampled into
+    ///
+    /// \return The profile, or `nullptr` if default-constructed
+    [[nodiscard]] Profile* profile() const noexcept {
+      return profile_;
+    }
+
+    // the samplers don't matter, either allocator can free the other's memory as long as the rest is equal
+    [[nodiscard]] friend bool operator==(const SampledAllocator& lhs, const SampledAllocator& rhs) noexcept {
+      return lhs.alloc_ == rhs.alloc_ && lhs.profile_ == rhs.profile_;
+    }
+
+  private:
+    SampledAllocator(Profile* profile, A alloc) noexcept : alloc_{frt::move(alloc)}, profile_{profile} {
+      reseed();
+    }
+
+    // starts a fresh sampler for `profile_`, without a profile nothing is ever sampled
+    void reseed() noexcept {
+      if (profile_ == nullptr) {
+        state_ = 1;
+        until_sample_ = ~frt::usize{0};
+      } else {
+        state_ = profile_->next_seed();
+        until_sample_ = internal::sampler_interval(state_, profile_->sample_period());
+      }
+    }
+
+    // counts every sample point inside the allocation, and moves past them
+    FRT_NEVER_INLINE void sample(value_type* ptr, frt::usize size) noexcept {
+      auto remaining = size;
+      auto points = frt::usize{0};
+
+      while (until_sample_ <= remaining) {
+        remaining -= until_sample_;
+        until_sample_ = internal::sampler_interval(state_, profile_->sample_period());
+        ++points;
+      }
+
+      until_sample_ -= remaining;
+
+      // skip our own frame, the next one is wherever `allocate` was inlined into
+      if (ptr != nullptr) {
+        profile_->record(ptr, size, points, 1);
+      }
+    }
+
+    A alloc_;
+    Profile* profile_ = nullptr;
+    frt::u64 state_ = 1;
+    frt::usize until_sample_ = ~frt::usize{0};
+  };
+} // namespace frt
@@ -0,0 +1,297 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include "../../collections/array.h"
+#include "../../platform/macros.h"
+#include "../../runtime/assert.h"
+#include "../../types/basic.h"
+#include "../../types/move.h"
+#include "../bit.h"
+#include "./alloc_ref.h"
+#include "./page_source.h"
+
+namespace frt {
+  namespace internal {
+    // size classes are 8, then 16 to 128 in steps of 16, then four classes per power of two up to 4KiB:
+    // 160, 192, 224, 256, 320, 384, ..., 3584, 4096. the worst-case internal fragmentation is 25%
+    inline constexpr frt::usize small_class_count = 29;
+
+    inline constexpr frt::usize small_max_size = 4096;
+
+    [[nodiscard]] constexpr frt::usize small_class_index(frt::usize size) noexcept {
+      if (size <= 8) {
+        return 0;
+      }
+
+      if (size <= 128) {
+        return (size + 15) >> 4;
+      }
+
+      // 2^(p - 1) < size <= 2^p, the classes for that range are spaced 2^(p - 3) apart
+      auto p = frt::bit_width(size - 1);
+
+      return 9 + (p - 8) * 4 + ((size - 1) >> (p - 3)) - 4;
+    }
+
+    [[nodiscard]] constexpr frt::usize small_class_size(frt::usize index) noexcept {
+      if (index <= 8) {
+        return index == 0 ? 8 : index * 16;
+      }
+
+      auto group = (index - 9) / 4;
+      auto step = frt::usize{32} << group;
+
+      return (frt::usize{128} << group) + step * ((index - 9) % 4 + 1);
+    }
+  } // namespace internal
+
+  /// A general-purpose heap for small objects, built on top of a `PageSource`.
+  ///
+  /// Requests are rounded up to one of a fixed set of size classes (8B to 4KiB), and each size class
+  /// carves objects out of its own slabs of pages. Freed objects go on an intrusive per-class free list, so
+  /// both allocation and deallocation are O(1) without any per-object header. Requests bigger than the largest
+  /// size class get whole pages from the page source directly.
+  ///
+  /// Slabs are only returned to the page source when the heap is destroyed. Page-sized requests aren't tracked
+  /// by the heap, they need to be freed before the heap is destroyed.
+  ///
+  /// This is a memory resource (like `BumpAllocator`), use `SmallObjectAllocator` to use it as an `Allocator`.
+  /// It's neither copyable nor movable, since allocators refer to it by address.
+  ///
+  /// \tparam P The page source to obtain memory from
+  template <PageSource P> class SmallObjectHeap {
+    static_assert(frt::has_single_bit(frt::usize{P::page_size}), "page size must be a power of two");
+
+    struct FreeObject {
+      FreeObject* next;
+    };
+
+    // lives in the last bytes of each slab
+    struct Slab {
+      Slab* next;
+      frt::usize pages;
+    };
+
+    struct SizeClass {
+      FreeObject* free = nullptr;
+      frt::ubyte* untouched = nullptr;
+      frt::ubyte* end = nullptr;
+    };
+
+  public:
+    /// The largest request that's served from a size class rather than directly from the page source
+    inline static constexpr frt::usize max_small_size = internal::small_max_size;
+
+    /// The alignment given to allocations that don't ask for one
+    inline static constexpr frt::usize default_alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+    /// Creates a heap. No memory is obtained from `source` until the first allocation.
+    ///
+    /// \param source The page source to obtain memory from
+    explicit SmallObjectHeap(P source = P{}) noexcept : source_{frt::move(source)} {}
+
+    SmallObjectHeap(const SmallObjectHeap&) = delete;
+
+    SmallObjectHeap& operator=(const SmallObjectHeap&) = delete;
+
+    ~SmallObjectHeap() {
+      while (slabs_ != nullptr) {
+        auto* next = slabs_->next;
+        auto pages = slabs_->pages;
+
+        source_.deallocate_pages(slab_begin(slabs_, pages), pages);
+        slabs_ = next;
+      }
+    }
+
+    /// Gets the number of bytes that are actually reserved for a request of `size` bytes
+    /// aligned to `align`. Up to that many bytes can be used.
+    ///
+    /// \param size The number of bytes requested
+    /// \param align The alignment requested
+    /// \return The size of the block that would be allocated
+    [[nodiscard]] static constexpr frt::usize usable_size(frt::usize size,
+        frt::usize align = default_alignment) noexcept {
+      auto index = class_for(size, align);
+
+      if (index == internal::small_class_count) {
+        return round_up(size, P::page_size);
+      }
+
+      return internal::small_class_size(index);
+    }
+
+    /// Allocates `size` bytes aligned to `align`.
+    ///
+    /// \param size The number of bytes to allocate
+    /// \param align The alignment of the allocation, must be a power of two no bigger than the page size
+    /// \return A pointer to the memory, or `nullptr` if the page source couldn't provide more
+    [[nodiscard]] FRT_ALWAYS_INLINE void* allocate(frt::usize size, frt::usize align = default_alignment) noexcept {
+      FRT_ASSERT(frt::has_single_bit(align), "alignment must be a power of two");
+
+      auto index = class_for(size, align);
+
+      if (FRT_UNLIKELY(index == internal::small_class_count)) {
+        return allocate_large(size, align);
+      }
+
+      auto& sc = classes_[index];
+
+      if (auto* object = sc.free; FRT_LIKELY(object != nullptr)) {
+        sc.free = object->next;
+
+        return object;
+      }
+
+      if (FRT_LIKELY(sc.untouched != sc.end)) {
+        auto* object = sc.untouched;
+
+        sc.untouched += internal::small_class_size(index);
+
+        return object;
+      }
+
+      return allocate_slab(index);
+    }
+
+    /// Allocates at least `size` bytes aligned to `align`, reporting the size of the whole block. The
+    /// block can be freed with any size between `size` and the size that was reported.
+    ///
+    /// \param size The minimum number of bytes to allocate
+    /// \param align The alignment of the allocation, must be a power of two no bigger than the page size
+    /// \return The memory (`nullptr` if the page source couldn't provide more) and its usable size
+    [[nodiscard]] AllocationResult<void*, frt::usize> allocate_at_least(frt::usize size,
+        frt::usize align = default_alignment) noexcept {
+      auto* ptr = allocate(size, align);
+
+      return AllocationResult<void*, frt::usize>{ptr, ptr == nullptr ? 0 : usable_size(size, align)};
+    }
+
+    /// Frees memory obtained from `allocate`.
+    ///
+    /// \param ptr The memory to free
+    /// \param size The size that was passed to `allocate`
+    /// \param align The alignment that was passed to `allocate`
+    FRT_ALWAYS_INLINE void deallocate(void* ptr, frt::usize size, frt::usize align = default_alignment) noexcept {
+      auto index = class_for(size, align);
+
+      if (FRT_UNLIKELY(index == internal::small_class_count)) {
+        source_.deallocate_pages(ptr, round_up(size, P::page_size) / P::page_size);
+
+        return;
+      }
+
+      auto* object = static_cast<FreeObject*>(ptr);
+      auto& sc = classes_[index];
+
+      object->next = sc.free;
+      sc.free = object;
+    }
+
+    /// Gets the page source
+    ///
+    /// \return The page source
+    [[nodiscard]] P& source() noexcept {
+      return source_;
+    }
+
+  private:
+    // slabs hold at least this many objects, so large classes don't waste most of a slab on the header
+    inline static constexpr frt::usize min_objects_per_slab = 8;
+
+    [[nodiscard]] FRT_ALWAYS_INLINE static constexpr frt::usize round_up(frt::usize value, frt::usize align) noexcept {
+      return (value + (align - 1)) & ~(align - 1);
+    }
+
+    // objects start at page-aligned slab boundaries, so they're aligned to the largest power of two
+    // that divides the class size (but nothing can be aligned to more than a page)
+    [[nodiscard]] FRT_ALWAYS_INLINE static constexpr frt::usize natural_alignment(frt::usize size) noexcept {
+      auto align = size & (~size + 1);
+
+      return align < P::page_size ? align : P::page_size;
+    }
+
+    // returns `small_class_count` for requests that need whole pages
+    [[nodiscard]] FRT_ALWAYS_INLINE static constexpr frt::usize class_for(frt::usize size, frt::usize align) noexcept {
+      if (FRT_LIKELY(align <= 8)) {
+        return size <= max_small_size ? internal::small_class_index(size) : internal::small_class_count;
+      }
+
+      auto rounded = round_up(size, align);
+
+      if (rounded > max_small_size || rounded < size) {
+        return internal::small_class_count;
+      }
+
+      // the power-of-two classes always satisfy the alignment, so this terminates quickly
+      auto index = internal::small_class_index(rounded);
+
+      while (index < internal::small_class_count && natural_alignment(internal::small_class_size(index)) < align) {
+        ++index;
+      }
+
+      return index;
+    }
+
+    [[nodiscard]] static constexpr frt::usize slab_pages(frt::usize index) noexcept {
+      auto bytes = internal::small_class_size(index) * min_objects_per_slab + sizeof(Slab);
+
+      return round_up(bytes, P::page_size) / P::page_size;
+    }
+
+    [[nodiscard]] static void* slab_begin(Slab* slab, frt::usize pages) noexcept {
+      return reinterpret_cast<frt::ubyte*>(slab + 1) - pages * P::page_size;
+    }
+
+    FRT_COLD void* allocate_slab(frt::usize index) noexcept {
+      auto pages = slab_pages(index);
+      auto* memory = static_cast<frt::ubyte*>(source_.allocate_pages(pages));
+
+      if (memory == nullptr) {
+        return nullptr;
+      }
+
+      auto bytes = pages * P::page_size;
+      auto object_size = internal::small_class_size(index);
+      auto* slab = reinterpret_cast<Slab*>(memory + bytes - sizeof(Slab));
+
+      slab->next = slabs_;
+      slab->pages = pages;
+      slabs_ = slab;
+
+      auto& sc = classes_[index];
+
+      sc.untouched = memory + object_size;
+      sc.end = memory + ((bytes - sizeof(Slab)) / object_size) * object_size;
+
+      return memory;
+    }
+
+    FRT_COLD void* allocate_large(frt::usize size, frt::usize align) noexcept {
+      if (align > P::page_size || size > static_cast<frt::usize>(-1) - P::page_size) {
+        return nullptr;
+      }
+
+      return source_.allocate_pages(round_up(size, P::page_size) / P::page_size);
+    }
+
+    frt::Array<SizeClass, internal::small_class_count> classes_ = {};
+    Slab* slabs_ = nullptr;
+    P source_;
+  };
+
+  /// An `Allocator` that allocates out of a shared `SmallObjectHeap`. Every copy refers to the same heap.
+  ///
+  /// \tparam T The type being allocated
+  /// \tparam P The page source of the heap
+  template <typename T, PageSource P> using SmallObjectAllocator = AllocRef<SmallObjectHeap<P>, T>;
+} // namespace frt
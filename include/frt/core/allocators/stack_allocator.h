@@ -11,16 +11,264 @@
 #pragma once
 
 #include "../../collections/array.h"
+#include "../../platform/macros.h"
+#include "../../runtime/assert.h"
 #include "../../types/basic.h"
+#include "../../types/move.h"
 #include "../../types/traits.h"
 #include "../allocator.h"
+#include "../bit.h"
+#include "./failing_allocator.h"
 
 namespace frt {
-  template <typename T, frt::usize Bytes> class StackAllocator {
+  /// A fixed-size buffer that memory is bump-allocated out of, meant to be put on the stack (or
+  /// anywhere else with a known lifetime) and allocated from through `StackAllocator`s.
+  ///
+  /// Every block is rounded up to a multiple of `Align`, so freeing the most recent block gives all of
+  /// its space back, and the most recent block can be grown or shrunk in-place with `try_expand_in_place`.
+  /// Blocks freed out of order are only reclaimed once everything above them is freed too. Blocks aligned
+  /// to more than `Align` don't give back the padding in front of them.
+  ///
+  /// This is also a memory resource (like `BumpAllocator`), so it can be used through an `AllocRef`.
+  ///
+  /// \tparam Bytes The size of the buffer
+  /// \tparam Align The alignment of the buffer, and the granularity of blocks
+  template <frt::usize Bytes, frt::usize Align = __STDCPP_DEFAULT_NEW_ALIGNMENT__> class StackArena {
+    static_assert(frt::has_single_bit(Align), "alignment must be a power of two");
+
   public:
+    /// The size of the buffer in bytes
+    inline static constexpr frt::usize size = Bytes;
+
+    /// The alignment that every block gets without asking for it
+    inline static constexpr frt::usize alignment = Align;
+
+    explicit StackArena() = default;
+
+    // allocators refer to the arena by address, so it can't move
+    StackArena(const StackArena&) = delete;
+
+    StackArena& operator=(const StackArena&) = delete;
+
+    ~StackArena() = default;
+
+    /// Allocates `size` bytes aligned to `align` out of the buffer
+    ///
+    /// \param size The number of bytes to allocate
+    /// \param align The alignment of the block, must be a power of two
+    /// \return The block, or `nullptr` if it doesn't fit in what's left of the buffer
+    [[nodiscard]] void* allocate(frt::usize size, frt::usize align = alignment) noexcept {
+      if (FRT_UNLIKELY(size > Bytes)) {
+        return nullptr;
+      }
+
+      auto begin = top_;
+
+      if (FRT_UNLIKELY(align > Align)) {
+        auto base = reinterpret_cast<frt::usize>(storage_.data());
+
+        begin = ((base + top_ + (align - 1)) & ~(align - 1)) - base;
+      }
+
+      if (FRT_UNLIKELY(begin > Bytes || round_up(size) > Bytes - begin)) {
+        return nullptr;
+      }
+
+      top_ = begin + round_up(size);
+
+      return storage_.data() + begin;
+    }
+
+    /// Frees a block from `allocate`. If it's the most recent block, its space is immediately reusable.
+    ///
+    /// \param ptr The block to free
+    /// \param size The size that was passed to `allocate`
+    void deallocate(void* ptr, frt::usize size) noexcept {
+      auto begin = offset_of(ptr);
+
+      if (begin + round_up(size) == top_) {
+        top_ = begin;
+      }
+    }
+
+    /// Tries to resize a block in-place, without moving it. This only works for the most recent block.
+    ///
+    /// \param ptr The block to resize
+    /// \param size The current size of the block
+    /// \param new_size The size the block should be
+    /// \return Whether the block was resized. If this is `false`, nothing happened
+    [[nodiscard]] bool try_expand_in_place(void* ptr, frt::usize size, frt::usize new_size) noexcept {
+      auto begin = offset_of(ptr);
+
+      if (begin + round_up(size) != top_ || round_up(new_size) > Bytes - begin) {
+        return false;
+      }
+
+      top_ = begin + round_up(new_size);
+
+      return true;
+    }
+
+    /// Checks if `ptr` was allocated from the buffer
+    ///
+    /// \param ptr The pointer to check
+    /// \return Whether `ptr` points into the buffer
+    [[nodiscard]] bool owns(const void* ptr) const noexcept {
+      auto address = reinterpret_cast<frt::usize>(ptr);
+      auto begin = reinterpret_cast<frt::usize>(storage_.data());
+
+      // one-past-the-end is included for zero-size blocks at the very end, nothing
+      // else can live there since it's still inside `*this`
+      return address >= begin && address <= begin + Bytes;
+    }
+
+    /// Gets the number of bytes of the buffer that are currently in use
+    ///
+    /// \return The number of bytes in use
+    [[nodiscard]] frt::usize used() const noexcept {
+      return top_;
+    }
+
+    /// Frees every block at once. Nothing allocated from the arena can be used afterwards.
+    void reset() noexcept {
+      top_ = 0;
+    }
+
+  private:
+    // saturates, anything that would overflow is bigger than the buffer anyway
+    [[nodiscard]] FRT_ALWAYS_INLINE static constexpr frt::usize round_up(frt::usize size) noexcept {
+      return size > ~frt::usize{0} - (Align - 1) ? ~frt::usize{0} : (size + (Align - 1)) & ~(Align - 1);
+    }
+
+    [[nodiscard]] FRT_ALWAYS_INLINE frt::usize offset_of(void* ptr) const noexcept {
+      return static_cast<frt::usize>(static_cast<frt::ubyte*>(ptr) - storage_.data());
+    }
+
+    alignas(Align) frt::Array<frt::ubyte, Bytes> storage_;
+    frt::usize top_ = 0;
+  };
+
+  /// An allocator that allocates out of a `StackArena` owned by someone else, usually a local variable
+  /// next to the container using it.
+  ///
+  /// The allocator only holds a pointer to the arena, so copies (and rebinds) share it: memory allocated
+  /// through one can be freed through any other, and two stack allocators compare equal when they use the
+  /// same arena. The arena must outlive every allocator referring to it.
+  ///
+  /// Once the arena is exhausted, allocations are forwarded to `Fallback`. By default
+  /// that's `FailingAllocator`, which treats running out of space as a fatal error.
+  ///
+  /// A default-constructed stack allocator has no arena and can't be used to allocate.
+  ///
+  /// \tparam T The type being allocated
+  /// \tparam Bytes The size of the arena
+  /// \tparam Fallback The allocator to use once the arena is exhausted
+  template <typename T, frt::usize Bytes, Allocator Fallback = FailingAllocator<T>> class StackAllocator {
+  public:
+    using value_type = T;
+
+    using arena_type = StackArena<Bytes>;
+
+    template <typename U> struct rebind {
+      using other = StackAllocator<U, Bytes, typename AllocatorTraits<Fallback>::template rebind_alloc<U>>;
+    };
+
     explicit StackAllocator() = default;
 
+    /// Creates a stack allocator that allocates out of `arena`. `arena` must outlive the allocator and every
+    /// copy of it.
+    ///
+    /// \param arena The arena to allocate out of
+    /// \param fallback The allocator to use once the arena is exhausted
+    explicit constexpr StackAllocator(arena_type& arena, Fallback fallback = Fallback{}) noexcept
+        : arena_{&arena},
+          fallback_{frt::move(fallback)} {}
+
+    /// Rebinds `other`, the new allocator uses the same arena and a rebound copy of `other`'s fallback
+    ///
+    /// \param other The allocator being rebound
+    template <typename U, typename F>
+    explicit constexpr StackAllocator(const StackAllocator<U, Bytes, F>& other) noexcept
+        : arena_{other.arena()},
+          fallback_{other.fallback()} {}
+
+    /// Allocates space for `n` objects, from the arena if possible
+    /// and from the fallback allocator otherwise.
+    ///
+    /// \param n The number of objects to allocate space for
+    /// \return A pointer to the storage
+    [[nodiscard]] T* allocate(frt::isize n) noexcept(noexcept(traits::declval<Fallback&>().allocate(n))) {
+      FRT_ASSERT(arena_ != nullptr, "cannot allocate from a default-constructed `StackAllocator`");
+
+      if (FRT_LIKELY(n >= 0 && static_cast<frt::usize>(n) <= capacity)) {
+        auto* block = arena_->allocate(static_cast<frt::usize>(n) * sizeof(T), alignof(T));
+
+        if (FRT_LIKELY(block != nullptr)) {
+          return static_cast<T*>(block);
+        }
+      }
+
+      return fallback_.allocate(n);
+    }
+
+    /// Frees a block of `n` objects. If the block came from the arena and is
+    /// the most recent allocation, its space is immediately reusable.
+    ///
+    /// \param ptr The block to free
+    /// \param n The number of objects the block was allocated with
+    void deallocate(T* ptr, frt::isize n) noexcept {
+      if (owns(ptr)) {
+        arena_->deallocate(ptr, static_cast<frt::usize>(n) * sizeof(T));
+      } else {
+        fallback_.deallocate(ptr, n);
+      }
+    }
+
+    /// Tries to resize a block in-place, without moving it. This only works for the most
+    /// recent block allocated from the arena.
+    ///
+    /// \param ptr The block to resize
+    /// \param n The number of objects the block currently has space for
+    /// \param new_n The number of objects the block should have space for
+    /// \return Whether the block was resized. If this is `false`, nothing happened
+    [[nodiscard]] bool try_expand_in_place(T* ptr, frt::isize n, frt::isize new_n) noexcept {
+      if (!owns(ptr) || new_n < 0 || static_cast<frt::usize>(new_n) > capacity) {
+        return false;
+      }
+
+      return arena_->try_expand_in_place(ptr,
+          static_cast<frt::usize>(n) * sizeof(T),
+          static_cast<frt::usize>(new_n) * sizeof(T));
+    }
+
+    /// Checks if `ptr` was allocated from the arena
+    ///
+    /// \param ptr The pointer to check
+    /// \return Whether `ptr` points into the arena
+    [[nodiscard]] bool owns(const T* ptr) const noexcept {
+      return arena_ != nullptr && arena_->owns(ptr);
+    }
+
+    /// Gets the arena being allocated out of
+    ///
+    /// \return The arena, or `nullptr` if default-constructed
+    [[nodiscard]] constexpr arena_type* arena() const noexcept {
+      return arena_;
+    }
+
+    /// Gets the fallback allocator
+    ///
+    /// \return The fallback allocator
+    [[nodiscard]] constexpr const Fallback& fallback() const noexcept {
+      return fallback_;
+    }
+
+    [[nodiscard]] friend bool operator==(const StackAllocator&, const StackAllocator&) noexcept = default;
+
   private:
-    alignas(T) frt::Array<frt::ubyte, Bytes> storage_;
+    inline static constexpr frt::usize capacity = Bytes / sizeof(T);
+
+    arena_type* arena_ = nullptr;
+    [[no_unique_address]] Fallback fallback_;
   };
-} // namespace frt
\ No newline at end of file
+} // namespace frt
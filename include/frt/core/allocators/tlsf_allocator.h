@@ -0,0 +1,123 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include "../../types/basic.h"
+#include "./alloc_ref.h"
+
+namespace frt {
+  namespace internal::tlsf {
+    // free blocks are binned by two levels: the first level is the power of two that the size falls into,
+    // the second level linearly splits that range into `sl_count` bins
+    inline constexpr frt::usize sl_count_log2 = 5;
+    inline constexpr frt::usize sl_count = frt::usize{1} << sl_count_log2;
+
+    // block payloads are always aligned to (and sized in multiples of) a word
+    inline constexpr frt::usize align_log2 = sizeof(void*) == 8 ? 3 : 2;
+    inline constexpr frt::usize align_size = frt::usize{1} << align_log2;
+
+    // the largest block is 2^fl_index_max bytes
+    inline constexpr frt::usize fl_index_max = sizeof(void*) == 8 ? 32 : 30;
+    inline constexpr frt::usize fl_index_shift = sl_count_log2 + align_log2;
+    inline constexpr frt::usize fl_count = fl_index_max - fl_index_shift + 1;
+
+    // blocks smaller than this are all in the first level, split linearly
+    inline constexpr frt::usize small_block_size = frt::usize{1} << fl_index_shift;
+
+    struct Block;
+  } // namespace internal::tlsf
+
+  /// A Two-Level Segregated Fit heap over a caller-provided region of memory.
+  ///
+  /// Free blocks are kept in size-segregated lists indexed by a pair of bitmaps, so finding a block that fits
+  /// is a couple of bit scans rather than a search. Both `allocate` and `deallocate` are O(1) in the worst case,
+  /// and freed blocks are immediately coalesced with any free neighbors. Each block has a single word of
+  /// overhead, used to hold its size.
+  ///
+  /// This is a memory resource (like `BumpAllocator`), use `TLSFAllocator` to use it as an `Allocator`. It's
+  /// neither copyable nor movable, and it doesn't own the region it manages.
+  class TLSFHeap {
+  public:
+    /// The alignment given to allocations that don't ask for one. Blocks are only word-aligned, anything
+    /// more than that goes through a (slightly) slower path that has to split the block up
+    inline static constexpr frt::usize default_alignment = internal::tlsf::align_size;
+
+    /// The size of the largest possible block, bigger regions are only partially used
+    inline static constexpr frt::usize max_block_size = frt::usize{1} << internal::tlsf::fl_index_max;
+
+    /// Creates a heap that manages `region`. The region must stay valid for the heap's lifetime,
+    /// and if it's too small to hold any blocks the heap is simply always empty.
+    ///
+    /// \param region The beginning of the region of memory to manage
+    /// \param bytes The size of the region
+    explicit TLSFHeap(void* region, frt::usize bytes) noexcept;
+
+    TLSFHeap(const TLSFHeap&) = delete;
+
+    TLSFHeap& operator=(const TLSFHeap&) = delete;
+
+    ~TLSFHeap() = default;
+
+    /// Allocates `size` bytes aligned to `align`. Alignments bigger than a word are
+    /// handled by allocating slightly more and splitting off the misaligned beginning.
+    ///
+    /// \param size The number of bytes to allocate
+    /// \param align The alignment of the allocation, must be a power of two
+    /// \return A pointer to the memory, or `nullptr` if no free block is big enough
+    [[nodiscard]] void* allocate(frt::usize size, frt::usize align = default_alignment) noexcept;
+
+    /// Allocates at least `size` bytes aligned to `align`, reporting the real size of the block
+    ///
+    /// \param size The minimum number of bytes to allocate
+    /// \param align The alignment of the allocation, must be a power of two
+    /// \return The memory (`nullptr` if no free block is big enough) and its usable size
+    [[nodiscard]] AllocationResult<void*, frt::usize> allocate_at_least(frt::usize size,
+        frt::usize align = default_alignment) noexcept {
+      auto* ptr = allocate(size, align);
+
+      return AllocationResult<void*, frt::usize>{ptr, ptr == nullptr ? 0 : usable_size(ptr)};
+    }
+
+    /// Frees memory obtained from `allocate`, coalescing it with its neighbors.
+    ///
+    /// \param ptr The memory to free, or `nullptr`
+    /// \param size The size that was passed to `allocate` (unused, blocks know their own size)
+    void deallocate(void* ptr, frt::usize size) noexcept;
+
+    /// Gets the number of bytes that can actually be used in a block returned by `allocate`
+    ///
+    /// \param ptr A pointer returned by `allocate`
+    /// \return The usable size of the block, at least as much as was requested
+    [[nodiscard]] static frt::usize usable_size(const void* ptr) noexcept;
+
+  private:
+    using Block = internal::tlsf::Block;
+
+    void insert(Block* block) noexcept;
+
+    void remove(Block* block) noexcept;
+
+    void remove(Block* block, frt::usize fl, frt::usize sl) noexcept;
+
+    [[nodiscard]] Block* find_suitable(frt::usize size) noexcept;
+
+    [[nodiscard]] Block* split(Block* block, frt::usize size) noexcept;
+
+    frt::u32 fl_bitmap_ = 0;
+    frt::u32 sl_bitmap_[internal::tlsf::fl_count] = {};                      // NOLINT(modernize-avoid-c-arrays)
+    Block* free_[internal::tlsf::fl_count][internal::tlsf::sl_count] = {}; // NOLINT(modernize-avoid-c-arrays)
+  };
+
+  /// An `Allocator` that allocates out of a shared `TLSFHeap`. Every copy refers to the same heap.
+  ///
+  /// \tparam T The type being allocated
+  template <typename T> using TLSFAllocator = AllocRef<TLSFHeap, T>;
+} // namespace frt
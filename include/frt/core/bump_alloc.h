@@ -10,14 +10,314 @@
 
 #pragma once
 
+#include "../platform/macros.h"
+#include "../runtime/assert.h"
+#include "../types/basic.h"
+#include "../types/move.h"
+#include "../types/traits.h"
+#include "../utility/construct.h"
 #include "./allocator.h"
+#include "./bit.h"
+#include "./pointers.h"
 
 namespace frt {
+  /// An arena allocator. Memory is handed out by bumping a pointer through large chunks obtained
+  /// from `A`, and is only ever given back to `A` all at once (by `reset`, `rewind` or destruction).
+  ///
+  /// Each new chunk is twice the size of the last (up to `max_chunk_size`), so the number of chunks
+  /// grows logarithmically with the total amount allocated.
+  ///
+  /// This is not itself an `Allocator`, it's a memory resource that allocators can refer to.
+  /// It's move-only, since the memory handed out belongs to this specific object.
+  ///
+  /// \tparam A The allocator to obtain chunks from, rebound to `frt::ubyte`
   template <Allocator A> class BumpAllocator {
+    using ByteAlloc = typename AllocatorTraits<A>::template rebind_alloc<frt::ubyte>;
+    using ByteTraits = AllocatorTraits<ByteAlloc>;
+
+    // lives at the (aligned) beginning of each chunk
+    struct Chunk {
+      Chunk* previous;
+      typename ByteTraits::pointer storage;
+      frt::usize size;
+    };
+
   public:
-    //
+    /// An opaque position in the arena, see `mark` and `rewind`
+    class Marker {
+    public:
+      Marker() = delete;
+
+    private:
+      friend class BumpAllocator;
+
+      constexpr Marker(Chunk* chunk, frt::ubyte* current) noexcept : chunk_{chunk}, current_{current} {}
+
+      Chunk* chunk_;
+      frt::ubyte* current_;
+    };
+
+    /// The default size of the first chunk obtained from `A`, in bytes
+    inline static constexpr frt::usize default_chunk_size = 4096;
+
+    /// The size that chunks stop growing at, in bytes. Single allocations bigger than this
+    /// still work, they just get a chunk to themselves.
+    inline static constexpr frt::usize max_chunk_size = frt::usize{1} << 26;
+
+    /// The alignment given to allocations that don't ask for one
+    inline static constexpr frt::usize default_alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+    /// Creates an arena. No memory is obtained from `alloc` until the first allocation.
+    ///
+    /// \param first_chunk_size The size of the first chunk to obtain from `alloc`
+    /// \param alloc The allocator to obtain chunks from
+    explicit BumpAllocator(frt::usize first_chunk_size = default_chunk_size, A alloc = A{}) noexcept
+        : alloc_{internal::rebind_allocator<frt::ubyte>(frt::move(alloc))},
+          next_chunk_size_{first_chunk_size < min_chunk_size ? min_chunk_size : first_chunk_size} {}
+
+    BumpAllocator(const BumpAllocator&) = delete;
+
+    BumpAllocator(BumpAllocator&& other) noexcept
+        : alloc_{frt::move(other.alloc_)},
+          head_{other.head_},
+          current_{other.current_},
+          end_{other.end_},
+          next_chunk_size_{other.next_chunk_size_} {
+      other.head_ = nullptr;
+      other.current_ = nullptr;
+      other.end_ = nullptr;
+    }
+
+    BumpAllocator& operator=(const BumpAllocator&) = delete;
+
+    BumpAllocator& operator=(BumpAllocator&& other) noexcept {
+      if (this != &other) {
+        release_until(nullptr);
+
+        alloc_ = frt::move(other.alloc_);
+        head_ = other.head_;
+        current_ = other.current_;
+        end_ = other.end_;
+        next_chunk_size_ = other.next_chunk_size_;
+        other.head_ = nullptr;
+        other.current_ = nullptr;
+        other.end_ = nullptr;
+      }
+
+      return *this;
+    }
+
+    ~BumpAllocator() {
+      release_until(nullptr);
+    }
+
+    /// Allocates `size` bytes aligned to `align`. This is a pointer bump in the common case,
+    /// a new chunk is only obtained from `A` when the current one is exhausted.
+    ///
+    /// \param size The number of bytes to allocate
+    /// \param align The alignment of the allocation, must be a power of two
+    /// \return A pointer to the memory, or `nullptr` if `A` failed to provide a new chunk
+    [[nodiscard]] FRT_ALWAYS_INLINE void* allocate(frt::usize size, frt::usize align = default_alignment) noexcept {
+      FRT_ASSERT(frt::has_single_bit(align), "alignment must be a power of two");
+
+      auto address = align_up(reinterpret_cast<frt::usize>(current_), align);
+
+      // `end_ - address` instead of `address + size` so that huge sizes can't wrap around. this
+      // is strictly less-than so that an arena without any chunks never hands out `nullptr`
+      if (FRT_LIKELY(address < reinterpret_cast<frt::usize>(end_)
+                     && size <= reinterpret_cast<frt::usize>(end_) - address)) {
+        current_ = reinterpret_cast<frt::ubyte*>(address + size);
+
+        return reinterpret_cast<void*>(address);
+      }
+
+      return allocate_slow(size, align);
+    }
+
+    /// Allocates uninitialized storage for `count` objects of type `T`.
+    ///
+    /// \param count The number of objects
+    /// \return A pointer to the storage, or `nullptr` if `A` failed to provide a new chunk
+    template <typename T> [[nodiscard]] FRT_ALWAYS_INLINE T* allocate(frt::usize count = 1) noexcept {
+      if (FRT_UNLIKELY(count > static_cast<frt::usize>(-1) / sizeof(T))) {
+        return nullptr;
+      }
+
+      return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    /// Gives memory back to the arena. Memory is only actually reused if this was the most recent
+    /// allocation, otherwise this does nothing and the memory is reclaimed on `reset`/`rewind`.
+    ///
+    /// \param ptr A pointer returned by `allocate`
+    /// \param size The size that `ptr` was allocated with
+    FRT_ALWAYS_INLINE void deallocate(void* ptr, frt::usize size) noexcept {
+      auto* bytes = static_cast<frt::ubyte*>(ptr);
+
+      if (bytes + size == current_) {
+        current_ = bytes;
+      }
+    }
+
+    /// Tries to resize the most recent allocation in-place, which works as long as the new size still
+    /// fits in the current chunk. Nothing else can be resized.
+    ///
+    /// \param ptr A pointer returned by `allocate`
+    /// \param size The size that `ptr` currently has
+    /// \param new_size The size that `ptr` should have
+    /// \return Whether the allocation was resized. If this is `false`, nothing happened
+    [[nodiscard]] FRT_ALWAYS_INLINE bool try_expand_in_place(void* ptr, frt::usize size, frt::usize new_size) noexcept {
+      auto* bytes = static_cast<frt::ubyte*>(ptr);
+
+      if (bytes + size != current_ || new_size > static_cast<frt::usize>(end_ - bytes)) {
+        return false;
+      }
+
+      current_ = bytes + new_size;
+
+      return true;
+    }
+
+    /// Gets the current position of the arena, which can later be returned to with `rewind`.
+    ///
+    /// \return A marker for the current position
+    [[nodiscard]] Marker mark() const noexcept {
+      return Marker{head_, current_};
+    }
+
+    /// Frees everything allocated after `marker` was taken, and gives back every chunk obtained since then.
+    /// Any markers taken after `marker` are invalidated.
+    ///
+    /// \param marker A marker obtained from `mark` on this arena
+    void rewind(Marker marker) noexcept {
+      if (marker.chunk_ == nullptr) {
+        reset();
+
+        return;
+      }
+
+      release_until(marker.chunk_);
+
+      head_ = marker.chunk_;
+      current_ = marker.current_;
+      end_ = chunk_end(head_);
+    }
+
+    /// Frees everything that has been allocated. The newest (and largest) chunk is kept around for
+    /// future allocations, every other chunk is given back to `A`.
+    ///
+    /// Chunks only stop being obtained once one is big enough for everything allocated between resets,
+    /// so a reset/allocate cycle settles on a single chunk and resetting becomes just resetting a pointer.
+    void reset() noexcept {
+      if (head_ == nullptr) {
+        return;
+      }
+
+      auto* newest = head_;
+
+      head_ = newest->previous;
+      release_until(nullptr);
+
+      newest->previous = nullptr;
+      head_ = newest;
+      current_ = chunk_begin(newest);
+      end_ = chunk_end(newest);
+    }
+
+    /// Gets the total number of bytes obtained from `A` for chunks
+    ///
+    /// \return The number of bytes
+    [[nodiscard]] frt::usize capacity() const noexcept {
+      auto total = frt::usize{0};
+
+      for (auto* chunk = head_; chunk != nullptr; chunk = chunk->previous) {
+        total += chunk->size;
+      }
+
+      return total;
+    }
+
+    /// Gets the number of chunks currently owned by the arena
+    ///
+    /// \return The number of chunks
+    [[nodiscard]] frt::usize chunk_count() const noexcept {
+      auto count = frt::usize{0};
+
+      for (auto* chunk = head_; chunk != nullptr; chunk = chunk->previous) {
+        ++count;
+      }
+
+      return count;
+    }
 
   private:
-    A alloc_;
+    inline static constexpr frt::usize min_chunk_size = 256;
+
+    // room to place the header at an aligned address within whatever `A` gave back
+    inline static constexpr frt::usize chunk_overhead = sizeof(Chunk) + alignof(Chunk) - 1;
+
+    [[nodiscard]] FRT_ALWAYS_INLINE static frt::usize align_up(frt::usize address, frt::usize align) noexcept {
+      return (address + (align - 1)) & ~static_cast<frt::usize>(align - 1);
+    }
+
+    [[nodiscard]] static frt::ubyte* chunk_begin(Chunk* chunk) noexcept {
+      return reinterpret_cast<frt::ubyte*>(chunk + 1);
+    }
+
+    [[nodiscard]] static frt::ubyte* chunk_end(Chunk* chunk) noexcept {
+      return frt::to_address(chunk->storage) + chunk->size;
+    }
+
+    FRT_COLD void* allocate_slow(frt::usize size, frt::usize align) noexcept {
+      // worst case for fitting the allocation in a fresh chunk
+      auto needed = size + (align - 1) + chunk_overhead;
+
+      if (needed < size) {
+        return nullptr;
+      }
+
+      auto chunk_size = next_chunk_size_ < needed ? needed : next_chunk_size_;
+      auto storage = alloc_.allocate(static_cast<typename ByteTraits::size_type>(chunk_size));
+
+      if (storage == nullptr) {
+        return nullptr;
+      }
+
+      auto* header = reinterpret_cast<Chunk*>(align_up(reinterpret_cast<frt::usize>(frt::to_address(storage)),
+          alignof(Chunk)));
+
+      head_ = frt::construct_at(header, Chunk{head_, storage, chunk_size});
+      current_ = chunk_begin(head_);
+      end_ = chunk_end(head_);
+
+      if (next_chunk_size_ < max_chunk_size) {
+        next_chunk_size_ *= 2;
+      }
+
+      return allocate(size, align);
+    }
+
+    void release(Chunk* chunk) noexcept {
+      auto storage = chunk->storage;
+      auto size = chunk->size;
+
+      alloc_.deallocate(storage, static_cast<typename ByteTraits::size_type>(size));
+    }
+
+    // gives back every chunk newer than `last`, or every chunk if `last` is null
+    void release_until(Chunk* last) noexcept {
+      while (head_ != last) {
+        auto* previous = head_->previous;
+
+        release(head_);
+        head_ = previous;
+      }
+    }
+
+    ByteAlloc alloc_;
+    Chunk* head_ = nullptr;
+    frt::ubyte* current_ = nullptr;
+    frt::ubyte* end_ = nullptr;
+    frt::usize next_chunk_size_;
   };
-} // namespace frt
\ No newline at end of file
+} // namespace frt
@@ -0,0 +1,348 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include "../platform/cache.h"
+#include "../platform/macros.h"
+#include "../runtime/assert.h"
+#include "../sync/atomic.h"
+#include "../types/basic.h"
+#include "../types/move.h"
+#include "../types/traits.h"
+#include "../utility/construct.h"
+#include "./allocator.h"
+#include "./bit.h"
+#include "./pointers.h"
+
+namespace frt {
+  /// A lock-free arena that any number of threads can allocate from at once. Like `BumpAllocator`,
+  /// memory is only ever given back all at once, so it's meant for lots of small objects that all die
+  /// together (e.g. the nodes built by a parallel parse).
+  ///
+  /// Allocating is a single `fetch_add` on the current chunk's cursor. When a chunk runs out, whichever
+  /// threads notice first each obtain a new chunk (twice the size of the last, up to `max_chunk_size`)
+  /// and race to install it with a CAS. The winner's chunk becomes the current one and the losers give
+  /// theirs back and allocate from it instead. Requests too big for a chunk get one to themselves, which
+  /// is kept on a separate list so the current chunk keeps being used.
+  ///
+  /// `A` is called from whichever thread needs a new chunk, so it has to be thread-safe itself.
+  ///
+  /// `allocate` and the statistics are safe to call concurrently. `reset` and destruction are not, every
+  /// other thread has to be done with the arena first.
+  ///
+  /// \tparam A The allocator to obtain chunks from, rebound to `frt::ubyte`
+  template <Allocator A> class ConcurrentBumpAllocator {
+    using ByteAlloc = typename AllocatorTraits<A>::template rebind_alloc<frt::ubyte>;
+    using ByteTraits = AllocatorTraits<ByteAlloc>;
+    using BytePtr = typename ByteTraits::pointer;
+
+    // lives at the (aligned) beginning of each chunk. allocations start on the next cache line, so that
+    // bumping `used` doesn't contend with whoever is writing to the first objects in the chunk
+    struct Chunk {
+      Chunk(frt::usize used, BytePtr storage, frt::usize size, frt::usize capacity) noexcept
+          : used{used},
+            storage{storage},
+            size{size},
+            capacity{capacity} {}
+
+      frt::Atomic<frt::usize> used; // can go past `capacity` when allocations fail
+      Chunk* previous = nullptr;
+      BytePtr storage;
+      frt::usize size;
+      frt::usize capacity;
+    };
+
+  public:
+    /// The default size of the first chunk obtained from `A`, in bytes
+    inline static constexpr frt::usize default_chunk_size = 4096;
+
+    /// The size that chunks stop growing at, in bytes. Single allocations that don't fit in a chunk
+    /// this big still work, they just get a chunk to themselves.
+    inline static constexpr frt::usize max_chunk_size = frt::usize{1} << 26;
+
+    /// The alignment given to allocations that don't ask for one. Every allocation is rounded up
+    /// to a multiple of this, so the cursor never needs to be realigned.
+    inline static constexpr frt::usize default_alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+    /// Creates an arena. No memory is obtained from `alloc` until the first allocation.
+    ///
+    /// \param first_chunk_size The size of the first chunk to obtain from `alloc`
+    /// \param alloc The allocator to obtain chunks from
+    explicit ConcurrentBumpAllocator(frt::usize first_chunk_size = default_chunk_size, A alloc = A{}) noexcept
+        : alloc_{internal::rebind_allocator<frt::ubyte>(frt::move(alloc))},
+          first_chunk_size_{first_chunk_size < min_chunk_size ? min_chunk_size : first_chunk_size} {}
+
+    // other threads hold on to the arena by address, so it can't move
+    ConcurrentBumpAllocator(const ConcurrentBumpAllocator&) = delete;
+
+    ConcurrentBumpAllocator& operator=(const ConcurrentBumpAllocator&) = delete;
+
+    ~ConcurrentBumpAllocator() {
+      release_list(head());
+      release_list(oversized());
+    }
+
+    /// Allocates `size` bytes aligned to `align`. Safe to call from any number of threads at once.
+    ///
+    /// \param size The number of bytes to allocate
+    /// \param align The alignment of the allocation, must be a power of two
+    /// \return A pointer to the memory, or `nullptr` if `A` failed to provide a new chunk
+    [[nodiscard]] FRT_ALWAYS_INLINE void* allocate(frt::usize size, frt::usize align = default_alignment) noexcept {
+      FRT_ASSERT(frt::has_single_bit(align), "alignment must be a power of two");
+
+      auto* chunk = head();
+      auto padded = padded_size(size, align);
+
+      if (FRT_LIKELY(chunk != nullptr && padded <= chunk->capacity)) {
+        auto offset = chunk->used.fetch_add(padded, frt::memory_order_relaxed);
+
+        if (FRT_LIKELY(offset <= chunk->capacity - padded)) {
+          return place(chunk, offset, align);
+        }
+      }
+
+      return allocate_slow(chunk, padded, align);
+    }
+
+    /// Allocates uninitialized storage for `count` objects of type `T`.
+    ///
+    /// \param count The number of objects
+    /// \return A pointer to the storage, or `nullptr` if `A` failed to provide a new chunk
+    template <typename T> [[nodiscard]] FRT_ALWAYS_INLINE T* allocate(frt::usize count = 1) noexcept {
+      if (FRT_UNLIKELY(count > static_cast<frt::usize>(-1) / sizeof(T))) {
+        return nullptr;
+      }
+
+      return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    /// Does nothing, memory is only reclaimed by `reset` or destruction. This exists so that
+    /// the arena can be used through an `AllocRef`.
+    FRT_ALWAYS_INLINE void deallocate(void* /*unused*/, frt::usize /*unused*/) noexcept {}
+
+    /// Frees everything that has been allocated. The current chunk is kept around for future
+    /// allocations, every other chunk is given back to `A`.
+    ///
+    /// This is **not** thread-safe, nothing else can be using the arena at the same time.
+    void reset() noexcept {
+      auto* current = head();
+
+      release_list(oversized());
+      oversized_.store(0, frt::memory_order_relaxed);
+
+      if (current != nullptr) {
+        release_list(current->previous);
+        current->previous = nullptr;
+        current->used.store(0, frt::memory_order_relaxed);
+      }
+    }
+
+    /// Gets the total number of bytes obtained from `A` for chunks. If other threads are
+    /// allocating, this might not include chunks that were just installed.
+    ///
+    /// \return The number of bytes
+    [[nodiscard]] frt::usize capacity() const noexcept {
+      return sum_list(head(), true) + sum_list(oversized(), true);
+    }
+
+    /// Gets the number of chunks currently owned by the arena. If other threads are allocating,
+    /// this might not include chunks that were just installed.
+    ///
+    /// \return The number of chunks
+    [[nodiscard]] frt::usize chunk_count() const noexcept {
+      return sum_list(head(), false) + sum_list(oversized(), false);
+    }
+
+  private:
+    inline static constexpr frt::usize min_chunk_size = 256;
+
+    inline static constexpr frt::usize payload_alignment = frt::hardware_destructive_interference_size;
+
+    static_assert(payload_alignment % default_alignment == 0, "chunk payloads need to be aligned for any request");
+
+    // room to place the header at an aligned address within whatever `A` gave back, and then
+    // start the payload on its own cache line
+    inline static constexpr frt::usize chunk_overhead = alignof(Chunk) - 1 + sizeof(Chunk) + payload_alignment - 1;
+
+    [[nodiscard]] FRT_ALWAYS_INLINE static frt::usize align_up(frt::usize address, frt::usize align) noexcept {
+      return (address + (align - 1)) & ~static_cast<frt::usize>(align - 1);
+    }
+
+    // the space a request takes out of a chunk: a multiple of `default_alignment` to keep the cursor aligned, plus
+    // enough slack to realign within it for bigger alignments. saturates instead of overflowing, so that huge
+    // requests never fit in a chunk
+    [[nodiscard]] FRT_ALWAYS_INLINE static constexpr frt::usize padded_size(frt::usize size,
+        frt::usize align) noexcept {
+      auto extra = (default_alignment - 1) + (align > default_alignment ? align - default_alignment : 0);
+
+      return size > ~frt::usize{0} - extra ? ~frt::usize{0} : (size + extra) & ~(default_alignment - 1);
+    }
+
+    [[nodiscard]] FRT_ALWAYS_INLINE static frt::ubyte* chunk_begin(Chunk* chunk) noexcept {
+      return reinterpret_cast<frt::ubyte*>(align_up(reinterpret_cast<frt::usize>(chunk + 1), payload_alignment));
+    }
+
+    [[nodiscard]] FRT_ALWAYS_INLINE static void* place(Chunk* chunk, frt::usize offset, frt::usize align) noexcept {
+      return reinterpret_cast<void*>(align_up(reinterpret_cast<frt::usize>(chunk_begin(chunk) + offset), align));
+    }
+
+    [[nodiscard]] FRT_ALWAYS_INLINE static Chunk* to_chunk(frt::usize address) noexcept {
+      return reinterpret_cast<Chunk*>(address);
+    }
+
+    [[nodiscard]] FRT_ALWAYS_INLINE static frt::usize to_address(Chunk* chunk) noexcept {
+      return reinterpret_cast<frt::usize>(chunk);
+    }
+
+    [[nodiscard]] FRT_ALWAYS_INLINE Chunk* head() const noexcept {
+      return to_chunk(head_.load(frt::memory_order_acquire));
+    }
+
+    [[nodiscard]] FRT_ALWAYS_INLINE Chunk* oversized() const noexcept {
+      return to_chunk(oversized_.load(frt::memory_order_acquire));
+    }
+
+    [[nodiscard]] static constexpr frt::usize next_chunk_size(frt::usize size) noexcept {
+      return size < max_chunk_size ? size * 2 : size;
+    }
+
+    // `seen` is the chunk that the fast path failed to allocate from (if there was one)
+    FRT_COLD void* allocate_slow(Chunk* seen, frt::usize padded, frt::usize align) noexcept {
+      if (padded == ~frt::usize{0}) {
+        return nullptr;
+      }
+
+      while (true) {
+        // when a chunk fills up every thread allocating from it ends up here at once, but only one of them needs
+        // to get a new chunk from `A`. if another thread already installed one, try that instead
+        if (auto* current = head(); current != seen) {
+          seen = current;
+
+          if (auto* result = try_claim(seen, padded, align); result != nullptr) {
+            return result;
+          }
+
+          continue;
+        }
+
+        auto size = seen == nullptr ? first_chunk_size_ : next_chunk_size(seen->size);
+
+        if (padded > size - chunk_overhead) {
+          return allocate_oversized(padded, align);
+        }
+
+        // the block is claimed before the chunk is published, nobody else can take it
+        auto* chunk = make_chunk(size, padded);
+
+        if (chunk == nullptr) {
+          return nullptr;
+        }
+
+        chunk->previous = seen;
+
+        auto expected = to_address(seen);
+
+        if (head_.compare_exchange_strong(expected,
+                to_address(chunk),
+                frt::memory_order_acq_rel,
+                frt::memory_order_acquire)) {
+          return place(chunk, 0, align);
+        }
+
+        // another thread installed a chunk between the check above and here, use that one instead
+        release(chunk);
+      }
+    }
+
+    // tries to take a block out of a chunk that's already been published
+    [[nodiscard]] static void* try_claim(Chunk* chunk, frt::usize padded, frt::usize align) noexcept {
+      if (chunk == nullptr || padded > chunk->capacity) {
+        return nullptr;
+      }
+
+      auto offset = chunk->used.fetch_add(padded, frt::memory_order_relaxed);
+
+      return offset <= chunk->capacity - padded ? place(chunk, offset, align) : nullptr;
+    }
+
+    FRT_COLD void* allocate_oversized(frt::usize padded, frt::usize align) noexcept {
+      if (padded > ~frt::usize{0} - chunk_overhead) {
+        return nullptr;
+      }
+
+      auto* chunk = make_chunk(padded + chunk_overhead, padded);
+
+      if (chunk == nullptr) {
+        return nullptr;
+      }
+
+      // only ever pushed to while threads are allocating, so there's no ABA to worry about
+      auto expected = oversized_.load(frt::memory_order_relaxed);
+
+      do {
+        chunk->previous = to_chunk(expected);
+      } while (!oversized_.compare_exchange_weak(expected,
+          to_address(chunk),
+          frt::memory_order_release,
+          frt::memory_order_relaxed));
+
+      return place(chunk, 0, align);
+    }
+
+    [[nodiscard]] Chunk* make_chunk(frt::usize size, frt::usize used) noexcept {
+      auto storage = alloc_.allocate(static_cast<typename ByteTraits::size_type>(size));
+
+      if (storage == nullptr) {
+        return nullptr;
+      }
+
+      auto* header = reinterpret_cast<Chunk*>(align_up(reinterpret_cast<frt::usize>(frt::to_address(storage)),
+          alignof(Chunk)));
+      auto* begin = chunk_begin(header);
+      auto capacity = static_cast<frt::usize>(frt::to_address(storage) + size - begin);
+
+      return frt::construct_at(header, used, storage, size, capacity);
+    }
+
+    void release(Chunk* chunk) noexcept {
+      auto storage = chunk->storage;
+      auto size = chunk->size;
+
+      alloc_.deallocate(storage, static_cast<typename ByteTraits::size_type>(size));
+    }
+
+    // gives back `first` and every chunk before it
+    void release_list(Chunk* first) noexcept {
+      while (first != nullptr) {
+        auto* previous = first->previous;
+
+        release(first);
+        first = previous;
+      }
+    }
+
+    // either the total size of a list of chunks, or the number of chunks in it
+    [[nodiscard]] static frt::usize sum_list(Chunk* first, bool sizes) noexcept {
+      auto total = frt::usize{0};
+
+      for (auto* chunk = first; chunk != nullptr; chunk = chunk->previous) {
+        total += sizes ? chunk->size : 1;
+      }
+
+      return total;
+    }
+
+    ByteAlloc alloc_;
+    frt::usize first_chunk_size_;
+    frt::Atomic<frt::usize> head_;
+    frt::Atomic<frt::usize> oversized_;
+  };
+} // namespace frt
@@ -0,0 +1,1188 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include "../../platform/architecture.h"
+#include "../../platform/macros.h"
+#include "../../types/basic.h"
+
+#if defined(FRT_ARCH_X86_64)
+#include <immintrin.h>
+#elif defined(FRT_ARCH_ARM64)
+#include <arm_neon.h>
+#endif
+
+#if defined(FRT_ARCH_X86_64) || defined(FRT_ARCH_ARM64)
+#define FRT_MEM_HAS_STREAMING_STORES
+#endif
+
+#ifndef FRT_MEM_STREAMING_THRESHOLD
+#define FRT_MEM_STREAMING_THRESHOLD 4194304
+#endif
+
+// each ISA that the kernels get compiled for gets its own inline namespace. the kernels are compiled into FRT once per
+// ISA that it dispatches between, and with `FRT_INLINE_MEM_INTRINS` they're also compiled into user code with whatever
+// flags the user has. without this those would all be different definitions of the same inline functions
+#if defined(FRT_ARCH_X86_64) && defined(__AVX2__)
+#define FRT_MEM_ISA_NAMESPACE avx2
+#elif defined(FRT_ARCH_X86_64) && defined(__AVX__)
+#define FRT_MEM_ISA_NAMESPACE avx
+#else
+#define FRT_MEM_ISA_NAMESPACE baseline
+#endif
+
+//
+// NOTE: these are the kernels that `__frt_mem_*` are built out of. this is an implementation detail of
+// <frt/core/memory.h>, include that instead of this.
+//
+// the implementations of `__frt_mem_*` need to be built with `-ffreestanding` and loop idiom recognition
+// disabled (see src/CMakeLists.txt). if the compiler is allowed to pattern-match the loops below, it will happily
+// turn them back into calls to `memcpy`/`memset`, which are aliases for these functions when FRT generates the
+// intrinsics. anywhere else that's harmless, and the `*_up_to_64` kernels don't have any loops to begin with.
+//
+
+namespace frt::internal::mem {
+  inline namespace FRT_MEM_ISA_NAMESPACE {
+    // scalar types that are allowed to be unaligned and alias anything, loading/storing
+    // through these is how we do "unaligned load of N bytes" without calling `memcpy`
+    using UnalignedU16 = frt::u16 __attribute__((aligned(1), may_alias));
+    using UnalignedU32 = frt::u32 __attribute__((aligned(1), may_alias));
+    using UnalignedU64 = frt::u64 __attribute__((aligned(1), may_alias));
+
+    // `frt::countr_zero` and friends can't be used in here, <frt/core/bit.h> ends up including
+    // this header through <frt/core/memory.h>. these are the same thing, just spelled with builtins
+    template <typename T> FRT_ALWAYS_INLINE int trailing_zeros(T value) noexcept {
+      if (value == 0) {
+        return static_cast<int>(sizeof(T) * 8);
+      }
+
+      if constexpr (sizeof(T) <= sizeof(unsigned)) {
+        return __builtin_ctz(static_cast<unsigned>(value));
+      } else {
+        return __builtin_ctzll(static_cast<unsigned long long>(value));
+      }
+    }
+
+    template <typename T> FRT_ALWAYS_INLINE int leading_zeros(T value) noexcept {
+      if (value == 0) {
+        return static_cast<int>(sizeof(T) * 8);
+      }
+
+      if constexpr (sizeof(T) <= sizeof(unsigned)) {
+        return __builtin_clz(static_cast<unsigned>(value)) - static_cast<int>((sizeof(unsigned) - sizeof(T)) * 8);
+      } else {
+        return __builtin_clzll(static_cast<unsigned long long>(value));
+      }
+    }
+
+    template <typename T> FRT_ALWAYS_INLINE int population_count(T value) noexcept {
+      return __builtin_popcountll(static_cast<unsigned long long>(value));
+    }
+
+    // a block of `N` bytes that can be loaded from/stored to arbitrarily aligned memory. each specialization
+    // maps onto the widest registers available for that block size on the architecture being compiled for
+    template <frt::usize N> struct Block;
+
+    template <> struct Block<1> {
+      using Value = frt::ubyte;
+
+      FRT_ALWAYS_INLINE static Value splat(frt::ubyte byte) noexcept {
+        return byte;
+      }
+
+      FRT_ALWAYS_INLINE static Value load(const frt::ubyte* src) noexcept {
+        return *src;
+      }
+
+      FRT_ALWAYS_INLINE static void store(frt::ubyte* dst, Value value) noexcept {
+        *dst = value;
+      }
+    };
+
+    template <> struct Block<2> {
+      using Value = frt::u16;
+
+      FRT_ALWAYS_INLINE static Value splat(frt::ubyte byte) noexcept {
+        return static_cast<Value>(byte * Value{0x0101});
+      }
+
+      FRT_ALWAYS_INLINE static Value load(const frt::ubyte* src) noexcept {
+        return *reinterpret_cast<const UnalignedU16*>(src);
+      }
+
+      FRT_ALWAYS_INLINE static void store(frt::ubyte* dst, Value value) noexcept {
+        *reinterpret_cast<UnalignedU16*>(dst) = value;
+      }
+    };
+
+    template <> struct Block<4> {
+      using Value = frt::u32;
+
+      FRT_ALWAYS_INLINE static Value splat(frt::ubyte byte) noexcept {
+        return static_cast<Value>(byte * Value{0x01010101});
+      }
+
+      FRT_ALWAYS_INLINE static Value load(const frt::ubyte* src) noexcept {
+        return *reinterpret_cast<const UnalignedU32*>(src);
+      }
+
+      FRT_ALWAYS_INLINE static void store(frt::ubyte* dst, Value value) noexcept {
+        *reinterpret_cast<UnalignedU32*>(dst) = value;
+      }
+    };
+
+    template <> struct Block<8> {
+      using Value = frt::u64;
+
+      FRT_ALWAYS_INLINE static Value splat(frt::ubyte byte) noexcept {
+        return static_cast<Value>(byte * Value{0x0101010101010101});
+      }
+
+      FRT_ALWAYS_INLINE static Value load(const frt::ubyte* src) noexcept {
+        return *reinterpret_cast<const UnalignedU64*>(src);
+      }
+
+      FRT_ALWAYS_INLINE static void store(frt::ubyte* dst, Value value) noexcept {
+        *reinterpret_cast<UnalignedU64*>(dst) = value;
+      }
+    };
+
+    // if we don't have a native register for a block size, we emulate it with two of the next size down
+    template <frt::usize N> struct BlockPair {
+      struct Value {
+        typename Block<N / 2>::Value lo;
+        typename Block<N / 2>::Value hi;
+      };
+
+      FRT_ALWAYS_INLINE static Value splat(frt::ubyte byte) noexcept {
+        return Value{Block<N / 2>::splat(byte), Block<N / 2>::splat(byte)};
+      }
+
+      FRT_ALWAYS_INLINE static Value load(const frt::ubyte* src) noexcept {
+        return Value{Block<N / 2>::load(src), Block<N / 2>::load(src + N / 2)};
+      }
+
+      FRT_ALWAYS_INLINE static void store(frt::ubyte* dst, Value value) noexcept {
+        Block<N / 2>::store(dst, value.lo);
+        Block<N / 2>::store(dst + N / 2, value.hi);
+      }
+
+      FRT_ALWAYS_INLINE static void stream(frt::ubyte* dst, Value value) noexcept {
+        Block<N / 2>::stream(dst, value.lo);
+        Block<N / 2>::stream(dst + N / 2, value.hi);
+      }
+    };
+
+#if defined(FRT_ARCH_X86_64)
+    // SSE2 is part of the x86-64 baseline, we can always use it
+    template <> struct Block<16> {
+      using Value = __m128i;
+
+      FRT_ALWAYS_INLINE static Value splat(frt::ubyte byte) noexcept {
+        return _mm_set1_epi8(static_cast<char>(byte));
+      }
+
+      FRT_ALWAYS_INLINE static Value load(const frt::ubyte* src) noexcept {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+      }
+
+      FRT_ALWAYS_INLINE static void store(frt::ubyte* dst, Value value) noexcept {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), value);
+      }
+
+      // `dst` must be 16-byte aligned
+      FRT_ALWAYS_INLINE static void stream(frt::ubyte* dst, Value value) noexcept {
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst), value);
+      }
+    };
+#elif defined(FRT_ARCH_ARM64)
+    // NEON (AdvSIMD) is mandatory on AArch64
+    template <> struct Block<16> {
+      using Value = uint8x16_t;
+
+      FRT_ALWAYS_INLINE static Value splat(frt::ubyte byte) noexcept {
+        return vdupq_n_u8(byte);
+      }
+
+      FRT_ALWAYS_INLINE static Value load(const frt::ubyte* src) noexcept {
+        return vld1q_u8(src);
+      }
+
+      FRT_ALWAYS_INLINE static void store(frt::ubyte* dst, Value value) noexcept {
+        vst1q_u8(dst, value);
+      }
+    };
+#else
+    template <> struct Block<16> : BlockPair<16> {};
+#endif
+
+#if defined(FRT_ARCH_X86_64) && defined(__AVX__)
+    template <> struct Block<32> {
+      using Value = __m256i;
+
+      FRT_ALWAYS_INLINE static Value splat(frt::ubyte byte) noexcept {
+        return _mm256_set1_epi8(static_cast<char>(byte));
+      }
+
+      FRT_ALWAYS_INLINE static Value load(const frt::ubyte* src) noexcept {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+      }
+
+      FRT_ALWAYS_INLINE static void store(frt::ubyte* dst, Value value) noexcept {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), value);
+      }
+
+      // `dst` must be 32-byte aligned
+      FRT_ALWAYS_INLINE static void stream(frt::ubyte* dst, Value value) noexcept {
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst), value);
+      }
+    };
+#elif defined(FRT_ARCH_ARM64)
+    template <> struct Block<32> : BlockPair<32> {
+      // AArch64 only has a non-temporal hint on the pair instructions, so we stream a whole 32 bytes at once
+      FRT_ALWAYS_INLINE static void stream(frt::ubyte* dst, Value value) noexcept {
+        asm volatile("stnp %q1, %q2, [%0]" : : "r"(dst), "w"(value.lo), "w"(value.hi) : "memory");
+      }
+    };
+#else
+    template <> struct Block<32> : BlockPair<32> {};
+#endif
+
+    // copies exactly `N` bytes
+    template <frt::usize N> FRT_ALWAYS_INLINE void copy_block(frt::ubyte* dst, const frt::ubyte* src) noexcept {
+      Block<N>::store(dst, Block<N>::load(src));
+    }
+
+    // copies anywhere in `[N, 2N]` bytes with two possibly-overlapping blocks, one anchored at
+    // the start and one anchored at the end. both loads happen before either store
+    template <frt::usize N>
+    FRT_ALWAYS_INLINE void copy_head_tail(frt::ubyte* dst, const frt::ubyte* src, frt::usize length) noexcept {
+      auto head = Block<N>::load(src);
+      auto tail = Block<N>::load(src + length - N);
+
+      Block<N>::store(dst, head);
+      Block<N>::store(dst + length - N, tail);
+    }
+
+    // copies `[0, 16]` bytes
+    FRT_ALWAYS_INLINE void copy_small(frt::ubyte* dst, const frt::ubyte* src, frt::usize length) noexcept {
+      if (length >= 8) {
+        copy_head_tail<8>(dst, src, length);
+      } else if (length >= 4) {
+        copy_head_tail<4>(dst, src, length);
+      } else if (length >= 2) {
+        copy_head_tail<2>(dst, src, length);
+      } else if (length == 1) {
+        copy_block<1>(dst, src);
+      }
+    }
+
+    // copies `(64, 256]` bytes, with unaligned 32-byte blocks and a final overlapping block
+    FRT_ALWAYS_INLINE void copy_medium(frt::ubyte* dst, const frt::ubyte* src, frt::usize length) noexcept {
+      auto tail = Block<32>::load(src + length - 32);
+
+      for (frt::usize i = 0; i < length - 32; i += 32) {
+        copy_block<32>(dst + i, src + i);
+      }
+
+      Block<32>::store(dst + length - 32, tail);
+    }
+
+#if defined(FRT_MEM_HAS_STREAMING_STORES)
+    // anything at least this large is big enough that caching it would evict more useful data than
+    // it's worth, it gets written with non-temporal stores. configured with `FRT_MEM_STREAMING_THRESHOLD`
+    inline constexpr frt::usize streaming_threshold = FRT_MEM_STREAMING_THRESHOLD;
+#endif
+
+    // non-temporal stores are weakly ordered, this makes them visible before any stores after the fence
+    FRT_ALWAYS_INLINE void stream_fence() noexcept {
+#if defined(FRT_ARCH_X86_64)
+      _mm_sfence();
+#elif defined(FRT_ARCH_ARM64)
+      asm volatile("dmb ishst" : : : "memory");
+#else
+      // nothing is ever streamed here, but this still needs to exist for the `Stream` kernels to compile
+      asm volatile("" : : : "memory");
+#endif
+    }
+
+    // copies more than 256 bytes. the destination is aligned so that at worst only the loads are
+    // split across cache lines, and the loop is unrolled to keep multiple loads in flight. if `Stream`
+    // is set, the aligned body is written with non-temporal stores like `set_large`
+    template <bool Stream = false>
+    FRT_ALWAYS_INLINE void copy_large(frt::ubyte* dst, const frt::ubyte* src, frt::usize length) noexcept {
+      auto head = Block<32>::load(src);
+      auto tail = Block<32>::load(src + length - 32);
+      auto* const dst_end = dst + length;
+      auto skip = 32 - (reinterpret_cast<frt::usize>(dst) & 31);
+
+      Block<32>::store(dst, head);
+      dst += skip;
+      src += skip;
+      length -= skip;
+
+      for (; length > 128; length -= 128, dst += 128, src += 128) {
+        auto a = Block<32>::load(src);
+        auto b = Block<32>::load(src + 32);
+        auto c = Block<32>::load(src + 64);
+        auto d = Block<32>::load(src + 96);
+
+        if constexpr (Stream) {
+          Block<32>::stream(dst, a);
+          Block<32>::stream(dst + 32, b);
+          Block<32>::stream(dst + 64, c);
+          Block<32>::stream(dst + 96, d);
+        } else {
+          Block<32>::store(dst, a);
+          Block<32>::store(dst + 32, b);
+          Block<32>::store(dst + 64, c);
+          Block<32>::store(dst + 96, d);
+        }
+      }
+
+      for (; length > 32; length -= 32, dst += 32, src += 32) {
+        copy_block<32>(dst, src);
+      }
+
+      Block<32>::store(dst_end - 32, tail);
+
+      if constexpr (Stream) {
+        stream_fence();
+      }
+    }
+
+#if defined(FRT_ARCH_X86_64)
+    // past this size, `rep movsb` beats the vector loop on anything with ERMS (Ivy Bridge+, Zen+)
+    // since the microcode is able to use full cache-line stores and skip RFOs
+    inline constexpr frt::usize rep_movsb_erms_threshold = 2048;
+
+    // with FSRM (Ice Lake+, Zen 3+) the startup cost is low enough that it wins for the entire large size class
+    inline constexpr frt::usize rep_movsb_fsrm_threshold = 257;
+
+    // without runtime dispatch we can't check for ERMS, but it's been around for long enough to assume it
+    inline constexpr frt::usize rep_movsb_default_threshold = rep_movsb_erms_threshold;
+
+    FRT_ALWAYS_INLINE void copy_rep_movsb(frt::ubyte* dst, const frt::ubyte* src, frt::usize length) noexcept {
+      asm volatile("rep movsb" : "+D"(dst), "+S"(src), "+c"(length) : : "memory");
+    }
+#else
+    inline constexpr frt::usize rep_movsb_default_threshold = 0;
+#endif
+
+    // the largest size that the `frt::mem_*` wrappers handle inline with `FRT_INLINE_MEM_INTRINS`,
+    // anything bigger than this has loops and goes out-of-line instead
+    inline constexpr frt::usize inline_size_limit = 64;
+
+    // copies `[0, 64]` bytes. every size class in here does all of its loads before any of its
+    // stores, so this is also a correct `memmove` for anything in that range
+    FRT_ALWAYS_INLINE void copy_up_to_64(frt::ubyte* dst, const frt::ubyte* src, frt::usize length) noexcept {
+      if (FRT_LIKELY(length <= 16)) {
+        copy_small(dst, src, length);
+      } else if (length <= 32) {
+        copy_head_tail<16>(dst, src, length);
+      } else {
+        copy_head_tail<32>(dst, src, length);
+      }
+    }
+
+    // `RepMovsbThreshold` is the size at which `rep movsb` takes over from the vector loop, `0` means never
+    template <frt::usize RepMovsbThreshold = rep_movsb_default_threshold>
+    FRT_ALWAYS_INLINE void copy_bytes(frt::ubyte* dst, const frt::ubyte* src, frt::usize length) noexcept {
+      if (FRT_LIKELY(length <= 64)) {
+        copy_up_to_64(dst, src, length);
+      } else if (length <= 256) {
+        copy_medium(dst, src, length);
+      } else {
+#if defined(FRT_ARCH_X86_64)
+        if constexpr (RepMovsbThreshold != 0) {
+          if (length >= RepMovsbThreshold) {
+            copy_rep_movsb(dst, src, length);
+
+            return;
+          }
+        }
+#endif
+
+        copy_large(dst, src, length);
+      }
+    }
+
+    // moves more than 64 bytes where `dst < src` and the ranges overlap. the last block is loaded
+    // before anything is stored since the stores may clobber it, every other block is loaded before
+    // any store that could touch it because the destination trails the source
+    FRT_ALWAYS_INLINE void move_forward(frt::ubyte* dst, const frt::ubyte* src, frt::usize length) noexcept {
+      auto tail = Block<32>::load(src + length - 32);
+      auto* const dst_end = dst + length;
+
+      for (; length > 128; length -= 128, dst += 128, src += 128) {
+        auto a = Block<32>::load(src);
+        auto b = Block<32>::load(src + 32);
+        auto c = Block<32>::load(src + 64);
+        auto d = Block<32>::load(src + 96);
+
+        Block<32>::store(dst, a);
+        Block<32>::store(dst + 32, b);
+        Block<32>::store(dst + 64, c);
+        Block<32>::store(dst + 96, d);
+      }
+
+      for (; length > 32; length -= 32, dst += 32, src += 32) {
+        copy_block<32>(dst, src);
+      }
+
+      Block<32>::store(dst_end - 32, tail);
+    }
+
+    // moves more than 64 bytes where `dst > src` and the ranges overlap, mirror image of `move_forward`
+    FRT_ALWAYS_INLINE void move_backward(frt::ubyte* dst, const frt::ubyte* src, frt::usize length) noexcept {
+      auto head = Block<32>::load(src);
+      auto* const dst_begin = dst;
+
+      dst += length;
+      src += length;
+
+      for (; length > 128; length -= 128) {
+        dst -= 128;
+        src -= 128;
+
+        auto a = Block<32>::load(src + 96);
+        auto b = Block<32>::load(src + 64);
+        auto c = Block<32>::load(src + 32);
+        auto d = Block<32>::load(src);
+
+        Block<32>::store(dst + 96, a);
+        Block<32>::store(dst + 64, b);
+        Block<32>::store(dst + 32, c);
+        Block<32>::store(dst, d);
+      }
+
+      for (; length > 32; length -= 32) {
+        dst -= 32;
+        src -= 32;
+
+        copy_block<32>(dst, src);
+      }
+
+      Block<32>::store(dst_begin, head);
+    }
+
+    template <frt::usize RepMovsbThreshold = rep_movsb_default_threshold>
+    FRT_ALWAYS_INLINE void move_bytes(frt::ubyte* dst, const frt::ubyte* src, frt::usize length) noexcept {
+      // the small copy classes are overlap-safe without needing to know which direction we're going
+      if (FRT_LIKELY(length <= 64)) {
+        copy_up_to_64(dst, src, length);
+      } else {
+        auto distance = reinterpret_cast<frt::usize>(dst) - reinterpret_cast<frt::usize>(src);
+
+        // unsigned wraparound makes this a check for `|dst - src| >= length`, i.e. no overlap at all.
+        // this is by far the most common case, and gets us the fastest copy kernel
+        if (distance >= length && -distance >= length) {
+          copy_bytes<RepMovsbThreshold>(dst, src, length);
+        } else if (dst < src) {
+          move_forward(dst, src, length);
+        } else if (dst > src) {
+          move_backward(dst, src, length);
+        }
+      }
+    }
+
+    // sets anywhere in `[N, 2N]` bytes with two possibly-overlapping blocks
+    template <frt::usize N>
+    FRT_ALWAYS_INLINE void set_head_tail(frt::ubyte* dst, frt::ubyte value, frt::usize length) noexcept {
+      auto splat = Block<N>::splat(value);
+
+      Block<N>::store(dst, splat);
+      Block<N>::store(dst + length - N, splat);
+    }
+
+    // sets `[0, 16]` bytes
+    FRT_ALWAYS_INLINE void set_small(frt::ubyte* dst, frt::ubyte value, frt::usize length) noexcept {
+      if (length >= 8) {
+        set_head_tail<8>(dst, value, length);
+      } else if (length >= 4) {
+        set_head_tail<4>(dst, value, length);
+      } else if (length >= 2) {
+        set_head_tail<2>(dst, value, length);
+      } else if (length == 1) {
+        Block<1>::store(dst, value);
+      }
+    }
+
+    // sets `(64, 256]` bytes
+    FRT_ALWAYS_INLINE void set_medium(frt::ubyte* dst, frt::ubyte value, frt::usize length) noexcept {
+      auto splat = Block<32>::splat(value);
+
+      for (frt::usize i = 0; i < length - 32; i += 32) {
+        Block<32>::store(dst + i, splat);
+      }
+
+      Block<32>::store(dst + length - 32, splat);
+    }
+
+    // sets more than 256 bytes. an unaligned head store lets everything after it be aligned, and the
+    // unaligned tail store finishes off whatever is left. if `Stream` is set, the aligned body is written
+    // with non-temporal stores so that we don't drag the whole range through the cache
+    template <bool Stream>
+    FRT_ALWAYS_INLINE void set_large(frt::ubyte* dst, frt::ubyte value, frt::usize length) noexcept {
+      auto splat = Block<32>::splat(value);
+      auto* const dst_end = dst + length;
+      auto skip = 32 - (reinterpret_cast<frt::usize>(dst) & 31);
+
+      Block<32>::store(dst, splat);
+      dst += skip;
+      length -= skip;
+
+      for (; length > 128; length -= 128, dst += 128) {
+        if constexpr (Stream) {
+          Block<32>::stream(dst, splat);
+          Block<32>::stream(dst + 32, splat);
+          Block<32>::stream(dst + 64, splat);
+          Block<32>::stream(dst + 96, splat);
+        } else {
+          Block<32>::store(dst, splat);
+          Block<32>::store(dst + 32, splat);
+          Block<32>::store(dst + 64, splat);
+          Block<32>::store(dst + 96, splat);
+        }
+      }
+
+      for (; length > 32; length -= 32, dst += 32) {
+        Block<32>::store(dst, splat);
+      }
+
+      Block<32>::store(dst_end - 32, splat);
+
+      if constexpr (Stream) {
+        stream_fence();
+      }
+    }
+
+    // sets `[0, 64]` bytes
+    FRT_ALWAYS_INLINE void set_up_to_64(frt::ubyte* dst, frt::ubyte value, frt::usize length) noexcept {
+      if (FRT_LIKELY(length <= 16)) {
+        set_small(dst, value, length);
+      } else if (length <= 32) {
+        set_head_tail<16>(dst, value, length);
+      } else {
+        set_head_tail<32>(dst, value, length);
+      }
+    }
+
+    FRT_ALWAYS_INLINE void set_bytes(frt::ubyte* dst, frt::ubyte value, frt::usize length) noexcept {
+      if (FRT_LIKELY(length <= 64)) {
+        set_up_to_64(dst, value, length);
+      } else if (length <= 256) {
+        set_medium(dst, value, length);
+      } else {
+#if defined(FRT_MEM_HAS_STREAMING_STORES)
+        if (length >= streaming_threshold) {
+          set_large<true>(dst, value, length);
+
+          return;
+        }
+#endif
+
+        set_large<false>(dst, value, length);
+      }
+    }
+
+    // copies with non-temporal stores for everything past the size classes that are only a
+    // handful of stores anyway, this doesn't have a threshold like `set_bytes` does
+    FRT_ALWAYS_INLINE void copy_stream_bytes(frt::ubyte* dst, const frt::ubyte* src, frt::usize length) noexcept {
+#if defined(FRT_MEM_HAS_STREAMING_STORES)
+      if (length > 256) {
+        copy_large<true>(dst, src, length);
+
+        return;
+      }
+#endif
+
+      copy_bytes(dst, src, length);
+    }
+
+    // `set_bytes`, except anything past the small size classes is streamed regardless of the threshold
+    FRT_ALWAYS_INLINE void set_stream_bytes(frt::ubyte* dst, frt::ubyte value, frt::usize length) noexcept {
+#if defined(FRT_MEM_HAS_STREAMING_STORES)
+      if (length > 256) {
+        set_large<true>(dst, value, length);
+
+        return;
+      }
+#endif
+
+      set_bytes(dst, value, length);
+    }
+
+    // finds the index of the first byte that differs between `a` and `b` in a block of `N` bytes,
+    // or `N` if they're equal. for vector blocks, this is a compare + movemask and then `countr_zero`
+    // on the inverted mask, for scalar blocks it's an XOR and then `countr_zero`/`countl_zero`
+    template <frt::usize N> FRT_ALWAYS_INLINE frt::usize mismatch(const frt::ubyte* a, const frt::ubyte* b) noexcept {
+      if constexpr (N <= 8) {
+        auto diff = static_cast<typename Block<N>::Value>(Block<N>::load(a) ^ Block<N>::load(b));
+
+        // `countr_zero(0)` is the bit width, which conveniently makes this `N` when they're equal
+        if constexpr (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) {
+          return static_cast<frt::usize>(trailing_zeros(diff)) / 8;
+        } else {
+          return static_cast<frt::usize>(leading_zeros(diff)) / 8;
+        }
+      }
+#if defined(FRT_ARCH_X86_64)
+      else if constexpr (N == 16) {
+        auto eq = _mm_cmpeq_epi8(Block<16>::load(a), Block<16>::load(b));
+        auto mask = static_cast<frt::u32>(_mm_movemask_epi8(eq)) ^ 0xFFFFU;
+
+        return static_cast<frt::usize>(trailing_zeros(mask | 0x10000U));
+      }
+#elif defined(FRT_ARCH_ARM64)
+      else if constexpr (N == 16) {
+        // NEON doesn't have `movemask`, but narrowing the 16-bit lanes by 4 gets us 4 bits per byte in a `u64`
+        auto eq = vceqq_u8(Block<16>::load(a), Block<16>::load(b));
+        auto narrowed = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+        auto mask = ~vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+
+        return static_cast<frt::usize>(trailing_zeros(mask)) / 4;
+      }
+#endif
+#if defined(FRT_ARCH_X86_64) && defined(__AVX2__)
+      else if constexpr (N == 32) {
+        auto eq = _mm256_cmpeq_epi8(Block<32>::load(a), Block<32>::load(b));
+        auto mask = ~static_cast<frt::u32>(_mm256_movemask_epi8(eq));
+
+        return static_cast<frt::usize>(trailing_zeros(mask));
+      }
+#endif
+      else {
+        auto lo = mismatch<N / 2>(a, b);
+
+        return (lo != N / 2) ? lo : N / 2 + mismatch<N / 2>(a + N / 2, b + N / 2);
+      }
+    }
+
+    // checks if a block of `N` bytes is equal, without caring where the difference is
+    template <frt::usize N> FRT_ALWAYS_INLINE bool equal(const frt::ubyte* a, const frt::ubyte* b) noexcept {
+      if constexpr (N <= 8) {
+        return Block<N>::load(a) == Block<N>::load(b);
+      }
+#if defined(FRT_ARCH_X86_64)
+      else if constexpr (N == 16) {
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(Block<16>::load(a), Block<16>::load(b))) == 0xFFFF;
+      }
+#elif defined(FRT_ARCH_ARM64)
+      else if constexpr (N == 16) {
+        return vmaxvq_u8(veorq_u8(Block<16>::load(a), Block<16>::load(b))) == 0;
+      }
+#endif
+#if defined(FRT_ARCH_X86_64) && defined(__AVX2__)
+      else if constexpr (N == 32) {
+        auto diff = _mm256_xor_si256(Block<32>::load(a), Block<32>::load(b));
+
+        return _mm256_testz_si256(diff, diff) != 0;
+      }
+#endif
+      else {
+        // `&` instead of `&&`, both halves are cheap enough that a branch would cost more
+        return equal<N / 2>(a, b) & equal<N / 2>(a + N / 2, b + N / 2);
+      }
+    }
+
+    FRT_ALWAYS_INLINE int byte_difference(frt::ubyte a, frt::ubyte b) noexcept {
+      return static_cast<int>(a) - static_cast<int>(b);
+    }
+
+    // compares anywhere in `[N, 2N]` bytes with a block at the start and one at the end
+    template <frt::usize N>
+    FRT_ALWAYS_INLINE int compare_head_tail(const frt::ubyte* a, const frt::ubyte* b, frt::usize length) noexcept {
+      if (auto i = mismatch<N>(a, b); i != N) {
+        return byte_difference(a[i], b[i]);
+      }
+
+      a += length - N;
+      b += length - N;
+
+      if (auto i = mismatch<N>(a, b); i != N) {
+        return byte_difference(a[i], b[i]);
+      }
+
+      return 0;
+    }
+
+    // compares `[0, 16]` bytes
+    FRT_ALWAYS_INLINE int compare_small(const frt::ubyte* a, const frt::ubyte* b, frt::usize length) noexcept {
+      if (length >= 8) {
+        return compare_head_tail<8>(a, b, length);
+      } else if (length >= 4) {
+        return compare_head_tail<4>(a, b, length);
+      } else if (length >= 2) {
+        return compare_head_tail<2>(a, b, length);
+      } else if (length == 1) {
+        return byte_difference(*a, *b);
+      }
+
+      return 0;
+    }
+
+    // compares more than 64 bytes. the loop only checks for equality, and we go back
+    // to find out *where* the difference is only once we know that there is one
+    FRT_ALWAYS_INLINE int compare_large(const frt::ubyte* a, const frt::ubyte* b, frt::usize length) noexcept {
+      for (; length > 64; length -= 64, a += 64, b += 64) {
+        if (FRT_UNLIKELY(!equal<64>(a, b))) {
+          auto i = mismatch<64>(a, b);
+
+          return byte_difference(a[i], b[i]);
+        }
+      }
+
+      // `length` is now in `(0, 64]`, the last block may overlap with bytes we already checked
+      return compare_head_tail<32>(a + length - 64, b + length - 64, 64);
+    }
+
+    // compares `[0, 64]` bytes
+    FRT_ALWAYS_INLINE int compare_up_to_64(const frt::ubyte* a, const frt::ubyte* b, frt::usize length) noexcept {
+      if (FRT_LIKELY(length <= 16)) {
+        return compare_small(a, b, length);
+      } else if (length <= 32) {
+        return compare_head_tail<16>(a, b, length);
+      }
+
+      return compare_head_tail<32>(a, b, length);
+    }
+
+    FRT_ALWAYS_INLINE int compare_bytes(const frt::ubyte* a, const frt::ubyte* b, frt::usize length) noexcept {
+      if (FRT_LIKELY(length <= 64)) {
+        return compare_up_to_64(a, b, length);
+      } else if (a == b) {
+        return 0;
+      }
+
+      return compare_large(a, b, length);
+    }
+
+    // equality-only version of `compare_head_tail`
+    template <frt::usize N>
+    FRT_ALWAYS_INLINE bool equal_head_tail(const frt::ubyte* a, const frt::ubyte* b, frt::usize length) noexcept {
+      return equal<N>(a, b) & equal<N>(a + length - N, b + length - N);
+    }
+
+    // checks `[0, 64]` bytes for equality
+    FRT_ALWAYS_INLINE bool equal_up_to_64(const frt::ubyte* a, const frt::ubyte* b, frt::usize length) noexcept {
+      if (FRT_LIKELY(length <= 16)) {
+        if (length >= 8) {
+          return equal_head_tail<8>(a, b, length);
+        } else if (length >= 4) {
+          return equal_head_tail<4>(a, b, length);
+        } else if (length >= 2) {
+          return equal_head_tail<2>(a, b, length);
+        }
+
+        return length == 0 || *a == *b;
+      } else if (length <= 32) {
+        return equal_head_tail<16>(a, b, length);
+      }
+
+      return equal_head_tail<32>(a, b, length);
+    }
+
+    FRT_ALWAYS_INLINE bool equal_bytes(const frt::ubyte* a, const frt::ubyte* b, frt::usize length) noexcept {
+      if (FRT_LIKELY(length <= 64)) {
+        return equal_up_to_64(a, b, length);
+      } else if (a == b) {
+        return true;
+      }
+
+      for (; length > 64; length -= 64, a += 64, b += 64) {
+        if (!equal<64>(a, b)) {
+          return false;
+        }
+      }
+
+      return equal<64>(a + length - 64, b + length - 64);
+    }
+
+    // the widest block that the byte search kernels work on. `matches` compares every byte against a splatted
+    // needle and produces a mask with `1 << index_shift` bits per byte, the bits for byte `i` of the block
+    // starting at bit `i << index_shift`. `bits_per_match` of those bits are actually set for each match
+#if defined(FRT_ARCH_X86_64) && defined(__AVX2__)
+    struct ScanBlock : Block<32> {
+      using Mask = frt::u32;
+
+      static constexpr frt::usize size = 32;
+      static constexpr int index_shift = 0;
+      static constexpr int bits_per_match = 1;
+
+      FRT_ALWAYS_INLINE static Mask matches(Value block, Value needle) noexcept {
+        return static_cast<Mask>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+      }
+    };
+#elif defined(FRT_ARCH_X86_64)
+    struct ScanBlock : Block<16> {
+      using Mask = frt::u32;
+
+      static constexpr frt::usize size = 16;
+      static constexpr int index_shift = 0;
+      static constexpr int bits_per_match = 1;
+
+      FRT_ALWAYS_INLINE static Mask matches(Value block, Value needle) noexcept {
+        return static_cast<Mask>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+      }
+    };
+#elif defined(FRT_ARCH_ARM64)
+    struct ScanBlock : Block<16> {
+      using Mask = frt::u64;
+
+      static constexpr frt::usize size = 16;
+      static constexpr int index_shift = 2;
+      static constexpr int bits_per_match = 4;
+
+      // same narrowing trick as `mismatch<16>`, 4 bits per byte since there's no `movemask`
+      FRT_ALWAYS_INLINE static Mask matches(Value block, Value needle) noexcept {
+        auto eq = vceqq_u8(block, needle);
+        auto narrowed = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+
+        return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+      }
+    };
+#else
+    // no vectors, so this is a SWAR version on 64-bit words instead
+    struct ScanBlock : Block<8> {
+      using Mask = frt::u64;
+
+      static constexpr frt::usize size = 8;
+      static constexpr int index_shift = 3;
+      static constexpr int bits_per_match = 1;
+
+      // the mask logic assumes that lower addresses are in lower bits
+      FRT_ALWAYS_INLINE static Value load(const frt::ubyte* src) noexcept {
+        if constexpr (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) {
+          return Block<8>::load(src);
+        } else {
+          return __builtin_bswap64(Block<8>::load(src));
+        }
+      }
+
+      // sets the high bit of every byte that's equal, without the false positives that the
+      // usual `(x - 0x01...) & ~x` trick has after the first zero byte
+      FRT_ALWAYS_INLINE static Mask matches(Value block, Value needle) noexcept {
+        constexpr auto low_bits = Mask{0x7F7F7F7F7F7F7F7F};
+        auto x = block ^ needle;
+
+        return ~(((x & low_bits) + low_bits) | x | low_bits);
+      }
+    };
+#endif
+
+    // index of the first/last match in a non-zero mask
+    FRT_ALWAYS_INLINE frt::usize first_match(ScanBlock::Mask mask) noexcept {
+      return static_cast<frt::usize>(trailing_zeros(mask) >> ScanBlock::index_shift);
+    }
+
+    FRT_ALWAYS_INLINE frt::usize last_match(ScanBlock::Mask mask) noexcept {
+      constexpr auto top_bit = static_cast<int>(sizeof(ScanBlock::Mask) * 8 - 1);
+
+      return static_cast<frt::usize>((top_bit - leading_zeros(mask)) >> ScanBlock::index_shift);
+    }
+
+    FRT_ALWAYS_INLINE frt::usize count_matches(ScanBlock::Mask mask) noexcept {
+      return static_cast<frt::usize>(population_count(mask) / ScanBlock::bits_per_match);
+    }
+
+    // finds the first byte equal to `value`, or `nullptr`
+    FRT_ALWAYS_INLINE const frt::ubyte* find_byte_bytes(const frt::ubyte* src,
+        frt::ubyte value,
+        frt::usize length) noexcept {
+      constexpr auto n = ScanBlock::size;
+
+      if (length < n) {
+        for (frt::usize i = 0; i < length; ++i) {
+          if (src[i] == value) {
+            return src + i;
+          }
+        }
+
+        return nullptr;
+      }
+
+      auto needle = ScanBlock::splat(value);
+      auto* const last = src + length - n;
+
+      // 4 blocks at a time, only figuring out which block it was in once we know there's a match. distances are
+      // compared instead of pointers, `src + 4 * n` can be past the end of the buffer (or wrap around)
+      for (; static_cast<frt::usize>(last - src) >= 4 * n; src += 4 * n) {
+        auto a = ScanBlock::matches(ScanBlock::load(src), needle);
+        auto b = ScanBlock::matches(ScanBlock::load(src + n), needle);
+        auto c = ScanBlock::matches(ScanBlock::load(src + 2 * n), needle);
+        auto d = ScanBlock::matches(ScanBlock::load(src + 3 * n), needle);
+
+        if (FRT_UNLIKELY((a | b | c | d) != 0)) {
+          if (a != 0) {
+            return src + first_match(a);
+          } else if (b != 0) {
+            return src + n + first_match(b);
+          } else if (c != 0) {
+            return src + 2 * n + first_match(c);
+          }
+
+          return src + 3 * n + first_match(d);
+        }
+      }
+
+      for (; src < last; src += n) {
+        if (auto mask = ScanBlock::matches(ScanBlock::load(src), needle); mask != 0) {
+          return src + first_match(mask);
+        }
+      }
+
+      // the last block may overlap with bytes we already checked, but those didn't match
+      if (auto mask = ScanBlock::matches(ScanBlock::load(last), needle); mask != 0) {
+        return last + first_match(mask);
+      }
+
+      return nullptr;
+    }
+
+    // finds the last byte equal to `value`, or `nullptr`. mirror image of `find_byte_bytes`
+    FRT_ALWAYS_INLINE const frt::ubyte* rfind_byte_bytes(const frt::ubyte* src,
+        frt::ubyte value,
+        frt::usize length) noexcept {
+      constexpr auto n = ScanBlock::size;
+
+      if (length < n) {
+        for (auto i = length; i != 0; --i) {
+          if (src[i - 1] == value) {
+            return src + i - 1;
+          }
+        }
+
+        return nullptr;
+      }
+
+      auto needle = ScanBlock::splat(value);
+      auto* end = src + length;
+
+      for (; static_cast<frt::usize>(end - src) >= 4 * n; end -= 4 * n) {
+        auto a = ScanBlock::matches(ScanBlock::load(end - n), needle);
+        auto b = ScanBlock::matches(ScanBlock::load(end - 2 * n), needle);
+        auto c = ScanBlock::matches(ScanBlock::load(end - 3 * n), needle);
+        auto d = ScanBlock::matches(ScanBlock::load(end - 4 * n), needle);
+
+        if (FRT_UNLIKELY((a | b | c | d) != 0)) {
+          if (a != 0) {
+            return end - n + last_match(a);
+          } else if (b != 0) {
+            return end - 2 * n + last_match(b);
+          } else if (c != 0) {
+            return end - 3 * n + last_match(c);
+          }
+
+          return end - 4 * n + last_match(d);
+        }
+      }
+
+      for (; static_cast<frt::usize>(end - src) > n; end -= n) {
+        if (auto mask = ScanBlock::matches(ScanBlock::load(end - n), needle); mask != 0) {
+          return end - n + last_match(mask);
+        }
+      }
+
+      if (auto mask = ScanBlock::matches(ScanBlock::load(src), needle); mask != 0) {
+        return src + last_match(mask);
+      }
+
+      return nullptr;
+    }
+
+    // counts the bytes equal to `value`
+    FRT_ALWAYS_INLINE frt::usize count_byte_bytes(const frt::ubyte* src, frt::ubyte value, frt::usize length) noexcept {
+      constexpr auto n = ScanBlock::size;
+      auto count = frt::usize{0};
+
+      if (length < n) {
+        for (frt::usize i = 0; i < length; ++i) {
+          count += (src[i] == value) ? 1 : 0;
+        }
+
+        return count;
+      }
+
+      auto needle = ScanBlock::splat(value);
+      auto* const last = src + length - n;
+
+      for (; static_cast<frt::usize>(last - src) >= 4 * n; src += 4 * n) {
+        count += count_matches(ScanBlock::matches(ScanBlock::load(src), needle));
+        count += count_matches(ScanBlock::matches(ScanBlock::load(src + n), needle));
+        count += count_matches(ScanBlock::matches(ScanBlock::load(src + 2 * n), needle));
+        count += count_matches(ScanBlock::matches(ScanBlock::load(src + 3 * n), needle));
+      }
+
+      for (; src < last; src += n) {
+        count += count_matches(ScanBlock::matches(ScanBlock::load(src), needle));
+      }
+
+      // the last block overlaps with `src - last` bytes that were already counted, those get shifted out
+      auto overlap = static_cast<frt::usize>(src - last);
+      auto mask = ScanBlock::matches(ScanBlock::load(last), needle);
+
+      return count + count_matches(mask >> (overlap << ScanBlock::index_shift));
+    }
+
+    // the most bytes that `find_any_of_bytes` will search for with vector compares, a set larger than this
+    // is searched for with a lookup table instead since the compares would cost more than the table lookups
+    inline constexpr frt::usize small_set_limit = 16;
+
+    FRT_ALWAYS_INLINE ScanBlock::Mask matches_any(ScanBlock::Value block,
+        const ScanBlock::Value* needles,
+        frt::usize needle_count) noexcept {
+      auto mask = ScanBlock::Mask{0};
+
+      for (frt::usize i = 0; i < needle_count; ++i) {
+        mask |= ScanBlock::matches(block, needles[i]);
+      }
+
+      return mask;
+    }
+
+    // finds the first byte that's equal to any byte in `set`, or `nullptr`
+    FRT_ALWAYS_INLINE const frt::ubyte* find_any_of_bytes(const frt::ubyte* src,
+        frt::usize length,
+        const frt::ubyte* set,
+        frt::usize set_length) noexcept {
+      constexpr auto n = ScanBlock::size;
+
+      if (set_length == 0) {
+        return nullptr;
+      } else if (set_length == 1) {
+        return find_byte_bytes(src, *set, length);
+      }
+
+      if (set_length > small_set_limit || length < n) {
+        frt::u64 table[4] = {0, 0, 0, 0};
+
+        for (frt::usize i = 0; i < set_length; ++i) {
+          table[set[i] >> 6] |= frt::u64{1} << (set[i] & 63);
+        }
+
+        for (frt::usize i = 0; i < length; ++i) {
+          if (((table[src[i] >> 6] >> (src[i] & 63)) & 1) != 0) {
+            return src + i;
+          }
+        }
+
+        return nullptr;
+      }
+
+      ScanBlock::Value needles[small_set_limit];
+
+      for (frt::usize i = 0; i < set_length; ++i) {
+        needles[i] = ScanBlock::splat(set[i]);
+      }
+
+      auto* const last = src + length - n;
+
+      for (; src < last; src += n) {
+        if (auto mask = matches_any(ScanBlock::load(src), needles, set_length); mask != 0) {
+          return src + first_match(mask);
+        }
+      }
+
+      if (auto mask = matches_any(ScanBlock::load(last), needles, set_length); mask != 0) {
+        return last + first_match(mask);
+      }
+
+      return nullptr;
+    }
+
+    // the `*_fixed` kernels are for sizes known at compile-time. anything up to this size is fully unrolled into
+    // blocks, past it the length-dispatched kernels are used since their overhead is noise relative to the data
+    inline constexpr frt::usize unrolled_size_limit = 256;
+
+    // whether a fixed size maps exactly onto a single `Block<N>`
+    template <frt::usize N> inline constexpr bool is_block_size = N != 0 && N <= 32 && (N & (N - 1)) == 0;
+
+    template <frt::usize N> FRT_ALWAYS_INLINE void copy_fixed(frt::ubyte* dst, const frt::ubyte* src) noexcept {
+      if constexpr (is_block_size<N>) {
+        copy_block<N>(dst, src);
+      } else if constexpr (N <= 64) {
+        copy_up_to_64(dst, src, N);
+      } else if constexpr (N <= unrolled_size_limit) {
+        copy_block<32>(dst, src);
+        copy_fixed<N - 32>(dst + 32, src + 32);
+      } else {
+        copy_bytes(dst, src, N);
+      }
+    }
+
+    // every block is loaded on the way down the recursion and stored on the way back up,
+    // so all of the loads happen before any of the stores and overlap doesn't matter
+    template <frt::usize N> FRT_ALWAYS_INLINE void move_fixed(frt::ubyte* dst, const frt::ubyte* src) noexcept {
+      if constexpr (is_block_size<N>) {
+        copy_block<N>(dst, src);
+      } else if constexpr (N <= 64) {
+        copy_up_to_64(dst, src, N);
+      } else if constexpr (N <= unrolled_size_limit) {
+        auto head = Block<32>::load(src);
+
+        move_fixed<N - 32>(dst + 32, src + 32);
+        Block<32>::store(dst, head);
+      } else {
+        move_bytes(dst, src, N);
+      }
+    }
+
+    template <frt::usize N> FRT_ALWAYS_INLINE void set_fixed(frt::ubyte* dst, frt::ubyte value) noexcept {
+      if constexpr (is_block_size<N>) {
+        Block<N>::store(dst, Block<N>::splat(value));
+      } else if constexpr (N <= 64) {
+        set_up_to_64(dst, value, N);
+      } else if constexpr (N <= unrolled_size_limit) {
+        Block<32>::store(dst, Block<32>::splat(value));
+        set_fixed<N - 32>(dst + 32, value);
+      } else {
+        set_bytes(dst, value, N);
+      }
+    }
+
+    template <frt::usize N> FRT_ALWAYS_INLINE int compare_fixed(const frt::ubyte* a, const frt::ubyte* b) noexcept {
+      if constexpr (N == 0) {
+        return 0;
+      } else if constexpr (N == 1) {
+        return byte_difference(*a, *b);
+      } else if constexpr (is_block_size<N>) {
+        auto i = mismatch<N>(a, b);
+
+        return (i != N) ? byte_difference(a[i], b[i]) : 0;
+      } else if constexpr (N <= 64) {
+        return compare_up_to_64(a, b, N);
+      } else if constexpr (N <= unrolled_size_limit) {
+        if (auto i = mismatch<32>(a, b); i != 32) {
+          return byte_difference(a[i], b[i]);
+        }
+
+        return compare_fixed<N - 32>(a + 32, b + 32);
+      } else {
+        return compare_bytes(a, b, N);
+      }
+    }
+
+    template <frt::usize N> FRT_ALWAYS_INLINE bool equal_fixed(const frt::ubyte* a, const frt::ubyte* b) noexcept {
+      if constexpr (N == 0) {
+        return true;
+      } else if constexpr (is_block_size<N>) {
+        return equal<N>(a, b);
+      } else if constexpr (N <= 64) {
+        return equal_up_to_64(a, b, N);
+      } else if constexpr (N <= unrolled_size_limit) {
+        return equal<32>(a, b) & equal_fixed<N - 32>(a + 32, b + 32);
+      } else {
+        return equal_bytes(a, b, N);
+      }
+    }
+  } // namespace FRT_MEM_ISA_NAMESPACE
+} // namespace frt::internal::mem
@@ -12,6 +12,8 @@
 
 #include "../platform/macros.h"
 #include "../types/basic.h"
+#include "../types/traits.h"
+#include "./internal/memory_kernels.h"
 
 #ifdef FRT_HAVE_STDLIB
 #include <memory>
@@ -70,6 +72,76 @@ namespace frt {
     /// \return `0` if equal, negative if first different byte is less-than in `lhs`, positive if first different byte
     /// is greater-than in `lhs`
     int __frt_mem_compare(const void* lhs, const void* rhs, frt::usize length) noexcept;
+
+    /// Equality-only version of `__frt_mem_compare`. This is cheaper than a full comparison,
+    /// since it doesn't need to figure out where the first difference is.
+    ///
+    /// When FRT generates the memory intrinsics, this is also what `bcmp` is implemented with
+    ///
+    /// \param lhs The first set of bytes to compare
+    /// \param rhs The second set of bytes to compare
+    /// \param length The number of bytes to compare
+    /// \return Whether or not every byte in both ranges is equal
+    bool __frt_mem_equal(const void* lhs, const void* rhs, frt::usize length) noexcept;
+
+    /// Version of `__frt_mem_copy` that writes the destination with non-temporal stores where the
+    /// architecture supports them, and ends with a store fence so that the copy is ordered before
+    /// any stores that come after it.
+    ///
+    /// \param to The destination of the copy
+    /// \param from The source of the copy
+    /// \param length The number of bytes to copy
+    /// \return `to`
+    void* __frt_mem_copy_stream(void* to, const void* from, frt::usize length) noexcept;
+
+    /// Version of `__frt_mem_set` that writes the destination with non-temporal stores where the
+    /// architecture supports them, and ends with a store fence so that the stores are ordered before
+    /// any stores that come after it.
+    ///
+    /// \param to The destination to set to `static_cast<unsigned char>(value)`
+    /// \param value The value to set to the range
+    /// \param length The number of bytes to set
+    /// \return `to`
+    void* __frt_mem_set_stream(void* to, int value, frt::usize length) noexcept;
+
+    /// FRT implementation of `memchr`. It isn't actually spelled `memchr` unless
+    /// certain macros are defined at compile-time which tell FRT to make
+    /// this an alias for `memchr`
+    ///
+    /// \param haystack The bytes to search
+    /// \param value The byte to search for, converted to `unsigned char`
+    /// \param length The number of bytes to search
+    /// \return A pointer to the first byte equal to `value`, or `nullptr` if there isn't one
+    void* __frt_mem_find_byte(const void* haystack, int value, frt::usize length) noexcept;
+
+    /// Reverse version of `__frt_mem_find_byte`, equivalent to the GNU `memrchr` extension
+    ///
+    /// \param haystack The bytes to search
+    /// \param value The byte to search for, converted to `unsigned char`
+    /// \param length The number of bytes to search
+    /// \return A pointer to the last byte equal to `value`, or `nullptr` if there isn't one
+    void* __frt_mem_rfind_byte(const void* haystack, int value, frt::usize length) noexcept;
+
+    /// Finds the first byte that is equal to any of the bytes in a set. Small sets (16 bytes or less)
+    /// are searched for with vector compares, larger ones fall back to a lookup table
+    ///
+    /// \param haystack The bytes to search
+    /// \param length The number of bytes to search
+    /// \param set The bytes to search for
+    /// \param set_length The number of bytes in `set`
+    /// \return A pointer to the first byte in `haystack` that is in `set`, or `nullptr` if there isn't one
+    void* __frt_mem_find_any_of(const void* haystack,
+        frt::usize length,
+        const void* set,
+        frt::usize set_length) noexcept;
+
+    /// Counts the number of bytes in a range that are equal to a value
+    ///
+    /// \param haystack The bytes to search
+    /// \param value The byte to count, converted to `unsigned char`
+    /// \param length The number of bytes to search
+    /// \return The number of bytes equal to `value`
+    frt::usize __frt_mem_count_byte(const void* haystack, int value, frt::usize length) noexcept;
   }
 
   /// Wrapper function for `memcpy`
@@ -79,9 +151,22 @@ namespace frt {
   /// \param length The number of bytes to copy
   /// \return `to`
   FRT_ALWAYS_INLINE void* mem_copy(void* __restrict to, const void* __restrict from, frt::isize length) noexcept {
+#ifdef FRT_INLINE_MEM_INTRINS
+    auto size = static_cast<frt::usize>(length);
+
+    // small sizes are done inline, with a constant size this folds down to a couple of loads and stores
+    if (size <= internal::mem::inline_size_limit) {
+      internal::mem::copy_up_to_64(static_cast<frt::ubyte*>(to), static_cast<const frt::ubyte*>(from), size);
+
+      return to;
+    }
+
+    return ::memcpy(to, from, size);
+#else
     // enables better optimization based on the forced inlining & compiler knowledge
     // of what `memcopy` does, may be optimized out with a constant size
     return ::memcpy(to, from, static_cast<frt::usize>(length));
+#endif
   }
 
   /// Wrapper function for `memmove`
@@ -91,9 +176,22 @@ namespace frt {
   /// \param length The number of bytes to copy
   /// \return `to`
   FRT_ALWAYS_INLINE void* mem_move(void* to, const void* from, frt::isize length) noexcept {
+#ifdef FRT_INLINE_MEM_INTRINS
+    auto size = static_cast<frt::usize>(length);
+
+    // the small copy kernels are overlap-safe, see `copy_up_to_64`
+    if (size <= internal::mem::inline_size_limit) {
+      internal::mem::copy_up_to_64(static_cast<frt::ubyte*>(to), static_cast<const frt::ubyte*>(from), size);
+
+      return to;
+    }
+
+    return ::memmove(to, from, size);
+#else
     // enables better optimization based on the forced inlining & compiler knowledge
     // of what `memmove` does, may be optimized out with a constant size
     return ::memmove(to, from, static_cast<frt::usize>(length));
+#endif
   }
 
   /// Wrapper function for `memset`
@@ -103,9 +201,21 @@ namespace frt {
   /// \param length The number of bytes to set
   /// \return `to`
   FRT_ALWAYS_INLINE void* mem_set(void* to, frt::ubyte value, frt::isize length) noexcept {
+#ifdef FRT_INLINE_MEM_INTRINS
+    auto size = static_cast<frt::usize>(length);
+
+    if (size <= internal::mem::inline_size_limit) {
+      internal::mem::set_up_to_64(static_cast<frt::ubyte*>(to), value, size);
+
+      return to;
+    }
+
+    return ::memset(to, static_cast<int>(value), size);
+#else
     // enables better optimization based on the forced inlining & compiler knowledge
     // of what `memset` does, may be optimized out with a constant size
     return ::memset(to, static_cast<int>(value), static_cast<frt::usize>(length));
+#endif
   }
 
   /// Wrapper function for `memcmp`
@@ -116,9 +226,336 @@ namespace frt {
   /// \return `0` if equal, negative if first different byte is less-than in `lhs`, positive if first different byte
   /// is greater-than in `lhs`
   FRT_ALWAYS_INLINE int mem_compare(const void* lhs, const void* rhs, frt::isize length) noexcept {
+#ifdef FRT_INLINE_MEM_INTRINS
+    auto size = static_cast<frt::usize>(length);
+
+    if (size <= internal::mem::inline_size_limit) {
+      auto* a = static_cast<const frt::ubyte*>(lhs);
+      auto* b = static_cast<const frt::ubyte*>(rhs);
+
+      return internal::mem::compare_up_to_64(a, b, size);
+    }
+
+    return ::memcmp(lhs, rhs, size);
+#else
     // enables better optimization based on the forced inlining & compiler knowledge
     // of what `memcmp` does, may be optimized out with a constant size
     return ::memcmp(lhs, rhs, static_cast<frt::usize>(length));
+#endif
+  }
+
+  /// Checks if two ranges of bytes are equal. This is preferable to `mem_compare(...) == 0`
+  /// when the ordering isn't needed, since it's allowed to skip finding the first difference
+  ///
+  /// \param lhs The first set of bytes to compare
+  /// \param rhs The second set of bytes to compare
+  /// \param length The number of bytes to compare
+  /// \return Whether or not every byte in both ranges is equal
+  FRT_ALWAYS_INLINE bool mem_equal(const void* lhs, const void* rhs, frt::isize length) noexcept {
+#ifdef FRT_INLINE_MEM_INTRINS
+    auto size = static_cast<frt::usize>(length);
+
+    if (size <= internal::mem::inline_size_limit) {
+      auto* a = static_cast<const frt::ubyte*>(lhs);
+      auto* b = static_cast<const frt::ubyte*>(rhs);
+
+      return internal::mem::equal_up_to_64(a, b, size);
+    }
+
+    return frt::__frt_mem_equal(lhs, rhs, size);
+#else
+    return frt::__frt_mem_equal(lhs, rhs, static_cast<frt::usize>(length));
+#endif
+  }
+
+  /// Finds the first occurrence of a byte, see `__frt_mem_find_byte`
+  ///
+  /// \param haystack The bytes to search
+  /// \param value The byte to search for
+  /// \param length The number of bytes to search
+  /// \return A pointer to the first byte equal to `value`, or `nullptr` if there isn't one
+  [[nodiscard]] FRT_ALWAYS_INLINE const void* mem_find_byte(const void* haystack,
+      frt::ubyte value,
+      frt::isize length) noexcept {
+    return frt::__frt_mem_find_byte(haystack, static_cast<int>(value), static_cast<frt::usize>(length));
+  }
+
+  /// Finds the first occurrence of a byte, see `__frt_mem_find_byte`
+  ///
+  /// \param haystack The bytes to search
+  /// \param value The byte to search for
+  /// \param length The number of bytes to search
+  /// \return A pointer to the first byte equal to `value`, or `nullptr` if there isn't one
+  [[nodiscard]] FRT_ALWAYS_INLINE void* mem_find_byte(void* haystack, frt::ubyte value, frt::isize length) noexcept {
+    return frt::__frt_mem_find_byte(haystack, static_cast<int>(value), static_cast<frt::usize>(length));
+  }
+
+  /// Finds the last occurrence of a byte, see `__frt_mem_rfind_byte`
+  ///
+  /// \param haystack The bytes to search
+  /// \param value The byte to search for
+  /// \param length The number of bytes to search
+  /// \return A pointer to the last byte equal to `value`, or `nullptr` if there isn't one
+  [[nodiscard]] FRT_ALWAYS_INLINE const void* mem_rfind_byte(const void* haystack,
+      frt::ubyte value,
+      frt::isize length) noexcept {
+    return frt::__frt_mem_rfind_byte(haystack, static_cast<int>(value), static_cast<frt::usize>(length));
+  }
+
+  /// Finds the last occurrence of a byte, see `__frt_mem_rfind_byte`
+  ///
+  /// \param haystack The bytes to search
+  /// \param value The byte to search for
+  /// \param length The number of bytes to search
+  /// \return A pointer to the last byte equal to `value`, or `nullptr` if there isn't one
+  [[nodiscard]] FRT_ALWAYS_INLINE void* mem_rfind_byte(void* haystack, frt::ubyte value, frt::isize length) noexcept {
+    return frt::__frt_mem_rfind_byte(haystack, static_cast<int>(value), static_cast<frt::usize>(length));
+  }
+
+  /// Finds the first byte that is any of the bytes in `set`, see `__frt_mem_find_any_of`
+  ///
+  /// \param haystack The bytes to search
+  /// \param length The number of bytes to search
+  /// \param set The bytes to search for
+  /// \param set_length The number of bytes in `set`
+  /// \return A pointer to the first byte in `haystack` that is in `set`, or `nullptr` if there isn't one
+  [[nodiscard]] FRT_ALWAYS_INLINE const void* mem_find_any_of(const void* haystack,
+      frt::isize length,
+      const void* set,
+      frt::isize set_length) noexcept {
+    return frt::__frt_mem_find_any_of(haystack,
+        static_cast<frt::usize>(length),
+        set,
+        static_cast<frt::usize>(set_length));
+  }
+
+  /// Finds the first byte that is any of the bytes in `set`, see `__frt_mem_find_any_of`
+  ///
+  /// \param haystack The bytes to search
+  /// \param length The number of bytes to search
+  /// \param set The bytes to search for
+  /// \param set_length The number of bytes in `set`
+  /// \return A pointer to the first byte in `haystack` that is in `set`, or `nullptr` if there isn't one
+  [[nodiscard]] FRT_ALWAYS_INLINE void* mem_find_any_of(void* haystack,
+      frt::isize length,
+      const void* set,
+      frt::isize set_length) noexcept {
+    return frt::__frt_mem_find_any_of(haystack,
+        static_cast<frt::usize>(length),
+        set,
+        static_cast<frt::usize>(set_length));
+  }
+
+  /// Counts the occurrences of a byte
+  ///
+  /// \param haystack The bytes to search
+  /// \param value The byte to count
+  /// \param length The number of bytes to search
+  /// \return The number of bytes equal to `value`
+  [[nodiscard]] FRT_ALWAYS_INLINE frt::isize mem_count_byte(const void* haystack,
+      frt::ubyte value,
+      frt::isize length) noexcept {
+    return static_cast<frt::isize>(
+        frt::__frt_mem_count_byte(haystack, static_cast<int>(value), static_cast<frt::usize>(length)));
+  }
+
+  /// Copies bytes without pulling the destination into the cache. This is meant for copies that are much
+  /// larger than the last-level cache (e.g. frame buffers), where a normal copy would evict everything else
+  /// in the cache for data that isn't going to be read again any time soon.
+  ///
+  /// Small copies are done normally, since they'd only be a handful of stores anyway. This is always
+  /// a normal copy on architectures without non-temporal stores.
+  ///
+  /// \param to The destination of the copy, may not overlap with `from`
+  /// \param from The source of the copy
+  /// \param length The number of bytes to copy
+  /// \return `to`
+  FRT_ALWAYS_INLINE void* mem_copy_stream(void* __restrict to,
+      const void* __restrict from,
+      frt::isize length) noexcept {
+    return frt::__frt_mem_copy_stream(to, from, static_cast<frt::usize>(length));
+  }
+
+  /// Sets bytes without pulling the destination into the cache, see `mem_copy_stream`.
+  ///
+  /// \param to The destination to set to `value`
+  /// \param value The value to set to the range
+  /// \param length The number of bytes to set
+  /// \return `to`
+  FRT_ALWAYS_INLINE void* mem_set_stream(void* to, frt::ubyte value, frt::isize length) noexcept {
+    return frt::__frt_mem_set_stream(to, static_cast<int>(value), static_cast<frt::usize>(length));
+  }
+
+  namespace internal {
+    // whether the `mem_*<N>` functions will accept a pointer to `T`
+    template <typename T> constexpr bool is_mem_accessible() noexcept {
+      if constexpr (traits::is_void<T>) {
+        return true;
+      } else {
+        return traits::is_trivially_copyable<T>;
+      }
+    }
+
+    // whether the `mem_*<N>` functions can be evaluated at compile-time, by operating on whole objects
+    template <typename T, typename U, frt::usize N> constexpr bool is_mem_elementwise() noexcept {
+      if constexpr (traits::is_void<T> || !traits::is_same<traits::RemoveCV<T>, traits::RemoveCV<U>>) {
+        return false;
+      } else {
+        return N % sizeof(T) == 0;
+      }
+    }
+
+    // whether the byte-wise `mem_*<N>` functions can be evaluated at compile-time, by operating on single bytes
+    template <typename T, typename U, frt::usize N> constexpr bool is_mem_bytewise() noexcept {
+      if constexpr (!is_mem_elementwise<T, U, N>()) {
+        return false;
+      } else {
+        return sizeof(T) == 1;
+      }
+    }
+
+    template <typename T> FRT_ALWAYS_INLINE frt::ubyte* mem_bytes(T* ptr) noexcept {
+      return static_cast<frt::ubyte*>(static_cast<void*>(ptr));
+    }
+
+    template <typename T> FRT_ALWAYS_INLINE const frt::ubyte* mem_bytes(const T* ptr) noexcept {
+      return static_cast<const frt::ubyte*>(static_cast<const void*>(ptr));
+    }
+  } // namespace internal
+
+  /// Copies exactly `N` bytes. Since the size is known at compile-time, this is expanded into a straight-line
+  /// sequence of register-sized loads and stores for anything that's reasonably sized, and never goes through
+  /// the size dispatch that `mem_copy(to, from, length)` does.
+  ///
+  /// This can be used in constant expressions if `T` and `U` are the same type, and `N` is a multiple of their size.
+  ///
+  /// \param to The destination of the copy
+  /// \param from The source of the copy
+  /// \return `to`
+  template <frt::usize N, typename T, typename U>
+  FRT_ALWAYS_INLINE constexpr T* mem_copy(T* __restrict to, const U* __restrict from) noexcept
+      requires(internal::is_mem_accessible<T>() && internal::is_mem_accessible<U>()) {
+    if constexpr (internal::is_mem_elementwise<T, U, N>()) {
+      if (traits::is_constant_evaluated()) {
+        for (frt::usize i = 0; i < N / sizeof(T); ++i) {
+          to[i] = from[i];
+        }
+
+        return to;
+      }
+    }
+
+    internal::mem::copy_fixed<N>(internal::mem_bytes(to), internal::mem_bytes(from));
+
+    return to;
+  }
+
+  /// Moves exactly `N` bytes, the ranges may overlap. See `mem_copy<N>` for details.
+  ///
+  /// This can be used in constant expressions if `T` and `U` are the same type, and `N` is a multiple of their size.
+  ///
+  /// \param to The destination of the move
+  /// \param from The source of the move
+  /// \return `to`
+  template <frt::usize N, typename T, typename U>
+  FRT_ALWAYS_INLINE constexpr T* mem_move(T* to, const U* from) noexcept
+      requires(internal::is_mem_accessible<T>() && internal::is_mem_accessible<U>()) {
+    if constexpr (internal::is_mem_elementwise<T, U, N>()) {
+      if (traits::is_constant_evaluated()) {
+        constexpr auto count = N / sizeof(T);
+        auto backwards = false;
+
+        // `<` between unrelated pointers isn't a constant expression, but `==` is. if `to` is
+        // inside of `from`'s range we need to go backwards, otherwise forwards is always safe
+        for (frt::usize i = 1; i < count; ++i) {
+          backwards = backwards || (to == from + i);
+        }
+
+        for (frt::usize i = 0; i < count; ++i) {
+          auto j = backwards ? count - i - 1 : i;
+
+          to[j] = from[j];
+        }
+
+        return to;
+      }
+    }
+
+    internal::mem::move_fixed<N>(internal::mem_bytes(to), internal::mem_bytes(from));
+
+    return to;
+  }
+
+  /// Sets exactly `N` bytes to `value`. See `mem_copy<N>` for details.
+  ///
+  /// This can be used in constant expressions if `T` is a byte-sized type.
+  ///
+  /// \param to The destination to set to `value`
+  /// \param value The value to set to the range
+  /// \return `to`
+  template <frt::usize N, typename T>
+  FRT_ALWAYS_INLINE constexpr T* mem_set(T* to, frt::ubyte value) noexcept requires(internal::is_mem_accessible<T>()) {
+    if constexpr (internal::is_mem_bytewise<T, T, N>()) {
+      if (traits::is_constant_evaluated()) {
+        for (frt::usize i = 0; i < N; ++i) {
+          to[i] = static_cast<T>(value);
+        }
+
+        return to;
+      }
+    }
+
+    internal::mem::set_fixed<N>(internal::mem_bytes(to), value);
+
+    return to;
+  }
+
+  /// Compares exactly `N` bytes. See `mem_copy<N>` for details.
+  ///
+  /// This can be used in constant expressions if `T` and `U` are the same byte-sized type.
+  ///
+  /// \param lhs The first set of bytes to compare
+  /// \param rhs The second set of bytes to compare
+  /// \return `0` if equal, negative if first different byte is less-than in `lhs`, positive if first different byte
+  /// is greater-than in `lhs`
+  template <frt::usize N, typename T, typename U>
+  [[nodiscard]] FRT_ALWAYS_INLINE constexpr int mem_compare(const T* lhs, const U* rhs) noexcept
+      requires(internal::is_mem_accessible<T>() && internal::is_mem_accessible<U>()) {
+    if constexpr (internal::is_mem_bytewise<T, U, N>()) {
+      if (traits::is_constant_evaluated()) {
+        for (frt::usize i = 0; i < N; ++i) {
+          auto a = static_cast<frt::ubyte>(lhs[i]);
+          auto b = static_cast<frt::ubyte>(rhs[i]);
+
+          if (a != b) {
+            return static_cast<int>(a) - static_cast<int>(b);
+          }
+        }
+
+        return 0;
+      }
+    }
+
+    return internal::mem::compare_fixed<N>(internal::mem_bytes(lhs), internal::mem_bytes(rhs));
+  }
+
+  /// Checks if exactly `N` bytes are equal. See `mem_copy<N>` for details.
+  ///
+  /// This can be used in constant expressions if `T` and `U` are the same byte-sized type.
+  ///
+  /// \param lhs The first set of bytes to compare
+  /// \param rhs The second set of bytes to compare
+  /// \return Whether or not every byte in both ranges is equal
+  template <frt::usize N, typename T, typename U>
+  [[nodiscard]] FRT_ALWAYS_INLINE constexpr bool mem_equal(const T* lhs, const U* rhs) noexcept
+      requires(internal::is_mem_accessible<T>() && internal::is_mem_accessible<U>()) {
+    if constexpr (internal::is_mem_bytewise<T, U, N>()) {
+      if (traits::is_constant_evaluated()) {
+        return frt::mem_compare<N>(lhs, rhs) == 0;
+      }
+    }
+
+    return internal::mem::equal_fixed<N>(internal::mem_bytes(lhs), internal::mem_bytes(rhs));
   }
 
 #ifdef FRT_GENERATE_DEFAULT_MEM_INTRINS
@@ -127,6 +564,12 @@ namespace frt {
   inline constexpr bool generated_memory_intrinsics = false;
 #endif
 
+#ifdef FRT_INLINE_MEM_INTRINS
+  inline constexpr bool inlined_memory_intrinsics = true;
+#else
+  inline constexpr bool inlined_memory_intrinsics = false;
+#endif
+
   /// Gets the address of an object without ever using `operator&` overloads
   ///
   /// \param object The object to get the address of
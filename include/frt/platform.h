@@ -11,7 +11,10 @@
 #pragma once
 
 #include "./platform/architecture.h"
+#include "./platform/backtrace.h"
+#include "./platform/cache.h"
 #include "./platform/compare.h"
 #include "./platform/compiler.h"
+#include "./platform/cpu.h"
 #include "./platform/macros.h"
 #include "./platform/new.h"
\ No newline at end of file
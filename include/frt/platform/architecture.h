@@ -21,3 +21,7 @@
 #if defined(FRT_ARCH_ARM64) || defined(FRT_ARCH_ARM32)
 #define FRT_ARCH_ARM
 #endif
+
+#if defined(__linux__)
+#define FRT_OS_LINUX
+#endif
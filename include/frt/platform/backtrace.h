@@ -0,0 +1,74 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include "../types/basic.h"
+#include "./architecture.h"
+#include "./macros.h"
+
+namespace frt {
+  namespace internal {
+    // a frame that's bigger than this is more likely to be a broken chain than a real frame
+    inline constexpr frt::usize max_frame_size = frt::usize{1} << 20;
+  } // namespace internal
+
+  /// Captures the return addresses of the calling function and its callers, by walking the chain of
+  /// saved frame pointers. This is only a handful of loads per frame.
+  ///
+  /// Every function on the walked part of the stack must keep frame pointers (i.e. be built with
+  /// `-fno-omit-frame-pointer`). The walk stops early if the chain looks broken, but it can't tell a stale
+  /// value in the frame pointer register from a real frame. A frame without a frame pointer can send it to
+  /// an unmapped address (e.g. past the top of the thread's stack), in which case this crashes.
+  ///
+  /// Only x86-64 and ARM64 are supported, anywhere else this captures nothing.
+  ///
+  /// \param frames Where to put the return addresses, innermost first
+  /// \param max The maximum number of frames to capture
+  /// \param skip The number of innermost frames to walk past without capturing them
+  /// \return The number of frames captured
+  FRT_ALWAYS_INLINE frt::usize frame_backtrace(void** frames, frt::usize max, frt::usize skip = 0) noexcept {
+#if defined(FRT_ARCH_X86_64) || defined(FRT_ARCH_ARM64)
+    // on both, a frame pointer points at the caller's saved frame pointer, followed by the return address
+    auto* frame = static_cast<void* const*>(__builtin_frame_address(0));
+    auto count = frt::usize{0};
+
+    while (count < max) {
+      if (frame[1] == nullptr) {
+        break;
+      }
+
+      if (skip != 0) {
+        --skip;
+      } else {
+        frames[count++] = frame[1];
+      }
+
+      auto current = reinterpret_cast<frt::usize>(frame);
+      auto next = reinterpret_cast<frt::usize>(frame[0]);
+
+      // the stack grows down, so callers' frames are always at higher addresses
+      if (next <= current || next - current > internal::max_frame_size || next % sizeof(void*) != 0) {
+        break;
+      }
+
+      frame = reinterpret_cast<void* const*>(next);
+    }
+
+    return count;
+#else
+    (void)frames;
+    (void)max;
+    (void)skip;
+
+    return 0;
+#endif
+  }
+} // namespace frt
@@ -0,0 +1,131 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include "../types/basic.h"
+#include "./architecture.h"
+#include "./macros.h"
+
+namespace frt {
+  /// The size of a cache line on the architecture being compiled for
+  inline constexpr frt::usize cache_line_size = 64;
+
+  /// The minimum distance between two objects that avoids false sharing. This can be larger than
+  /// `cache_line_size`, since some CPUs will prefetch (and thus contend on) pairs of lines at a time.
+  ///
+  /// Equivalent to `std::hardware_destructive_interference_size`.
+#if defined(__GCC_DESTRUCTIVE_SIZE)
+  inline constexpr frt::usize hardware_destructive_interference_size = __GCC_DESTRUCTIVE_SIZE;
+#elif defined(FRT_ARCH_ARM64)
+  inline constexpr frt::usize hardware_destructive_interference_size = 128;
+#else
+  inline constexpr frt::usize hardware_destructive_interference_size = 64;
+#endif
+
+  /// The maximum size of contiguous memory that is guaranteed to share a cache line.
+  ///
+  /// Equivalent to `std::hardware_constructive_interference_size`.
+#if defined(__GCC_CONSTRUCTIVE_SIZE)
+  inline constexpr frt::usize hardware_constructive_interference_size = __GCC_CONSTRUCTIVE_SIZE;
+#else
+  inline constexpr frt::usize hardware_constructive_interference_size = 64;
+#endif
+
+  /// How long data brought in by a prefetch is expected to be useful for, i.e. how
+  /// many levels of the cache hierarchy that the data should be brought into.
+  enum class Locality : int {
+    none = 0,     // used once and then never again, avoid polluting the cache with it at all
+    low = 1,      // only bring into the outer levels of cache
+    moderate = 2, // bring into most levels of cache
+    high = 3,     // bring into every level of cache
+  };
+
+  /// Hints to the CPU that the memory at `address` will be read soon. This never faults,
+  /// `address` is allowed to be an invalid address.
+  ///
+  /// \param address The address to prefetch the cache line of
+  template <Locality L = Locality::high> FRT_ALWAYS_INLINE void prefetch_read(const void* address) noexcept {
+    __builtin_prefetch(address, 0, static_cast<int>(L));
+  }
+
+  /// Hints to the CPU that the memory at `address` will be written to soon. This never faults,
+  /// `address` is allowed to be an invalid address.
+  ///
+  /// \param address The address to prefetch the cache line of
+  template <Locality L = Locality::high> FRT_ALWAYS_INLINE void prefetch_write(const void* address) noexcept {
+    __builtin_prefetch(address, 1, static_cast<int>(L));
+  }
+
+  /// Writes back the cache line containing `address` (if it's dirty) and then evicts it from every
+  /// level of the cache hierarchy.
+  ///
+  /// On x86-64 this is `clflushopt` if the build targets CPUs with it, otherwise `clflush`. On AArch64 this
+  /// is `dc civac`. On anything else this is only a compiler barrier, since there's no portable way to do it.
+  ///
+  /// `clflushopt` is weakly ordered, use `cache_line_fence` after a batch of these to order them.
+  ///
+  /// \param address An address in the cache line to flush
+  FRT_ALWAYS_INLINE void cache_line_flush(const void* address) noexcept {
+#if defined(FRT_ARCH_X86_64) && defined(__CLFLUSHOPT__)
+    asm volatile("clflushopt %0" : : "m"(*static_cast<const char*>(address)) : "memory");
+#elif defined(FRT_ARCH_X86_64)
+    asm volatile("clflush %0" : : "m"(*static_cast<const char*>(address)) : "memory");
+#elif defined(FRT_ARCH_ARM64)
+    asm volatile("dc civac, %0" : : "r"(address) : "memory");
+#else
+    (void)address;
+
+    asm volatile("" : : : "memory");
+#endif
+  }
+
+  /// Writes back the cache line containing `address` if it's dirty, without necessarily evicting it. This is
+  /// the operation that makes stores durable on persistent memory.
+  ///
+  /// On x86-64 this is `clwb` if the build targets CPUs with it, falling back to `cache_line_flush` otherwise
+  /// (which also evicts the line, but is otherwise equivalent). On AArch64 this is `dc cvap` if the build
+  /// targets ARMv8.2 or later (see `CPUFeature::arm64_dpb`). Older AArch64 targets get `dc cvac`, which only
+  /// cleans to the point of coherency and so does **not** guarantee durability. On anything else this is
+  /// only a compiler barrier.
+  ///
+  /// `clwb` is weakly ordered, use `cache_line_fence` after a batch of these to order them.
+  ///
+  /// \param address An address in the cache line to write back
+  FRT_ALWAYS_INLINE void cache_line_writeback(const void* address) noexcept {
+#if defined(FRT_ARCH_X86_64) && defined(__CLWB__)
+    asm volatile("clwb %0" : : "m"(*static_cast<const char*>(address)) : "memory");
+#elif defined(FRT_ARCH_X86_64)
+    frt::cache_line_flush(address);
+#elif defined(FRT_ARCH_ARM64) && defined(__ARM_ARCH) && __ARM_ARCH >= 802
+    // `dc cvap` by its encoding, so that assemblers that predate ARMv8.2 accept it
+    asm volatile("sys #3, c7, c12, #1, %0" : : "r"(address) : "memory");
+#elif defined(FRT_ARCH_ARM64)
+    asm volatile("dc cvac, %0" : : "r"(address) : "memory");
+#else
+    (void)address;
+
+    asm volatile("" : : : "memory");
+#endif
+  }
+
+  /// Waits for every `cache_line_flush` and `cache_line_writeback` before it to complete, and
+  /// orders them before any stores after it.
+  FRT_ALWAYS_INLINE void cache_line_fence() noexcept {
+#if defined(FRT_ARCH_X86_64)
+    asm volatile("sfence" : : : "memory");
+#elif defined(FRT_ARCH_ARM64)
+    // full system, the point of coherency may be past what the inner shareable domain covers
+    asm volatile("dsb sy" : : : "memory");
+#else
+    asm volatile("" : : : "memory");
+#endif
+  }
+} // namespace frt
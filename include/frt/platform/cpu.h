@@ -0,0 +1,136 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include "../types/basic.h"
+#include "./architecture.h"
+#include "./macros.h"
+
+namespace frt {
+  /// Instruction set extensions and CPU behaviors that FRT knows how to detect at runtime.
+  ///
+  /// Features for every architecture are listed, but only the ones relevant for the
+  /// architecture being compiled for will ever be reported as present.
+  enum class CPUFeature : frt::u32 {
+    // x86-64
+    x86_sse3,
+    x86_ssse3,
+    x86_sse41,
+    x86_sse42,
+    x86_popcnt,
+    x86_avx,
+    x86_avx2,
+    x86_bmi1,
+    x86_bmi2,
+    x86_avx512f,
+    x86_avx512bw,
+    x86_avx512vl,
+    x86_erms,       // enhanced `rep movsb`/`rep stosb`
+    x86_fsrm,       // fast short `rep movsb`
+    x86_clflush,    // `clflush`
+    x86_clflushopt, // `clflushopt`
+    x86_clwb,       // `clwb`
+
+    // AArch64
+    arm64_neon,
+    arm64_crc32,
+    arm64_lse,  // large system extensions (atomic read-modify-write instructions)
+    arm64_sve,  // scalable vector extension
+    arm64_dpb,  // `dc cvap`
+    arm64_mops, // `cpy*`/`set*` memory operation instructions
+  };
+
+  /// A set of `CPUFeature`s, as detected on the current CPU
+  class CPUFeatures {
+  public:
+    /// Creates an empty feature set
+    constexpr explicit CPUFeatures() noexcept = default;
+
+    /// Creates a feature set from a raw bit representation, where each
+    /// bit index corresponds to the value of a `CPUFeature`.
+    ///
+    /// \param bits The raw bits
+    constexpr explicit CPUFeatures(frt::u64 bits) noexcept : bits_{bits} {}
+
+    /// Checks if a given feature is present
+    ///
+    /// \param feature The feature to check for
+    /// \return Whether or not `feature` is in the set
+    [[nodiscard]] constexpr bool has(CPUFeature feature) const noexcept {
+      return (bits_ & bit(feature)) != 0;
+    }
+
+    /// Adds a feature to the set
+    ///
+    /// \param feature The feature to add
+    constexpr void add(CPUFeature feature) noexcept {
+      bits_ |= bit(feature);
+    }
+
+    /// Gets the raw bit representation of the set
+    ///
+    /// \return The raw bits, see `CPUFeatures(frt::u64)`
+    [[nodiscard]] constexpr frt::u64 bits() const noexcept {
+      return bits_;
+    }
+
+  private:
+    [[nodiscard]] static constexpr frt::u64 bit(CPUFeature feature) noexcept {
+      return frt::u64{1} << static_cast<frt::u32>(feature);
+    }
+
+    frt::u64 bits_ = 0;
+  };
+
+  /// Queries the CPU for the features it supports. On x86-64 this uses `cpuid` (and `xgetbv`
+  /// to make sure the OS actually saves AVX/AVX-512 state), on AArch64 this reads the
+  /// `ID_AA64*_EL1` registers. Freestanding builds assume they're running in a kernel and read them
+  /// directly. Hosted builds only read them if the OS emulates EL0 reads (on Linux, when `HWCAP_CPUID`
+  /// is set), and otherwise only report NEON.
+  ///
+  /// This actually executes the detection every time, prefer `cpu_features` unless
+  /// you have a reason not to.
+  ///
+  /// \return The features supported by the current CPU
+  [[nodiscard]] CPUFeatures detect_cpu_features() noexcept;
+
+  /// Gets the features supported by the current CPU. Detection is done at most
+  /// once (modulo races on the very first call, which are harmless) and the result is cached.
+  ///
+  /// \return The features supported by the current CPU
+  [[nodiscard]] CPUFeatures cpu_features() noexcept;
+
+  /// Reads a cheap, monotonically increasing cycle counter. On x86-64 this is `rdtsc` (which ticks at a
+  /// constant rate rather than at the core clock on anything remotely modern), on AArch64 this is the virtual
+  /// counter `cntvct_el0`. Other architectures don't have one and always get `0`.
+  ///
+  /// Neither is serializing, and the rate is CPU-specific. It's only useful for comparing differences.
+  ///
+  /// \return The current value of the counter
+  [[nodiscard]] FRT_ALWAYS_INLINE frt::u64 cycle_count() noexcept {
+#if defined(FRT_ARCH_X86_64)
+    frt::u32 low = 0;
+    frt::u32 high = 0;
+
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+
+    return (frt::u64{high} << 32) | low;
+#elif defined(FRT_ARCH_ARM64)
+    frt::u64 value = 0;
+
+    asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+
+    return value;
+#else
+    return 0;
+#endif
+  }
+} // namespace frt
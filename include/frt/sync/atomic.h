@@ -362,7 +362,7 @@ namespace frt {
     template <int Order = frt::memory_order_seq_cst>
     FRT_ALWAYS_INLINE bool compare_exchange_weak(T& expected,
         T desired,
-        MemoryOrder<Order> order = frt::memory_order_seq_cst) const noexcept {
+        MemoryOrder<Order> order = frt::memory_order_seq_cst) noexcept {
       return internal::atomic_cmpxchg_weak<T>(address(),
           expected,
           desired,
@@ -394,7 +394,7 @@ namespace frt {
     template <int Order = frt::memory_order_seq_cst>
     FRT_ALWAYS_INLINE bool compare_exchange_strong(T& expected,
         T desired,
-        MemoryOrder<Order> order = frt::memory_order_seq_cst) const noexcept {
+        MemoryOrder<Order> order = frt::memory_order_seq_cst) noexcept {
       return internal::atomic_cmpxchg_strong<T>(address(),
           expected,
           desired,
@@ -0,0 +1,208 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "frt/core/allocators/linux_page_source.h"
+#include "frt/platform/architecture.h"
+#include "frt/platform/macros.h"
+
+namespace {
+#if defined(FRT_ARCH_X86_64)
+  constexpr frt::isize sys_mmap = 9;
+  constexpr frt::isize sys_munmap = 11;
+  constexpr frt::isize sys_madvise = 28;
+
+  frt::isize raw_syscall(frt::isize number, // NOLINT(bugprone-easily-swappable-parameters)
+      frt::isize a0,
+      frt::isize a1,
+      frt::isize a2,
+      frt::isize a3 = 0,
+      frt::isize a4 = 0,
+      frt::isize a5 = 0) noexcept {
+    register frt::isize r10 asm("r10") = a3;
+    register frt::isize r8 asm("r8") = a4;
+    register frt::isize r9 asm("r9") = a5;
+    frt::isize result;
+
+    asm volatile("syscall"
+                 : "=a"(result)
+                 : "a"(number), "D"(a0), "S"(a1), "d"(a2), "r"(r10), "r"(r8), "r"(r9)
+                 : "rcx", "r11", "memory");
+
+    return result;
+  }
+#elif defined(FRT_ARCH_ARM64)
+  constexpr frt::isize sys_mmap = 222;
+  constexpr frt::isize sys_munmap = 215;
+  constexpr frt::isize sys_madvise = 233;
+
+  frt::isize raw_syscall(frt::isize number, // NOLINT(bugprone-easily-swappable-parameters)
+      frt::isize a0,
+      frt::isize a1,
+      frt::isize a2,
+      frt::isize a3 = 0,
+      frt::isize a4 = 0,
+      frt::isize a5 = 0) noexcept {
+    register frt::isize x8 asm("x8") = number;
+    register frt::isize x0 asm("x0") = a0;
+    register frt::isize x1 asm("x1") = a1;
+    register frt::isize x2 asm("x2") = a2;
+    register frt::isize x3 asm("x3") = a3;
+    register frt::isize x4 asm("x4") = a4;
+    register frt::isize x5 asm("x5") = a5;
+
+    asm volatile("svc 0" : "+r"(x0) : "r"(x8), "r"(x1), "r"(x2), "r"(x3), "r"(x4), "r"(x5) : "memory");
+
+    return x0;
+  }
+#else
+#error "raw Linux system calls are not implemented for this architecture"
+#endif
+
+  // these are the same on every architecture that uses the generic uapi headers, which includes both of the above
+  constexpr frt::isize prot_read_write = 0x1 | 0x2;
+  constexpr frt::isize map_private = 0x02;
+  constexpr frt::isize map_anonymous = 0x20;
+  constexpr frt::isize map_populate = 0x8000;
+  constexpr frt::isize map_hugetlb = 0x40000;
+  constexpr frt::isize map_huge_2mb = frt::isize{21} << 26;
+  constexpr frt::isize madv_dontneed = 4;
+  constexpr frt::isize madv_free = 8;
+  constexpr frt::isize madv_hugepage = 14;
+  constexpr frt::isize madv_populate_write = 23;
+
+  constexpr frt::usize small_page_size = 4096;
+  constexpr frt::usize huge_page_size = frt::usize{2} << 20;
+
+  // system calls return `-errno` on failure, which is always in `[-4095, -1]`
+  FRT_ALWAYS_INLINE bool failed(frt::isize result) noexcept {
+    return static_cast<frt::usize>(result) > ~frt::usize{4095};
+  }
+
+  FRT_ALWAYS_INLINE frt::isize to_arg(const void* ptr) noexcept {
+    return static_cast<frt::isize>(reinterpret_cast<frt::usize>(ptr));
+  }
+
+  FRT_ALWAYS_INLINE frt::isize to_arg(frt::usize value) noexcept {
+    return static_cast<frt::isize>(value);
+  }
+
+  void* map(frt::usize bytes, frt::isize flags) noexcept {
+    auto result = raw_syscall(sys_mmap, 0, to_arg(bytes), prot_read_write, flags | map_private | map_anonymous, -1, 0);
+
+    return failed(result) ? nullptr : reinterpret_cast<void*>(result);
+  }
+
+  void unmap(frt::usize address, frt::usize bytes) noexcept {
+    raw_syscall(sys_munmap, to_arg(address), to_arg(bytes), 0);
+  }
+
+  bool advise(void* pages, frt::usize bytes, frt::isize advice) noexcept {
+    return !failed(raw_syscall(sys_madvise, to_arg(pages), to_arg(bytes), advice));
+  }
+
+  // `MADV_POPULATE_WRITE` needs Linux 5.14, older kernels get every page touched by hand instead
+  void populate(void* pages, frt::usize bytes) noexcept {
+    if (advise(pages, bytes, madv_populate_write)) {
+      return;
+    }
+
+    for (auto offset = frt::usize{0}; offset < bytes; offset += small_page_size) {
+      static_cast<volatile frt::ubyte*>(pages)[offset] = 0;
+    }
+  }
+
+  // the kernel only promises that a mapping is aligned to its page size (`granule`), anything more means mapping
+  // extra and trimming it off afterwards. `MAP_POPULATE` is only used when nothing is trimmed, since otherwise
+  // it would fault in memory that's thrown away
+  void* map_aligned(frt::usize bytes,
+      frt::usize align,
+      frt::usize granule,
+      frt::isize flags,
+      bool populate_pages) noexcept {
+    auto slack = align > granule ? align - granule : 0;
+    auto populate_on_map = populate_pages && slack == 0;
+
+    if (FRT_UNLIKELY(bytes + slack < bytes)) {
+      return nullptr;
+    }
+
+    auto* mapping = map(bytes + slack, flags | (populate_on_map ? map_populate : 0));
+
+    if (FRT_UNLIKELY(mapping == nullptr)) {
+      return nullptr;
+    }
+
+    auto begin = reinterpret_cast<frt::usize>(mapping);
+    auto start = (begin + (align - 1)) & ~(align - 1);
+    auto end = start + bytes;
+
+    if (start != begin) {
+      unmap(begin, start - begin);
+    }
+
+    if (end != begin + bytes + slack) {
+      unmap(end, begin + bytes + slack - end);
+    }
+
+    auto* pages = reinterpret_cast<void*>(start);
+
+    if (populate_pages && !populate_on_map) {
+      populate(pages, bytes);
+    }
+
+    return pages;
+  }
+} // namespace
+
+void* frt::internal::linux_map_pages(frt::usize bytes, frt::usize align, LinuxPageOptions options) noexcept {
+  if (options.huge_pages == LinuxHugePages::explicit_2m) {
+    auto flags = map_hugetlb | map_huge_2mb;
+
+    // hugetlb mappings are only aligned to the huge page size, but they can be trimmed in units of it
+    if (auto* pages = map_aligned(bytes, align, huge_page_size, flags, options.populate);
+        pages != nullptr || !options.huge_fallback) {
+      return pages;
+    }
+
+    options.huge_pages = LinuxHugePages::transparent;
+  }
+
+  // `MAP_POPULATE` isn't used when the pages are about to become huge, since it would fault them in as small pages
+  auto transparent = options.huge_pages == LinuxHugePages::transparent;
+  auto* pages = map_aligned(bytes, align, small_page_size, 0, options.populate && !transparent);
+
+  if (FRT_UNLIKELY(pages == nullptr)) {
+    return nullptr;
+  }
+
+  // failing just means transparent huge pages are disabled, and small pages are used like normal
+  if (transparent) {
+    advise(pages, bytes, madv_hugepage);
+
+    if (options.populate) {
+      populate(pages, bytes);
+    }
+  }
+
+  return pages;
+}
+
+void frt::internal::linux_unmap_pages(void* pages, frt::usize bytes) noexcept {
+  unmap(reinterpret_cast<frt::usize>(pages), bytes);
+}
+
+void frt::internal::linux_release_pages(void* pages, frt::usize bytes, LinuxPageRelease release) noexcept {
+  // `MADV_FREE` needs Linux 4.5 and doesn't work on hugetlb mappings, `MADV_DONTNEED` always works
+  if (release == LinuxPageRelease::free && advise(pages, bytes, madv_free)) {
+    return;
+  }
+
+  advise(pages, bytes, madv_dontneed);
+}
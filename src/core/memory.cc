@@ -7,89 +7,253 @@
 // following link: https://opensource.org/licenses/BSD-3-Clause              //
 //                                                                           //
 //======---------------------------------------------------------------======//
-#include "frt/core/memory.h"
-#include "frt/platform/macros.h"
+#include "./memory_dispatch.h"
+#include "frt/sync/atomic.h"
 
-extern "C" FRT_ALWAYS_INLINE void* frt::__frt_mem_copy(void* __restrict to,
-    const void* __restrict from,
-    frt::usize length) noexcept {
-  // TODO: make a better memcpy. __builtin_memcpy_inline? rep movsb?
-  auto* dst = static_cast<frt::ubyte* __restrict>(to);
-  const auto* src = static_cast<const frt::ubyte* __restrict>(from);
+#if defined(FRT_MEM_USE_DISPATCH)
+
+frt::internal::MemKernels frt::internal::mem_kernels_baseline(frt::CPUFeatures features) noexcept {
+  return make_mem_kernels(features);
+}
+
+namespace {
+  void resolve_kernels() noexcept;
+
+  void resolve_then_copy(frt::ubyte* dst, const frt::ubyte* src, frt::usize length) noexcept;
+  void resolve_then_move(frt::ubyte* dst, const frt::ubyte* src, frt::usize length) noexcept;
+  void resolve_then_set(frt::ubyte* dst, frt::ubyte value, frt::usize length) noexcept;
+  int resolve_then_compare(const frt::ubyte* lhs, const frt::ubyte* rhs, frt::usize length) noexcept;
+  bool resolve_then_equal(const frt::ubyte* lhs, const frt::ubyte* rhs, frt::usize length) noexcept;
+  void resolve_then_copy_stream(frt::ubyte* dst, const frt::ubyte* src, frt::usize length) noexcept;
+  void resolve_then_set_stream(frt::ubyte* dst, frt::ubyte value, frt::usize length) noexcept;
+  const frt::ubyte* resolve_then_find_byte(const frt::ubyte* src, frt::ubyte value, frt::usize length) noexcept;
+  const frt::ubyte* resolve_then_rfind_byte(const frt::ubyte* src, frt::ubyte value, frt::usize length) noexcept;
+  const frt::ubyte* resolve_then_find_any_of(const frt::ubyte* src,
+      frt::usize length,
+      const frt::ubyte* set,
+      frt::usize set_length) noexcept;
+  frt::usize resolve_then_count_byte(const frt::ubyte* src, frt::ubyte value, frt::usize length) noexcept;
+
+  // every entry starts out pointing at a stub that resolves the whole table and then calls through it,
+  // so after the first call to any of them the feature check is never done again
+  frt::internal::MemKernels kernels = {&resolve_then_copy,
+      &resolve_then_move,
+      &resolve_then_set,
+      &resolve_then_compare,
+      &resolve_then_equal,
+      &resolve_then_copy_stream,
+      &resolve_then_set_stream,
+      &resolve_then_find_byte,
+      &resolve_then_rfind_byte,
+      &resolve_then_find_any_of,
+      &resolve_then_count_byte};
+
+  // each entry is loaded/stored atomically on its own. every thread that races on resolution
+  // computes the same table, so it doesn't matter if a thread sees a mix of old and new entries
+  template <typename F> FRT_ALWAYS_INLINE F kernel(F* entry) noexcept {
+    return frt::internal::atomic_load(entry, frt::memory_order_relaxed);
+  }
+
+  template <typename F> FRT_ALWAYS_INLINE void install(F* entry, F resolved) noexcept {
+    frt::internal::atomic_store(entry, resolved, frt::memory_order_relaxed);
+  }
+
+  FRT_COLD void resolve_kernels() noexcept {
+    auto features = frt::cpu_features();
+    auto resolved = features.has(frt::CPUFeature::x86_avx2) ? frt::internal::mem_kernels_avx2(features)
+                                                            : frt::internal::mem_kernels_baseline(features);
+
+    install(&kernels.copy, resolved.copy);
+    install(&kernels.move, resolved.move);
+    install(&kernels.set, resolved.set);
+    install(&kernels.compare, resolved.compare);
+    install(&kernels.equal, resolved.equal);
+    install(&kernels.copy_stream, resolved.copy_stream);
+    install(&kernels.set_stream, resolved.set_stream);
+    install(&kernels.find_byte, resolved.find_byte);
+    install(&kernels.rfind_byte, resolved.rfind_byte);
+    install(&kernels.find_any_of, resolved.find_any_of);
+    install(&kernels.count_byte, resolved.count_byte);
+  }
+
+  void resolve_then_copy(frt::ubyte* dst, const frt::ubyte* src, frt::usize length) noexcept {
+    resolve_kernels();
+    kernel(&kernels.copy)(dst, src, length);
+  }
+
+  void resolve_then_move(frt::ubyte* dst, const frt::ubyte* src, frt::usize length) noexcept {
+    resolve_kernels();
+    kernel(&kernels.move)(dst, src, length);
+  }
+
+  void resolve_then_set(frt::ubyte* dst, frt::ubyte value, frt::usize length) noexcept {
+    resolve_kernels();
+    kernel(&kernels.set)(dst, value, length);
+  }
+
+  int resolve_then_compare(const frt::ubyte* lhs, const frt::ubyte* rhs, frt::usize length) noexcept {
+    resolve_kernels();
+
+    return kernel(&kernels.compare)(lhs, rhs, length);
+  }
+
+  bool resolve_then_equal(const frt::ubyte* lhs, const frt::ubyte* rhs, frt::usize length) noexcept {
+    resolve_kernels();
+
+    return kernel(&kernels.equal)(lhs, rhs, length);
+  }
+
+  void resolve_then_copy_stream(frt::ubyte* dst, const frt::ubyte* src, frt::usize length) noexcept {
+    resolve_kernels();
+    kernel(&kernels.copy_stream)(dst, src, length);
+  }
+
+  void resolve_then_set_stream(frt::ubyte* dst, frt::ubyte value, frt::usize length) noexcept {
+    resolve_kernels();
+    kernel(&kernels.set_stream)(dst, value, length);
+  }
+
+  const frt::ubyte* resolve_then_find_byte(const frt::ubyte* src, frt::ubyte value, frt::usize length) noexcept {
+    resolve_kernels();
+
+    return kernel(&kernels.find_byte)(src, value, length);
+  }
+
+  const frt::ubyte* resolve_then_rfind_byte(const frt::ubyte* src, frt::ubyte value, frt::usize length) noexcept {
+    resolve_kernels();
+
+    return kernel(&kernels.rfind_byte)(src, value, length);
+  }
+
+  const frt::ubyte* resolve_then_find_any_of(const frt::ubyte* src,
+      frt::usize length,
+      const frt::ubyte* set,
+      frt::usize set_length) noexcept {
+    resolve_kernels();
 
-  while (length-- > 0) {
-    *dst++ = *src++;
+    return kernel(&kernels.find_any_of)(src, length, set, set_length);
   }
 
+  frt::usize resolve_then_count_byte(const frt::ubyte* src, frt::ubyte value, frt::usize length) noexcept {
+    resolve_kernels();
+
+    return kernel(&kernels.count_byte)(src, value, length);
+  }
+} // namespace
+
+#define FRT_MEM_KERNEL(name) kernel(&kernels.name)
+
+#else
+
+#define FRT_MEM_KERNEL(name) frt::internal::mem::name##_bytes
+
+#endif
+
+extern "C" void* frt::__frt_mem_copy(void* __restrict to, const void* __restrict from, frt::usize length) noexcept {
+  FRT_MEM_KERNEL(copy)(static_cast<frt::ubyte*>(to), static_cast<const frt::ubyte*>(from), length);
+
   return to;
 }
 
-extern "C" FRT_ALWAYS_INLINE void* frt::__frt_mem_move(void* to, const void* from, frt::usize length) noexcept {
-  // TODO: fast mem_move
-  auto* dst = static_cast<frt::ubyte*>(to);
-  const auto* src = static_cast<const frt::ubyte*>(from);
+extern "C" void* frt::__frt_mem_move(void* to, const void* from, frt::usize length) noexcept {
+  FRT_MEM_KERNEL(move)(static_cast<frt::ubyte*>(to), static_cast<const frt::ubyte*>(from), length);
 
-  if (from < to) {
-    // `__restrict` may or may not be satisfied here, so we can't just call `__frt_mem_copy`
-    while (length-- > 0) {
-      *dst++ = *src++;
-    }
-  } else {
-    dst += length - 1;
-    src += length - 1;
+  return to;
+}
 
-    while (length-- > 0) {
-      *dst-- = *src--;
-    }
-  }
+extern "C" void* frt::__frt_mem_set(void* to, int value, frt::usize length) noexcept {
+  FRT_MEM_KERNEL(set)(static_cast<frt::ubyte*>(to), static_cast<frt::ubyte>(value), length);
 
   return to;
 }
 
-extern "C" FRT_ALWAYS_INLINE void* frt::__frt_mem_set(void* to, int value, frt::usize length) noexcept {
-  // TODO: fast mem_set
-  auto* dst = static_cast<frt::ubyte*>(to);
+extern "C" int frt::__frt_mem_compare(const void* lhs, const void* rhs, frt::usize length) noexcept {
+  return FRT_MEM_KERNEL(compare)(static_cast<const frt::ubyte*>(lhs), static_cast<const frt::ubyte*>(rhs), length);
+}
 
-  while (length-- > 0) {
-    *dst++ = static_cast<frt::ubyte>(value);
-  }
+extern "C" bool frt::__frt_mem_equal(const void* lhs, const void* rhs, frt::usize length) noexcept {
+  return FRT_MEM_KERNEL(equal)(static_cast<const frt::ubyte*>(lhs), static_cast<const frt::ubyte*>(rhs), length);
+}
 
-  return dst;
+extern "C" void* frt::__frt_mem_copy_stream(void* __restrict to,
+    const void* __restrict from,
+    frt::usize length) noexcept {
+  FRT_MEM_KERNEL(copy_stream)(static_cast<frt::ubyte*>(to), static_cast<const frt::ubyte*>(from), length);
+
+  return to;
 }
 
-extern "C" FRT_ALWAYS_INLINE int frt::__frt_mem_compare(const void* lhs, const void* rhs, frt::usize length) noexcept {
-  const auto* a = static_cast<const frt::ubyte*>(lhs);
-  const auto* b = static_cast<const frt::ubyte*>(rhs);
+extern "C" void* frt::__frt_mem_set_stream(void* to, int value, frt::usize length) noexcept {
+  FRT_MEM_KERNEL(set_stream)(static_cast<frt::ubyte*>(to), static_cast<frt::ubyte>(value), length);
 
-  while (length-- > 0) {
-    if (*a++ != *b++) {
-      return (a[-1] < b[-1]) ? -1 : 1;
-    }
-  }
+  return to;
+}
+
+// the search kernels return `const` pointers, the C-style API gives back a mutable one like `memchr` does
+
+extern "C" void* frt::__frt_mem_find_byte(const void* haystack, int value, frt::usize length) noexcept {
+  auto* src = static_cast<const frt::ubyte*>(haystack);
+  auto* found = FRT_MEM_KERNEL(find_byte)(src, static_cast<frt::ubyte>(value), length);
+
+  return const_cast<frt::ubyte*>(found);
+}
+
+extern "C" void* frt::__frt_mem_rfind_byte(const void* haystack, int value, frt::usize length) noexcept {
+  auto* src = static_cast<const frt::ubyte*>(haystack);
+  auto* found = FRT_MEM_KERNEL(rfind_byte)(src, static_cast<frt::ubyte>(value), length);
+
+  return const_cast<frt::ubyte*>(found);
+}
 
-  return 0;
+extern "C" void* frt::__frt_mem_find_any_of(const void* haystack,
+    frt::usize length,
+    const void* set,
+    frt::usize set_length) noexcept {
+  auto* found = FRT_MEM_KERNEL(find_any_of)(static_cast<const frt::ubyte*>(haystack),
+      length,
+      static_cast<const frt::ubyte*>(set),
+      set_length);
+
+  return const_cast<frt::ubyte*>(found);
+}
+
+extern "C" frt::usize frt::__frt_mem_count_byte(const void* haystack, int value, frt::usize length) noexcept {
+  return FRT_MEM_KERNEL(count_byte)(static_cast<const frt::ubyte*>(haystack), static_cast<frt::ubyte>(value), length);
 }
 
 #ifdef FRT_GENERATE_DEFAULT_MEM_INTRINS
 
-// all of these just fall back to the `__frt` functions, but are force-inlined to avoid the call overhead.
-// this also makes it equivalent to calling the other one without breaking the expectation that these symbols
-// actually exist like would happen with `__attribute__((alias))`
+// all of these just fall back to the `__frt` functions. these are real definitions rather than
+// `__attribute__((alias))` so that the symbols exist on every object format we care about
 
-extern "C" void* memcpy(void* __restrict to, const void* __restrict from, frt::usize length) noexcept {
+extern "C" void* memcpy(void* __restrict to, const void* __restrict from, frt::usize length) {
   return frt::__frt_mem_copy(to, from, length);
 }
 
-extern "C" void* memmove(void* to, const void* from, frt::usize length) noexcept {
+extern "C" void* memmove(void* to, const void* from, frt::usize length) {
   return frt::__frt_mem_move(to, from, length);
 }
 
-extern "C" void* memset(void* to, int value, frt::usize length) noexcept {
+extern "C" void* memset(void* to, int value, frt::usize length) {
   return frt::__frt_mem_set(to, value, length);
 }
 
-extern "C" int memcmp(const void* lhs, const void* rhs, frt::usize length) noexcept {
+extern "C" int memcmp(const void* lhs, const void* rhs, frt::usize length) {
   return frt::__frt_mem_compare(lhs, rhs, length);
 }
 
-#endif
\ No newline at end of file
+// not declared in <frt/core/memory.h>, since C++ <cstring> declares `const`-correct overloads instead
+extern "C" void* memchr(const void* haystack, int value, frt::usize length);
+
+extern "C" void* memchr(const void* haystack, int value, frt::usize length) {
+  return frt::__frt_mem_find_byte(haystack, value, length);
+}
+
+// compilers are allowed to lower `memcmp(...) == 0` into this, so it needs to exist too
+extern "C" int bcmp(const void* lhs, const void* rhs, frt::usize length);
+
+extern "C" int bcmp(const void* lhs, const void* rhs, frt::usize length) {
+  return frt::__frt_mem_equal(lhs, rhs, length) ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,24 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+// this TU is built with `-mavx2` (see src/CMakeLists.txt), so every kernel in here ends up using
+// 256-bit blocks. nothing in here is ever called unless `cpu_features()` says AVX2 is usable
+
+#include "./memory_dispatch.h"
+
+#if defined(FRT_MEM_USE_DISPATCH)
+
+static_assert(__AVX2__, "memory_avx2.cc must be built with AVX2 enabled");
+
+frt::internal::MemKernels frt::internal::mem_kernels_avx2(frt::CPUFeatures features) noexcept {
+  return make_mem_kernels(features);
+}
+
+#endif
@@ -0,0 +1,146 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include "frt/core/memory.h"
+#include "frt/core/internal/memory_kernels.h"
+#include "frt/platform/architecture.h"
+#include "frt/platform/cpu.h"
+#include "frt/platform/macros.h"
+
+// runtime dispatch only has anything to choose between on x86-64 right now
+#if defined(FRT_MEM_RUNTIME_DISPATCH) && defined(FRT_ARCH_X86_64)
+#define FRT_MEM_USE_DISPATCH
+#endif
+
+namespace frt::internal {
+  /// The set of memory kernels that the `__frt_mem_*` functions dispatch to
+  struct MemKernels {
+    void (*copy)(frt::ubyte* dst, const frt::ubyte* src, frt::usize length) noexcept;
+    void (*move)(frt::ubyte* dst, const frt::ubyte* src, frt::usize length) noexcept;
+    void (*set)(frt::ubyte* dst, frt::ubyte value, frt::usize length) noexcept;
+    int (*compare)(const frt::ubyte* lhs, const frt::ubyte* rhs, frt::usize length) noexcept;
+    bool (*equal)(const frt::ubyte* lhs, const frt::ubyte* rhs, frt::usize length) noexcept;
+    void (*copy_stream)(frt::ubyte* dst, const frt::ubyte* src, frt::usize length) noexcept;
+    void (*set_stream)(frt::ubyte* dst, frt::ubyte value, frt::usize length) noexcept;
+    const frt::ubyte* (*find_byte)(const frt::ubyte* src, frt::ubyte value, frt::usize length) noexcept;
+    const frt::ubyte* (*rfind_byte)(const frt::ubyte* src, frt::ubyte value, frt::usize length) noexcept;
+    const frt::ubyte* (*find_any_of)(const frt::ubyte* src,
+        frt::usize length,
+        const frt::ubyte* set,
+        frt::usize set_length) noexcept;
+    frt::usize (*count_byte)(const frt::ubyte* src, frt::ubyte value, frt::usize length) noexcept;
+  };
+
+#if defined(FRT_MEM_USE_DISPATCH)
+  /// Gets the kernels compiled for the baseline ISA of the build, tuned for `features`
+  ///
+  /// \param features The features of the current CPU
+  /// \return The kernel table
+  MemKernels mem_kernels_baseline(frt::CPUFeatures features) noexcept;
+
+  /// Gets the kernels compiled with AVX2 enabled, tuned for `features`. Only valid to
+  /// use if `features` contains `CPUFeature::x86_avx2`
+  ///
+  /// \param features The features of the current CPU
+  /// \return The kernel table
+  MemKernels mem_kernels_avx2(frt::CPUFeatures features) noexcept;
+#endif
+} // namespace frt::internal
+
+//
+// NOTE: this is included into one TU per instruction set that we build kernels for, the kernel
+// wrappers are in an anonymous namespace so that each of those TUs gets their own copies.
+//
+
+namespace {
+  template <frt::usize RepMovsbThreshold>
+  void copy_kernel(frt::ubyte* dst, const frt::ubyte* src, frt::usize length) noexcept {
+    frt::internal::mem::copy_bytes<RepMovsbThreshold>(dst, src, length);
+  }
+
+  template <frt::usize RepMovsbThreshold>
+  void move_kernel(frt::ubyte* dst, const frt::ubyte* src, frt::usize length) noexcept {
+    frt::internal::mem::move_bytes<RepMovsbThreshold>(dst, src, length);
+  }
+
+  inline void set_kernel(frt::ubyte* dst, frt::ubyte value, frt::usize length) noexcept {
+    frt::internal::mem::set_bytes(dst, value, length);
+  }
+
+  inline int compare_kernel(const frt::ubyte* lhs, const frt::ubyte* rhs, frt::usize length) noexcept {
+    return frt::internal::mem::compare_bytes(lhs, rhs, length);
+  }
+
+  inline bool equal_kernel(const frt::ubyte* lhs, const frt::ubyte* rhs, frt::usize length) noexcept {
+    return frt::internal::mem::equal_bytes(lhs, rhs, length);
+  }
+
+  inline void copy_stream_kernel(frt::ubyte* dst, const frt::ubyte* src, frt::usize length) noexcept {
+    frt::internal::mem::copy_stream_bytes(dst, src, length);
+  }
+
+  inline void set_stream_kernel(frt::ubyte* dst, frt::ubyte value, frt::usize length) noexcept {
+    frt::internal::mem::set_stream_bytes(dst, value, length);
+  }
+
+  inline const frt::ubyte* find_byte_kernel(const frt::ubyte* src, frt::ubyte value, frt::usize length) noexcept {
+    return frt::internal::mem::find_byte_bytes(src, value, length);
+  }
+
+  inline const frt::ubyte* rfind_byte_kernel(const frt::ubyte* src, frt::ubyte value, frt::usize length) noexcept {
+    return frt::internal::mem::rfind_byte_bytes(src, value, length);
+  }
+
+  inline const frt::ubyte* find_any_of_kernel(const frt::ubyte* src,
+      frt::usize length,
+      const frt::ubyte* set,
+      frt::usize set_length) noexcept {
+    return frt::internal::mem::find_any_of_bytes(src, length, set, set_length);
+  }
+
+  inline frt::usize count_byte_kernel(const frt::ubyte* src, frt::ubyte value, frt::usize length) noexcept {
+    return frt::internal::mem::count_byte_bytes(src, value, length);
+  }
+
+  template <frt::usize RepMovsbThreshold>
+  FRT_ALWAYS_INLINE frt::internal::MemKernels make_mem_kernels_with() noexcept {
+    return frt::internal::MemKernels{&copy_kernel<RepMovsbThreshold>,
+        &move_kernel<RepMovsbThreshold>,
+        &set_kernel,
+        &compare_kernel,
+        &equal_kernel,
+        &copy_stream_kernel,
+        &set_stream_kernel,
+        &find_byte_kernel,
+        &rfind_byte_kernel,
+        &find_any_of_kernel,
+        &count_byte_kernel};
+  }
+
+  // builds a kernel table out of the kernels compiled into the including TU, picking
+  // the best variants of them for `features`
+  FRT_ALWAYS_INLINE frt::internal::MemKernels make_mem_kernels(frt::CPUFeatures features) noexcept {
+#if defined(FRT_ARCH_X86_64)
+    if (features.has(frt::CPUFeature::x86_fsrm)) {
+      return make_mem_kernels_with<frt::internal::mem::rep_movsb_fsrm_threshold>();
+    }
+
+    if (features.has(frt::CPUFeature::x86_erms)) {
+      return make_mem_kernels_with<frt::internal::mem::rep_movsb_erms_threshold>();
+    }
+#else
+    (void)features;
+#endif
+
+    return make_mem_kernels_with<0>();
+  }
+} // namespace
@@ -0,0 +1,361 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "frt/core/allocators/tlsf_allocator.h"
+#include "frt/core/bit.h"
+#include "frt/platform/macros.h"
+#include "frt/runtime/assert.h"
+
+namespace frt::internal::tlsf {
+  // `prev_phys` is physically the last word of the previous block's payload, and is only valid while that
+  // block is free. `size` is the size of the payload, with the low bits used as flags. the free list links
+  // are only valid while the block itself is free, otherwise they're part of the payload
+  struct Block {
+    Block* prev_phys;
+    frt::usize size;
+    Block* next_free;
+    Block* prev_free;
+  };
+} // namespace frt::internal::tlsf
+
+namespace {
+  namespace tlsf = frt::internal::tlsf;
+
+  using tlsf::Block;
+
+  constexpr frt::usize free_bit = 1;
+  constexpr frt::usize prev_free_bit = 2;
+  constexpr frt::usize flag_bits = free_bit | prev_free_bit;
+
+  // the only overhead of a used block is its size, `prev_phys` is stored in the previous block
+  constexpr frt::usize header_overhead = sizeof(frt::usize);
+
+  // payloads start right after `size`
+  constexpr frt::usize payload_offset = sizeof(Block*) + sizeof(frt::usize);
+
+  // a free block needs room for the free list links and the next block's `prev_phys`
+  constexpr frt::usize min_block_size = sizeof(Block) - sizeof(Block*);
+
+  static_assert(flag_bits < tlsf::align_size, "flags need to fit in the always-zero bits of a size");
+
+  struct Mapping {
+    frt::usize fl;
+    frt::usize sl;
+  };
+
+  FRT_ALWAYS_INLINE frt::usize align_up(frt::usize value, frt::usize align) noexcept {
+    return (value + (align - 1)) & ~(align - 1);
+  }
+
+  FRT_ALWAYS_INLINE frt::usize block_size(const Block* block) noexcept {
+    return block->size & ~flag_bits;
+  }
+
+  FRT_ALWAYS_INLINE bool is_free(const Block* block) noexcept {
+    return (block->size & free_bit) != 0;
+  }
+
+  FRT_ALWAYS_INLINE bool is_prev_free(const Block* block) noexcept {
+    return (block->size & prev_free_bit) != 0;
+  }
+
+  FRT_ALWAYS_INLINE void* to_payload(Block* block) noexcept {
+    return reinterpret_cast<frt::ubyte*>(block) + payload_offset;
+  }
+
+  FRT_ALWAYS_INLINE Block* from_payload(void* ptr) noexcept {
+    return reinterpret_cast<Block*>(static_cast<frt::ubyte*>(ptr) - payload_offset);
+  }
+
+  // the next block's header overlaps the last word of this block's payload
+  FRT_ALWAYS_INLINE Block* next_phys(Block* block) noexcept {
+    return reinterpret_cast<Block*>(static_cast<frt::ubyte*>(to_payload(block)) + block_size(block) - header_overhead);
+  }
+
+  FRT_ALWAYS_INLINE Block* link_next(Block* block) noexcept {
+    auto* next = next_phys(block);
+
+    next->prev_phys = block;
+
+    return next;
+  }
+
+  FRT_ALWAYS_INLINE void mark_free(Block* block) noexcept {
+    auto* next = link_next(block);
+
+    next->size |= prev_free_bit;
+    block->size |= free_bit;
+  }
+
+  FRT_ALWAYS_INLINE void mark_used(Block* block) noexcept {
+    auto* next = next_phys(block);
+
+    next->size &= ~prev_free_bit;
+    block->size &= ~free_bit;
+  }
+
+  // the bins that a block of exactly `size` bytes goes into
+  FRT_ALWAYS_INLINE Mapping mapping_insert(frt::usize size) noexcept {
+    if (size < tlsf::small_block_size) {
+      return Mapping{0, size / (tlsf::small_block_size / tlsf::sl_count)};
+    }
+
+    auto fl = frt::bit_width(size) - 1;
+    auto sl = (size >> (fl - tlsf::sl_count_log2)) ^ tlsf::sl_count;
+
+    return Mapping{fl - (tlsf::fl_index_shift - 1), sl};
+  }
+
+  // the first bins where *every* block is at least `size` bytes, so the first block found can be used as-is
+  FRT_ALWAYS_INLINE Mapping mapping_search(frt::usize size) noexcept {
+    if (size >= tlsf::small_block_size) {
+      size += (frt::usize{1} << (frt::bit_width(size) - 1 - tlsf::sl_count_log2)) - 1;
+    }
+
+    return mapping_insert(size);
+  }
+
+  FRT_ALWAYS_INLINE frt::u32 bits_from(frt::usize index) noexcept {
+    return index >= 32 ? 0 : ~frt::u32{0} << index;
+  }
+
+  // the payload size that's actually allocated for a request, or 0 if it's too big to ever fit
+  FRT_ALWAYS_INLINE frt::usize adjust_size(frt::usize size, frt::usize align) noexcept {
+    if (size >= frt::TLSFHeap::max_block_size) {
+      return 0;
+    }
+
+    auto adjusted = align_up(size, align);
+
+    return adjusted < min_block_size ? min_block_size : adjusted;
+  }
+} // namespace
+
+namespace frt {
+  TLSFHeap::TLSFHeap(void* region, frt::usize bytes) noexcept {
+    auto begin = reinterpret_cast<frt::usize>(region);
+    auto start = align_up(begin, tlsf::align_size);
+    auto end = (begin + bytes) & ~(tlsf::align_size - 1);
+
+    // the pool is one big free block followed by a zero-sized sentinel block that's always "used"
+    if (end < start || end - start < 2 * header_overhead + min_block_size) {
+      return;
+    }
+
+    auto pool_bytes = end - start - 2 * header_overhead;
+
+    if (pool_bytes >= max_block_size) {
+      pool_bytes = max_block_size - tlsf::align_size;
+    }
+
+    // the first block's `prev_phys` would be before the region, but it's never touched because
+    // the first block never has a free block before it
+    auto* block = reinterpret_cast<Block*>(start - header_overhead);
+
+    block->size = pool_bytes | free_bit;
+    insert(block);
+
+    auto* sentinel = link_next(block);
+
+    sentinel->size = prev_free_bit;
+  }
+
+  void* TLSFHeap::allocate(frt::usize size, frt::usize align) noexcept {
+    FRT_ASSERT(frt::has_single_bit(align), "alignment must be a power of two");
+
+    auto adjusted = adjust_size(size, tlsf::align_size);
+
+    if (FRT_UNLIKELY(adjusted == 0)) {
+      return nullptr;
+    }
+
+    if (FRT_LIKELY(align <= tlsf::align_size)) {
+      auto* block = find_suitable(adjusted);
+
+      if (FRT_UNLIKELY(block == nullptr)) {
+        return nullptr;
+      }
+
+      block = split(block, adjusted);
+      mark_used(block);
+
+      return to_payload(block);
+    }
+
+    // over-aligned, find a block big enough that an aligned payload fits *somewhere* inside it. if there's
+    // a gap before that payload, it's split off as its own free block so it needs to be big enough for that
+    constexpr auto gap_minimum = sizeof(Block);
+    auto with_gap = adjust_size(adjusted + align + gap_minimum, align);
+
+    if (FRT_UNLIKELY(with_gap == 0)) {
+      return nullptr;
+    }
+
+    auto* block = find_suitable(with_gap);
+
+    if (FRT_UNLIKELY(block == nullptr)) {
+      return nullptr;
+    }
+
+    auto payload = reinterpret_cast<frt::usize>(to_payload(block));
+    auto aligned = align_up(payload, align);
+
+    if (aligned != payload && aligned - payload < gap_minimum) {
+      aligned = align_up(payload + gap_minimum, align);
+    }
+
+    if (auto gap = aligned - payload; gap != 0) {
+      // `block` keeps the gap and goes back on the free lists, the rest of it becomes our block
+      auto* rest = reinterpret_cast<Block*>(aligned - payload_offset);
+
+      rest->size = block_size(block) - gap;
+      block->size = (gap - header_overhead) | (block->size & prev_free_bit);
+
+      mark_free(block);
+      insert(block);
+    }
+
+    auto* aligned_block = reinterpret_cast<Block*>(aligned - payload_offset);
+
+    aligned_block = split(aligned_block, adjusted);
+    mark_used(aligned_block);
+
+    return to_payload(aligned_block);
+  }
+
+  void TLSFHeap::deallocate(void* ptr, frt::usize /*unused*/) noexcept {
+    if (ptr == nullptr) {
+      return;
+    }
+
+    auto* block = from_payload(ptr);
+
+    FRT_ASSERT(!is_free(block), "double free of TLSF block");
+
+    mark_free(block);
+
+    // coalescing with the previous block
+    if (is_prev_free(block)) {
+      auto* prev = block->prev_phys;
+
+      remove(prev);
+      prev->size += block_size(block) + header_overhead;
+      link_next(prev);
+      block = prev;
+    }
+
+    // coalescing with the next block. the sentinel is never free, so this never runs off the end
+    if (auto* next = next_phys(block); is_free(next)) {
+      remove(next);
+      block->size += block_size(next) + header_overhead;
+      link_next(block);
+    }
+
+    insert(block);
+  }
+
+  frt::usize TLSFHeap::usable_size(const void* ptr) noexcept {
+    return block_size(from_payload(const_cast<void*>(ptr)));
+  }
+
+  void TLSFHeap::insert(Block* block) noexcept {
+    auto [fl, sl] = mapping_insert(block_size(block));
+    auto* head = free_[fl][sl];
+
+    block->next_free = head;
+    block->prev_free = nullptr;
+
+    if (head != nullptr) {
+      head->prev_free = block;
+    }
+
+    free_[fl][sl] = block;
+    fl_bitmap_ |= frt::u32{1} << fl;
+    sl_bitmap_[fl] |= frt::u32{1} << sl;
+  }
+
+  void TLSFHeap::remove(Block* block) noexcept {
+    auto [fl, sl] = mapping_insert(block_size(block));
+
+    remove(block, fl, sl);
+  }
+
+  void TLSFHeap::remove(Block* block, frt::usize fl, frt::usize sl) noexcept {
+    auto* prev = block->prev_free;
+    auto* next = block->next_free;
+
+    if (next != nullptr) {
+      next->prev_free = prev;
+    }
+
+    if (prev != nullptr) {
+      prev->next_free = next;
+    } else {
+      free_[fl][sl] = next;
+
+      if (next == nullptr) {
+        sl_bitmap_[fl] &= ~(frt::u32{1} << sl);
+
+        if (sl_bitmap_[fl] == 0) {
+          fl_bitmap_ &= ~(frt::u32{1} << fl);
+        }
+      }
+    }
+  }
+
+  // finds (and removes) a free block of at least `size` bytes with two bit scans
+  TLSFHeap::Block* TLSFHeap::find_suitable(frt::usize size) noexcept {
+    auto [fl, sl] = mapping_search(size);
+
+    if (FRT_UNLIKELY(fl >= tlsf::fl_count)) {
+      return nullptr;
+    }
+
+    auto sl_map = sl_bitmap_[fl] & bits_from(sl);
+
+    if (sl_map == 0) {
+      auto fl_map = fl_bitmap_ & bits_from(fl + 1);
+
+      if (FRT_UNLIKELY(fl_map == 0)) {
+        return nullptr;
+      }
+
+      fl = static_cast<frt::usize>(frt::countr_zero(fl_map));
+      sl_map = sl_bitmap_[fl];
+    }
+
+    sl = static_cast<frt::usize>(frt::countr_zero(sl_map));
+
+    auto* block = free_[fl][sl];
+
+    remove(block, fl, sl);
+
+    return block;
+  }
+
+  // trims a (free, not on any list) block down to `size` bytes, putting the rest back on the free lists
+  TLSFHeap::Block* TLSFHeap::split(Block* block, frt::usize size) noexcept {
+    if (block_size(block) < size + sizeof(Block)) {
+      return block;
+    }
+
+    auto* rest = reinterpret_cast<Block*>(static_cast<frt::ubyte*>(to_payload(block)) + size - header_overhead);
+
+    rest->size = block_size(block) - (size + header_overhead);
+    block->size = size | (block->size & flag_bits);
+
+    mark_free(rest);
+    link_next(block);
+    rest->size |= prev_free_bit;
+    insert(rest);
+
+    return block;
+  }
+} // namespace frt
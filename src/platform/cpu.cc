@@ -0,0 +1,174 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "frt/platform/cpu.h"
+#include "frt/sync/atomic.h"
+
+#if defined(FRT_ARCH_X86_64)
+#include <cpuid.h>
+#elif defined(FRT_ARCH_ARM64) && defined(FRT_OS_LINUX) && __STDC_HOSTED__
+#include <sys/auxv.h>
+#endif
+
+namespace {
+  // set in the cached bits once detection has run, so that a CPU with
+  // no detectable features doesn't get re-detected on every call
+  constexpr frt::u64 detected_bit = frt::u64{1} << 63;
+
+  frt::Atomic<frt::u64> cached_features{0};
+
+#if defined(FRT_ARCH_X86_64) || defined(FRT_ARCH_ARM64)
+  // adds `feature` to `features` if `present` is true
+  FRT_ALWAYS_INLINE void add_if(frt::CPUFeatures& features, bool present, frt::CPUFeature feature) noexcept {
+    if (present) {
+      features.add(feature);
+    }
+  }
+#endif
+
+#if defined(FRT_ARCH_X86_64)
+  FRT_ALWAYS_INLINE bool bit_set(frt::u32 value, int bit) noexcept {
+    return ((value >> bit) & 1) != 0;
+  }
+
+  FRT_ALWAYS_INLINE frt::u64 xgetbv(frt::u32 index) noexcept {
+    frt::u32 lo = 0;
+    frt::u32 hi = 0;
+
+    // spelled out as bytes, older assemblers don't know the mnemonic
+    asm volatile(".byte 0x0f, 0x01, 0xd0" : "=a"(lo), "=d"(hi) : "c"(index));
+
+    return (static_cast<frt::u64>(hi) << 32) | lo;
+  }
+
+  frt::CPUFeatures detect() noexcept {
+    auto features = frt::CPUFeatures{};
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+
+    if (__get_cpuid(0, &eax, &ebx, &ecx, &edx) == 0) {
+      return features;
+    }
+
+    auto max_leaf = eax;
+
+    __cpuid(1, eax, ebx, ecx, edx);
+
+    auto os_avx = false;
+    auto os_avx512 = false;
+
+    // the CPU supporting AVX doesn't mean anything if the OS doesn't save the registers
+    // on a context switch, `xgetbv` tells us which register state the OS has enabled
+    if (bit_set(ecx, 27)) {
+      auto xcr0 = xgetbv(0);
+
+      os_avx = (xcr0 & 0x06) == 0x06;    // XMM | YMM
+      os_avx512 = (xcr0 & 0xE6) == 0xE6; // XMM | YMM | opmask | ZMM_Hi256 | Hi16_ZMM
+    }
+
+    add_if(features, bit_set(ecx, 0), frt::CPUFeature::x86_sse3);
+    add_if(features, bit_set(ecx, 9), frt::CPUFeature::x86_ssse3);
+    add_if(features, bit_set(ecx, 19), frt::CPUFeature::x86_sse41);
+    add_if(features, bit_set(ecx, 20), frt::CPUFeature::x86_sse42);
+    add_if(features, bit_set(ecx, 23), frt::CPUFeature::x86_popcnt);
+    add_if(features, bit_set(ecx, 28) && os_avx, frt::CPUFeature::x86_avx);
+    add_if(features, bit_set(edx, 19), frt::CPUFeature::x86_clflush);
+
+    if (max_leaf >= 7) {
+      __cpuid_count(7, 0, eax, ebx, ecx, edx);
+
+      add_if(features, bit_set(ebx, 3), frt::CPUFeature::x86_bmi1);
+      add_if(features, bit_set(ebx, 5) && os_avx, frt::CPUFeature::x86_avx2);
+      add_if(features, bit_set(ebx, 8), frt::CPUFeature::x86_bmi2);
+      add_if(features, bit_set(ebx, 9), frt::CPUFeature::x86_erms);
+      add_if(features, bit_set(ebx, 16) && os_avx512, frt::CPUFeature::x86_avx512f);
+      add_if(features, bit_set(ebx, 23), frt::CPUFeature::x86_clflushopt);
+      add_if(features, bit_set(ebx, 24), frt::CPUFeature::x86_clwb);
+      add_if(features, bit_set(ebx, 30) && os_avx512, frt::CPUFeature::x86_avx512bw);
+      add_if(features, bit_set(ebx, 31) && os_avx512, frt::CPUFeature::x86_avx512vl);
+      add_if(features, bit_set(edx, 4), frt::CPUFeature::x86_fsrm);
+    }
+
+    return features;
+  }
+#elif defined(FRT_ARCH_ARM64)
+  // extracts the 4-bit ID register field starting at `shift`
+  FRT_ALWAYS_INLINE frt::u64 id_field(frt::u64 reg, int shift) noexcept {
+    return (reg >> shift) & 0xF;
+  }
+
+  // the registers are spelled by encoding, older assemblers don't know all of the names
+#define FRT_READ_ID_REGISTER(encoding, out) asm volatile("mrs %0, " encoding : "=r"(out))
+
+  // the ID registers are only readable at EL1. at EL0 the read is undefined unless the OS traps and emulates it,
+  // which Linux only does from 4.11 (and advertises with `HWCAP_CPUID`). freestanding code is assumed to be a
+  // kernel, hosted code has to ask the OS. elsewhere, only the features every AArch64 OS provides are reported
+  bool can_read_id_registers() noexcept {
+#if !__STDC_HOSTED__
+    return true;
+#elif defined(FRT_OS_LINUX)
+    constexpr unsigned long hwcap_cpuid = 1UL << 11;
+
+    return (getauxval(AT_HWCAP) & hwcap_cpuid) != 0;
+#else
+    return false;
+#endif
+  }
+
+  frt::CPUFeatures detect() noexcept {
+    auto features = frt::CPUFeatures{};
+    frt::u64 isar0 = 0, isar1 = 0, isar2 = 0, pfr0 = 0;
+
+    if (!can_read_id_registers()) {
+      features.add(frt::CPUFeature::arm64_neon);
+
+      return features;
+    }
+
+    FRT_READ_ID_REGISTER("s3_0_c0_c6_0", isar0); // ID_AA64ISAR0_EL1
+    FRT_READ_ID_REGISTER("s3_0_c0_c6_1", isar1); // ID_AA64ISAR1_EL1
+    FRT_READ_ID_REGISTER("s3_0_c0_c6_2", isar2); // ID_AA64ISAR2_EL1
+    FRT_READ_ID_REGISTER("s3_0_c0_c4_0", pfr0);  // ID_AA64PFR0_EL1
+
+    add_if(features, id_field(pfr0, 20) != 0xF, frt::CPUFeature::arm64_neon);
+    add_if(features, id_field(pfr0, 32) != 0, frt::CPUFeature::arm64_sve);
+    add_if(features, id_field(isar0, 16) != 0, frt::CPUFeature::arm64_crc32);
+    add_if(features, id_field(isar0, 20) >= 2, frt::CPUFeature::arm64_lse);
+    add_if(features, id_field(isar1, 0) != 0, frt::CPUFeature::arm64_dpb);
+    add_if(features, id_field(isar2, 16) != 0, frt::CPUFeature::arm64_mops);
+
+    return features;
+  }
+
+#undef FRT_READ_ID_REGISTER
+#else
+  frt::CPUFeatures detect() noexcept {
+    return frt::CPUFeatures{};
+  }
+#endif
+} // namespace
+
+namespace frt {
+  CPUFeatures detect_cpu_features() noexcept {
+    return detect();
+  }
+
+  CPUFeatures cpu_features() noexcept {
+    auto bits = cached_features.load(frt::memory_order_relaxed);
+
+    if (FRT_UNLIKELY((bits & detected_bit) == 0)) {
+      // every thread that races on this computes the same value, so a relaxed store is fine
+      bits = detect().bits() | detected_bit;
+
+      cached_features.store(bits, frt::memory_order_relaxed);
+    }
+
+    return CPUFeatures{bits & ~detected_bit};
+  }
+} // namespace frt
@@ -0,0 +1,352 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+// Measures `__frt_mem_{copy, move, set, compare}` against the host libc's `mem{cpy, move, set, cmp}`.
+//
+// Usage: frt_bench_mem [copy|move|set|compare]... [--hot|--cold] [--max-size BYTES]
+//
+// Every power-of-two size from 1B up to `--max-size` (default 64MiB) is run at a few source/destination
+// misalignments, both with the buffers hot in cache and with them flushed out of every level before each
+// call. Results are reported in ns/call, GB/s and cycles/byte. Cycles are TSC ticks on x86-64, which tick at
+// a constant rate rather than the core clock, and aren't reported at all on other architectures.
+
+#include "frt/core/memory.h"
+#include "frt/platform/architecture.h"
+#include "frt/platform/cache.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <vector>
+
+#if defined(FRT_ARCH_X86_64)
+#include <x86intrin.h>
+#endif
+
+namespace {
+  using CopyFn = void* (*)(void*, const void*, frt::usize);
+  using SetFn = void* (*)(void*, int, frt::usize);
+  using CompareFn = int (*)(const void*, const void*, frt::usize);
+
+  struct Implementation {
+    const char* name;
+    CopyFn copy;
+    CopyFn move;
+    SetFn set;
+    CompareFn compare;
+  };
+
+  enum class Op { copy, move, set, compare };
+
+  struct Alignment {
+    frt::usize src;
+    frt::usize dst;
+  };
+
+  struct Sample {
+    double ns;
+    double ticks;
+  };
+
+  // the buffers get this much slack past `max_size`, enough for the misalignments and the `move` overlap
+  constexpr frt::usize slack = 4096;
+
+  constexpr frt::usize move_distance = 64;
+
+  constexpr Alignment alignments[] = {{0, 0}, {1, 0}, {0, 1}, {7, 13}, {32, 3}};
+
+  // when FRT generates `memcpy` and friends they end up linked into this executable, so
+  // the libc versions need to be looked up *past* them instead of just referenced by name
+  template <typename F> F libc_symbol(const char* name) {
+    auto* symbol = ::dlsym(RTLD_NEXT, name);
+
+    if (symbol == nullptr) {
+      std::fprintf(stderr, "unable to find libc `%s`: %s\n", name, ::dlerror());
+      std::exit(1);
+    }
+
+    return reinterpret_cast<F>(symbol);
+  }
+
+  // forces the compiler to assume `value` is used and that memory was touched
+  template <typename T> FRT_ALWAYS_INLINE void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+  }
+
+  FRT_ALWAYS_INLINE std::uint64_t ticks() {
+#if defined(FRT_ARCH_X86_64)
+    _mm_lfence();
+    auto now = __rdtsc();
+    _mm_lfence();
+
+    return now;
+#else
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+#endif
+  }
+
+  // ticks per nanosecond, measured against the steady clock on x86-64 and exactly 1 everywhere else
+  double tick_rate() {
+#if defined(FRT_ARCH_X86_64)
+    using Clock = std::chrono::steady_clock;
+
+    auto start_time = Clock::now();
+    auto start = ticks();
+
+    while (Clock::now() - start_time < std::chrono::milliseconds(100)) {
+    }
+
+    auto elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start_time).count();
+
+    return static_cast<double>(ticks() - start) / elapsed;
+#else
+    return 1.0;
+#endif
+  }
+
+  void flush(const frt::ubyte* begin, frt::usize length) {
+    for (frt::usize i = 0; i < length; i += frt::cache_line_size) {
+      frt::cache_line_flush(begin + i);
+    }
+
+    frt::cache_line_flush(begin + length - 1);
+    frt::cache_line_fence();
+  }
+
+  class Bench {
+  public:
+    explicit Bench(frt::usize max_size)
+        : max_size_{max_size},
+          src_{allocate(max_size + slack)},
+          dst_{allocate(max_size + slack)},
+          tick_rate_{tick_rate()} {}
+
+    Bench(const Bench&) = delete;
+
+    Bench& operator=(const Bench&) = delete;
+
+    ~Bench() {
+      std::free(src_);
+      std::free(dst_);
+    }
+
+    Sample run(const Implementation& impl, Op op, frt::usize size, Alignment align, bool cold) {
+      auto* src = src_ + align.src;
+      auto* dst = dst_ + align.dst;
+
+      // `move` is run in-place on the destination, with the destination overlapping the end of the source.
+      // this forces the backwards copy, which is the case `memmove` actually exists for
+      if (op == Op::move) {
+        src = dst_ + align.src;
+        dst = dst_ + align.dst + move_distance;
+      }
+
+      // `compare` needs identical blocks to scan the whole length. earlier runs leave the buffers dirty (and a
+      // different misalignment lines up different bytes), but only the `size` bytes being compared need to match
+      if (op == Op::compare) {
+        std::memcpy(dst, src, size);
+      }
+
+      auto call = [&] {
+        switch (op) {
+          case Op::copy: do_not_optimize(impl.copy(dst, src, size)); break;
+          case Op::move: do_not_optimize(impl.move(dst, src, size)); break;
+          case Op::set: do_not_optimize(impl.set(dst, 0x5A, size)); break;
+          case Op::compare: do_not_optimize(impl.compare(dst, src, size)); break;
+        }
+      };
+
+      return cold ? run_cold(call, src, dst, size) : run_hot(call, size);
+    }
+
+    [[nodiscard]] bool has_cycles() const noexcept {
+#if defined(FRT_ARCH_X86_64)
+      return true;
+#else
+      return false;
+#endif
+    }
+
+  private:
+    static frt::ubyte* allocate(frt::usize size) {
+      auto* buffer = static_cast<frt::ubyte*>(std::aligned_alloc(4096, (size + 4095) & ~frt::usize{4095}));
+
+      if (buffer == nullptr) {
+        std::fprintf(stderr, "unable to allocate %zu bytes\n", size);
+        std::exit(1);
+      }
+
+      for (frt::usize i = 0; i < size; ++i) {
+        buffer[i] = static_cast<frt::ubyte>(i * 131 + 7);
+      }
+
+      return buffer;
+    }
+
+    // best of several batches, each batch is enough calls to move ~16MiB (or at least one call)
+    template <typename F> Sample run_hot(F call, frt::usize size) {
+      auto reps = std::clamp<frt::usize>((16 * 1024 * 1024) / size, 1, 100'000);
+      auto best = ~std::uint64_t{0};
+
+      call(); // warm up the cache and the branch predictors
+
+      for (auto batch = 0; batch < 5; ++batch) {
+        auto start = ticks();
+
+        for (frt::usize i = 0; i < reps; ++i) {
+          call();
+        }
+
+        best = std::min(best, ticks() - start);
+      }
+
+      return sample(static_cast<double>(best) / static_cast<double>(reps));
+    }
+
+    // median of individually timed calls, with everything the call touches flushed beforehand
+    template <typename F> Sample run_cold(F call, const frt::ubyte* src, const frt::ubyte* dst, frt::usize size) {
+      auto samples = std::clamp<frt::usize>((64 * 1024 * 1024) / size, 3, 201);
+      auto times = std::vector<std::uint64_t>(samples);
+
+      for (auto& time : times) {
+        flush(src, size + move_distance);
+        flush(dst, size + move_distance);
+
+        auto start = ticks();
+        call();
+        time = ticks() - start;
+      }
+
+      std::nth_element(times.begin(), times.begin() + static_cast<std::ptrdiff_t>(samples / 2), times.end());
+
+      return sample(static_cast<double>(times[samples / 2]));
+    }
+
+    [[nodiscard]] Sample sample(double elapsed) const noexcept {
+      return Sample{elapsed / tick_rate_, elapsed};
+    }
+
+    frt::usize max_size_;
+    frt::ubyte* src_;
+    frt::ubyte* dst_;
+    double tick_rate_;
+  };
+
+  const char* op_name(Op op) {
+    switch (op) {
+      case Op::copy: return "copy";
+      case Op::move: return "move";
+      case Op::set: return "set";
+      case Op::compare: return "compare";
+    }
+
+    return "?";
+  }
+
+  [[noreturn]] void usage(const char* self) {
+    std::fprintf(stderr, "usage: %s [copy|move|set|compare]... [--hot|--cold] [--max-size BYTES]\n", self);
+    std::exit(2);
+  }
+} // namespace
+
+int main(int argc, char** argv) {
+  auto ops = std::vector<Op>{};
+  auto hot = true;
+  auto cold = true;
+  auto max_size = frt::usize{64} * 1024 * 1024;
+
+  for (auto i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "copy") == 0) {
+      ops.push_back(Op::copy);
+    } else if (std::strcmp(argv[i], "move") == 0) {
+      ops.push_back(Op::move);
+    } else if (std::strcmp(argv[i], "set") == 0) {
+      ops.push_back(Op::set);
+    } else if (std::strcmp(argv[i], "compare") == 0) {
+      ops.push_back(Op::compare);
+    } else if (std::strcmp(argv[i], "--hot") == 0) {
+      cold = false;
+    } else if (std::strcmp(argv[i], "--cold") == 0) {
+      hot = false;
+    } else if (std::strcmp(argv[i], "--max-size") == 0 && i + 1 < argc) {
+      max_size = std::strtoull(argv[++i], nullptr, 0);
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  if (ops.empty()) {
+    ops = {Op::copy, Op::move, Op::set, Op::compare};
+  }
+
+  if (max_size == 0 || (!hot && !cold)) {
+    usage(argv[0]);
+  }
+
+  const Implementation impls[] = {
+      {"frt", &frt::__frt_mem_copy, &frt::__frt_mem_move, &frt::__frt_mem_set, &frt::__frt_mem_compare},
+      {"libc",
+          libc_symbol<CopyFn>("memcpy"),
+          libc_symbol<CopyFn>("memmove"),
+          libc_symbol<SetFn>("memset"),
+          libc_symbol<CompareFn>("memcmp")},
+  };
+
+  auto bench = Bench{max_size};
+
+  std::printf("%-8s %-5s %10s %4s %4s %-5s %12s %10s %10s\n",
+      "op",
+      "impl",
+      "size",
+      "src",
+      "dst",
+      "cache",
+      "ns/call",
+      "GB/s",
+      "cycles/B");
+
+  for (auto op : ops) {
+    for (frt::usize size = 1; size <= max_size; size *= 2) {
+      for (auto align : alignments) {
+        for (auto is_cold : {false, true}) {
+          if ((is_cold && !cold) || (!is_cold && !hot)) {
+            continue;
+          }
+
+          for (const auto& impl : impls) {
+            auto result = bench.run(impl, op, size, align, is_cold);
+            auto bytes = static_cast<double>(size);
+
+            std::printf("%-8s %-5s %10zu %4zu %4zu %-5s %12.2f %10.3f ",
+                op_name(op),
+                impl.name,
+                size,
+                align.src,
+                align.dst,
+                is_cold ? "cold" : "hot",
+                result.ns,
+                bytes / result.ns);
+
+            if (bench.has_cycles()) {
+              std::printf("%10.3f\n", result.ticks / bytes);
+            } else {
+              std::printf("%10s\n", "-");
+            }
+          }
+        }
+      }
+    }
+  }
+}
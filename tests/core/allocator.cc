@@ -0,0 +1,230 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "frt/core/allocator.h"
+#include "frt/core/allocators/alloc_ref.h"
+#include "frt/core/allocators/small_object_allocator.h"
+#include "frt/core/allocators/stack_allocator.h"
+#include "frt/core/allocators/tlsf_allocator.h"
+#include "frt/core/bump_alloc.h"
+#include "test_allocators.h"
+#include "gtest/gtest.h"
+#include <vector>
+
+namespace {
+  using Counting = frt::AllocatorTraits<CountingAllocator<int>>;
+  using Arena = frt::BumpAllocator<CountingAllocator<int>>;
+  using ArenaRef = frt::AllocRef<Arena, int>;
+  using Stack = frt::StackAllocator<int, 64>;
+
+  static_assert(!frt::internal::HasTryExpandInPlace<CountingAllocator<int>>);
+  static_assert(frt::internal::HasTryExpandInPlace<Stack>);
+  static_assert(frt::internal::HasTryExpandInPlace<ArenaRef>);
+  static_assert(frt::internal::HasAllocateAtLeast<frt::SmallObjectAllocator<int, TestPageSource>>);
+  static_assert(frt::internal::HasAllocateAtLeast<frt::TLSFAllocator<int>>);
+  static_assert(!frt::internal::HasAllocateAtLeast<ArenaRef>);
+  static_assert(!frt::internal::HasAllocateAligned<CountingAllocator<int>>);
+  static_assert(!frt::internal::HasAllocateAligned<Stack>);
+  static_assert(frt::internal::HasAllocateAligned<ArenaRef>);
+  static_assert(frt::internal::HasAllocateAligned<frt::SmallObjectAllocator<int, TestPageSource>>);
+
+  TEST(FrtCoreAllocatorTraits, Fallbacks) {
+    auto alloc = CountingAllocator<int>{};
+    auto result = Counting::allocate_at_least(alloc, 5);
+
+    EXPECT_EQ(result.count, 5);
+    EXPECT_FALSE(Counting::try_expand_in_place(alloc, result.ptr, 5, 6));
+
+    for (auto i = 0; i < 5; ++i) {
+      result.ptr[i] = i;
+    }
+
+    auto* bigger = Counting::reallocate(alloc, result.ptr, 5, 100);
+
+    ASSERT_NE(bigger, nullptr);
+
+    for (auto i = 0; i < 5; ++i) {
+      EXPECT_EQ(bigger[i], i);
+    }
+
+    auto* smaller = Counting::reallocate(alloc, bigger, 100, 2);
+
+    EXPECT_EQ(smaller[0], 0);
+    EXPECT_EQ(smaller[1], 1);
+
+    Counting::deallocate(alloc, smaller, 2);
+
+    // a failed allocation doesn't have any capacity
+    auto null = NullAllocator<int>{};
+    auto failed = frt::AllocatorTraits<NullAllocator<int>>::allocate_at_least(null, 5);
+
+    EXPECT_EQ(failed.ptr, nullptr);
+    EXPECT_EQ(failed.count, 0);
+  }
+
+  TEST(FrtCoreAllocatorTraits, ArenaExpandsInPlace) {
+    using Traits = frt::AllocatorTraits<ArenaRef>;
+
+    auto arena = Arena{};
+    auto alloc = ArenaRef{arena};
+    auto* first = Traits::allocate(alloc, 4);
+    auto* last = Traits::allocate(alloc, 4);
+
+    // only the most recent allocation can grow
+    EXPECT_FALSE(Traits::try_expand_in_place(alloc, first, 4, 8));
+    EXPECT_TRUE(Traits::try_expand_in_place(alloc, last, 4, 8));
+    EXPECT_EQ(Traits::reallocate(alloc, last, 8, 64), last);
+
+    auto* next = Traits::allocate(alloc, 1);
+
+    EXPECT_EQ(next, last + 64);
+
+    // a chunk can't grow though, so this has to move
+    *next = 42;
+
+    auto* moved = Traits::reallocate(alloc, next, 1, 10000);
+
+    ASSERT_NE(moved, next);
+    EXPECT_EQ(*moved, 42);
+  }
+
+  TEST(FrtCoreAllocatorTraits, StackExpandsInPlace) {
+    using Traits = frt::AllocatorTraits<Stack>;
+
+    auto arena = Stack::arena_type{};
+    auto stack = Stack{arena};
+    auto* p = Traits::allocate(stack, 2);
+
+    p[0] = 1;
+    p[1] = 2;
+
+    EXPECT_EQ(Traits::reallocate(stack, p, 2, 12), p);
+    EXPECT_EQ(arena.used(), 12 * sizeof(int));
+    EXPECT_EQ(Traits::reallocate(stack, p, 12, 4), p);
+    EXPECT_EQ(arena.used(), 4 * sizeof(int));
+  }
+
+  TEST(FrtCoreAllocatorTraits, AllocateAtLeast) {
+    using Traits = frt::AllocatorTraits<frt::SmallObjectAllocator<int, TestPageSource>>;
+
+    auto heap = frt::SmallObjectHeap<TestPageSource>{};
+    auto alloc = frt::SmallObjectAllocator<int, TestPageSource>{heap};
+
+    // 5 ints is 20 bytes, which gets a 32-byte block
+    auto result = Traits::allocate_at_least(alloc, 5);
+
+    EXPECT_EQ(result.count, 8);
+
+    // freeing with the reported count puts it back in the same class
+    Traits::deallocate(alloc, result.ptr, result.count);
+    EXPECT_EQ(Traits::allocate(alloc, 6), result.ptr);
+
+    auto region = std::vector<unsigned char>(4096);
+    auto tlsf = frt::TLSFHeap{region.data(), region.size()};
+    auto tlsf_alloc = frt::TLSFAllocator<int>{tlsf};
+    auto tlsf_result = frt::AllocatorTraits<frt::TLSFAllocator<int>>::allocate_at_least(tlsf_alloc, 3);
+
+    EXPECT_GE(tlsf_result.count, 3);
+    EXPECT_EQ(static_cast<frt::usize>(tlsf_result.count) * sizeof(int),
+        frt::TLSFHeap::usable_size(tlsf_result.ptr) / sizeof(int) * sizeof(int));
+  }
+
+  TEST(FrtCoreAllocatorTraits, AlignedFallback) {
+    using Bytes = frt::AllocatorTraits<CountingAllocator<char>>;
+
+    auto alloc = CountingAllocator<char>{};
+    auto before = counts;
+
+    for (auto align : {frt::usize{1}, frt::usize{16}, frt::usize{64}, frt::usize{4096}}) {
+      auto* a = Bytes::allocate_aligned(alloc, 3, align);
+      auto* b = Bytes::allocate_aligned(alloc, 1000, align);
+
+      ASSERT_NE(a, nullptr);
+      ASSERT_NE(b, nullptr);
+      EXPECT_TRUE(is_aligned(a, align));
+      EXPECT_TRUE(is_aligned(b, align));
+
+      // the whole block has to be usable
+      for (auto i = 0; i < 1000; ++i) {
+        b[i] = static_cast<char>(i);
+      }
+
+      Bytes::deallocate_aligned(alloc, a, 3, align);
+      Bytes::deallocate_aligned(alloc, b, 1000, align);
+    }
+
+    Bytes::deallocate_aligned(alloc, nullptr, 3, 64);
+
+    EXPECT_EQ(counts.live_allocations, before.live_allocations);
+    EXPECT_EQ(counts.live_bytes, before.live_bytes);
+
+    // nothing extra is allocated when the type is already aligned enough
+    auto ints = CountingAllocator<int>{};
+    auto* p = Counting::allocate_aligned(ints, 4, alignof(int));
+
+    EXPECT_EQ(counts.live_bytes, before.live_bytes + 4 * static_cast<frt::isize>(sizeof(int)));
+
+    Counting::deallocate_aligned(ints, p, 4, alignof(int));
+
+    // `nullptr` never reaches `deallocate`, even when nothing is over-aligned
+    Counting::deallocate_aligned(ints, nullptr, 1, alignof(int));
+
+    EXPECT_EQ(counts.live_allocations, before.live_allocations);
+    EXPECT_EQ(counts.live_bytes, before.live_bytes);
+
+    auto* q = Counting::allocate_aligned(ints, 1, alignof(int));
+
+    ASSERT_NE(q, nullptr);
+    Counting::deallocate_aligned(ints, q, 1, alignof(int));
+    EXPECT_EQ(counts.live_allocations, before.live_allocations);
+
+    // counts that would overflow once padded fail instead of wrapping around to a small allocation
+    for (auto n : {frt::NumericLimits<frt::isize>::max, frt::NumericLimits<frt::isize>::max - 8}) {
+      EXPECT_EQ(Bytes::allocate_aligned(alloc, n, 64), nullptr);
+    }
+
+    Bytes::deallocate_aligned(alloc, nullptr, frt::NumericLimits<frt::isize>::max, 64);
+    EXPECT_EQ(counts.live_allocations, before.live_allocations);
+  }
+
+  TEST(FrtCoreAllocatorTraits, AlignedResources) {
+    using Small = frt::SmallObjectAllocator<int, TestPageSource>;
+
+    auto heap = frt::SmallObjectHeap<TestPageSource>{};
+    auto small = Small{heap};
+
+    // a cache line and a whole page, straight from the heap's own size classes
+    auto* line = frt::AllocatorTraits<Small>::allocate_aligned(small, 3, 64);
+    auto* page = frt::AllocatorTraits<Small>::allocate_aligned(small, 3, 4096);
+
+    EXPECT_TRUE(is_aligned(line, 64));
+    EXPECT_TRUE(is_aligned(page, 4096));
+
+    frt::AllocatorTraits<Small>::deallocate_aligned(small, line, 3, 64);
+    frt::AllocatorTraits<Small>::deallocate_aligned(small, page, 3, 4096);
+
+    auto arena = Arena{};
+    auto ref = ArenaRef{arena};
+    auto* first = frt::AllocatorTraits<ArenaRef>::allocate(ref, 1);
+    auto* aligned = frt::AllocatorTraits<ArenaRef>::allocate_aligned(ref, 1, 256);
+
+    EXPECT_TRUE(is_aligned(aligned, 256));
+    EXPECT_NE(first, aligned);
+
+    auto region = std::vector<unsigned char>(16384);
+    auto tlsf = frt::TLSFHeap{region.data(), region.size()};
+    auto tlsf_alloc = frt::TLSFAllocator<int>{tlsf};
+    auto* block = frt::AllocatorTraits<frt::TLSFAllocator<int>>::allocate_aligned(tlsf_alloc, 16, 64);
+
+    EXPECT_TRUE(is_aligned(block, 64));
+
+    frt::AllocatorTraits<frt::TLSFAllocator<int>>::deallocate_aligned(tlsf_alloc, block, 16, 64);
+  }
+} // namespace
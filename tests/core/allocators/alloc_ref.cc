@@ -0,0 +1,127 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "frt/core/allocators/alloc_ref.h"
+#include "frt/core/allocators/stack_allocator.h"
+#include "frt/core/bump_alloc.h"
+#include "test_allocators.h"
+#include "gtest/gtest.h"
+#include <cstdint>
+
+namespace {
+  using Stack = frt::StackAllocator<std::uint64_t, 256>;
+  using Arena = frt::BumpAllocator<CountingAllocator<int>>;
+
+  static_assert(frt::Allocator<frt::AllocRef<Stack>>);
+  static_assert(frt::Allocator<frt::AllocRef<Stack, char>>);
+  static_assert(frt::Allocator<frt::AllocRef<Arena>>);
+  static_assert(frt::Allocator<frt::AllocRef<Arena, double>>);
+  static_assert(frt::SameAs<frt::AllocRef<Stack>::value_type, std::uint64_t>);
+  static_assert(frt::SameAs<frt::AllocRef<Arena>::value_type, frt::ubyte>);
+  static_assert(frt::SameAs<frt::AllocatorTraits<frt::AllocRef<Stack>>::rebind_alloc<int>, frt::AllocRef<Stack, int>>);
+  static_assert(frt::AllocatorTraits<frt::AllocRef<Stack>>::is_nothrow);
+
+  TEST(FrtCoreAllocatorsAllocRef, SharesStackAllocator) {
+    auto arena = Stack::arena_type{};
+    auto stack = Stack{arena};
+    auto a = frt::AllocRef<Stack>{stack};
+    auto b = a;
+
+    EXPECT_EQ(a, b);
+    EXPECT_EQ(a.get(), &stack);
+
+    auto* x = a.allocate(2);
+    auto* y = b.allocate(2);
+
+    EXPECT_EQ(y, x + 2);
+    EXPECT_EQ(arena.used(), 4 * sizeof(std::uint64_t));
+
+    b.deallocate(y, 2);
+    a.deallocate(x, 2);
+    EXPECT_EQ(arena.used(), 0);
+  }
+
+  TEST(FrtCoreAllocatorsAllocRef, RebindStackAllocator) {
+    auto arena = Stack::arena_type{};
+    auto stack = Stack{arena};
+    auto words = frt::AllocRef<Stack>{stack};
+    auto chars = frt::AllocatorTraits<decltype(words)>::rebind_alloc<char>{words};
+
+    EXPECT_EQ(chars.get(), &stack);
+
+    // 9 chars round up to 2 whole words
+    auto* c = chars.allocate(9);
+
+    EXPECT_EQ(arena.used(), 2 * sizeof(std::uint64_t));
+
+    auto* w = words.allocate(1);
+
+    EXPECT_EQ(reinterpret_cast<char*>(w), c + 16);
+
+    words.deallocate(w, 1);
+    chars.deallocate(c, 9);
+    EXPECT_EQ(arena.used(), 0);
+  }
+
+  TEST(FrtCoreAllocatorsAllocRef, SharesArena) {
+    auto arena = Arena{};
+    auto bytes = frt::AllocRef<Arena>{arena};
+    auto doubles = frt::AllocRef<Arena, double>{bytes};
+
+    auto* b = bytes.allocate(3);
+    auto* d = doubles.allocate(4);
+
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(d) % alignof(double), 0);
+    EXPECT_GE(reinterpret_cast<frt::ubyte*>(d), b + 3);
+    EXPECT_EQ(arena.chunk_count(), 1);
+
+    doubles.deallocate(d, 4);
+    EXPECT_EQ(doubles.allocate(4), d);
+  }
+
+  TEST(FrtCoreAllocatorsAllocRef, Equality) {
+    auto s1 = Stack{};
+    auto s2 = Stack{};
+
+    EXPECT_EQ(frt::AllocRef<Stack>{s1}, frt::AllocRef<Stack>{s1});
+    EXPECT_NE(frt::AllocRef<Stack>{s1}, frt::AllocRef<Stack>{s2});
+    EXPECT_EQ(frt::AllocRef<Stack>{}.get(), nullptr);
+  }
+
+  TEST(FrtCoreAllocatorsAllocRef, OverflowingCounts) {
+    struct Block {
+      std::uint64_t words[4]; // NOLINT(modernize-avoid-c-arrays)
+    };
+
+    // 2^61 + 1 words is 8 bytes once it wraps around
+    constexpr auto huge = (frt::isize{1} << 61) + 1;
+
+    auto arena = Arena{};
+    auto words = frt::AllocRef<Arena, std::uint64_t>{arena};
+
+    EXPECT_EQ(words.allocate(huge), nullptr);
+    EXPECT_EQ(words.allocate(-1), nullptr);
+    EXPECT_EQ(words.allocate_aligned(huge, 64), nullptr);
+    EXPECT_EQ(arena.chunk_count(), 0);
+
+    auto* w = words.allocate(1);
+
+    EXPECT_FALSE(words.try_expand_in_place(w, 1, huge));
+
+    // typed allocators are asked for a number of their own objects, which can't wrap around either
+    auto before = counts;
+    auto counting = CountingAllocator<std::uint64_t>{};
+    auto blocks = frt::AllocRef<CountingAllocator<std::uint64_t>, Block>{counting};
+
+    EXPECT_EQ(blocks.allocate(huge / 4), nullptr);
+    EXPECT_EQ(blocks.allocate(-1), nullptr);
+    EXPECT_EQ(counts.total_allocations, before.total_allocations);
+  }
+} // namespace
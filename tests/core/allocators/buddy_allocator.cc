@@ -0,0 +1,189 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "frt/core/allocators/buddy_allocator.h"
+#include "frt/core/allocators/page_source.h"
+#include "frt/core/allocators/small_object_allocator.h"
+#include "test_allocators.h"
+#include "gtest/gtest.h"
+#include <random>
+#include <vector>
+
+namespace {
+  using Buddy = frt::BuddyAllocator<256, 6>;
+
+  static_assert(frt::PageSource<Buddy>);
+  static_assert(frt::PageSource<frt::PageSourceRef<Buddy>>);
+
+  struct Region {
+    Region() : bytes(64 * 1024 + 20 * 256) {}
+
+    void* data() {
+      return bytes.data();
+    }
+
+    frt::usize size() const {
+      return bytes.size();
+    }
+
+    std::vector<unsigned char> bytes;
+  };
+
+  TEST(FrtCoreAllocatorsBuddy, Orders) {
+    EXPECT_EQ(Buddy::order_for(0), 0);
+    EXPECT_EQ(Buddy::order_for(1), 0);
+    EXPECT_EQ(Buddy::order_for(2), 1);
+    EXPECT_EQ(Buddy::order_for(3), 2);
+    EXPECT_EQ(Buddy::order_for(64), 6);
+  }
+
+  // the number of max-order blocks that can be allocated, freeing them all again afterwards
+  frt::usize count_largest(Buddy& buddy) {
+    auto blocks = std::vector<void*>{};
+
+    while (auto* p = buddy.allocate_pages(Buddy::max_pages)) {
+      blocks.push_back(p);
+    }
+
+    for (auto* p : blocks) {
+      buddy.deallocate_pages(p, Buddy::max_pages);
+    }
+
+    return blocks.size();
+  }
+
+  TEST(FrtCoreAllocatorsBuddy, SplitAndMerge) {
+    auto region = Region{};
+    auto buddy = Buddy{region.data(), region.size()};
+    auto total = buddy.page_count();
+    auto largest = count_largest(buddy);
+
+    EXPECT_GT(total, 240);
+    EXPECT_EQ(largest, total / Buddy::max_pages);
+    EXPECT_EQ(buddy.free_page_count(), total);
+
+    // take every max-order block, so small requests need to split up whatever is left over
+    while (buddy.allocate_pages(Buddy::max_pages) != nullptr) {
+    }
+
+    auto leftovers = buddy.free_page_count();
+    auto* a = static_cast<unsigned char*>(buddy.allocate_pages(1));
+    auto* b = static_cast<unsigned char*>(buddy.allocate_pages(1));
+    auto* c = buddy.allocate_pages(3);
+
+    ASSERT_NE(a, nullptr);
+    ASSERT_NE(b, nullptr);
+    ASSERT_NE(c, nullptr);
+    EXPECT_TRUE(is_aligned(a, Buddy::page_size));
+    EXPECT_EQ(buddy.free_page_count(), leftovers - 6);
+
+    buddy.deallocate_pages(a, 1);
+    buddy.deallocate_pages(c, 3);
+    buddy.deallocate_pages(b, 1);
+    EXPECT_EQ(buddy.free_page_count(), leftovers);
+    EXPECT_EQ(buddy.allocate_pages(Buddy::max_pages + 1), nullptr);
+  }
+
+  TEST(FrtCoreAllocatorsBuddy, MergesBack) {
+    auto region = Region{};
+    auto buddy = Buddy{region.data(), region.size()};
+    auto largest = count_largest(buddy);
+    auto blocks = std::vector<void*>{};
+
+    for (auto i = 0; i < 40; ++i) {
+      blocks.push_back(buddy.allocate_pages(static_cast<frt::usize>(i % 5) + 1));
+    }
+
+    EXPECT_LT(count_largest(buddy), largest);
+
+    for (auto i = std::size_t{0}; i < blocks.size(); ++i) {
+      buddy.deallocate_pages(blocks[i], i % 5 + 1);
+    }
+
+    // once everything is freed, every split has merged back together
+    EXPECT_EQ(count_largest(buddy), largest);
+  }
+
+  TEST(FrtCoreAllocatorsBuddy, Exhaustion) {
+    auto region = Region{};
+    auto buddy = Buddy{region.data(), region.size()};
+    auto blocks = std::vector<void*>{};
+
+    while (auto* p = buddy.allocate_pages(1)) {
+      ASSERT_GE(static_cast<unsigned char*>(p), region.bytes.data());
+      ASSERT_LE(static_cast<unsigned char*>(p) + Buddy::page_size, region.bytes.data() + region.size());
+      blocks.push_back(p);
+    }
+
+    EXPECT_EQ(blocks.size(), buddy.page_count());
+    EXPECT_EQ(buddy.free_page_count(), 0);
+
+    for (auto* p : blocks) {
+      buddy.deallocate_pages(p, 1);
+    }
+
+    EXPECT_EQ(buddy.free_page_count(), buddy.page_count());
+    EXPECT_NE(buddy.allocate_pages(Buddy::max_pages), nullptr);
+
+    auto tiny = Buddy{region.data(), 300};
+
+    EXPECT_EQ(tiny.page_count(), 0);
+    EXPECT_EQ(tiny.allocate_pages(1), nullptr);
+  }
+
+  TEST(FrtCoreAllocatorsBuddy, MixedSizes) {
+    auto region = Region{};
+    auto buddy = Buddy{region.data(), region.size()};
+
+    allocation_churn(
+        5000,
+        [&buddy](std::mt19937& rng) {
+          auto count = frt::usize{1} + rng() % 20;
+          auto* p = static_cast<unsigned char*>(buddy.allocate_pages(count));
+
+          return ChurnBlock{p, count * Buddy::page_size, Buddy::page_size};
+        },
+        [&buddy](ChurnBlock block) {
+          buddy.deallocate_pages(block.ptr, block.size / Buddy::page_size);
+        });
+
+    EXPECT_EQ(buddy.free_page_count(), buddy.page_count());
+  }
+
+  TEST(FrtCoreAllocatorsBuddy, BacksSmallObjectHeap) {
+    auto region = Region{};
+    auto buddy = Buddy{region.data(), region.size()};
+
+    {
+      auto heap = frt::SmallObjectHeap<frt::PageSourceRef<Buddy>>{frt::PageSourceRef<Buddy>{buddy}};
+
+      for (auto i = 0; i < 100; ++i) {
+        ASSERT_NE(heap.allocate(48, 8), nullptr);
+      }
+
+      EXPECT_LT(buddy.free_page_count(), buddy.page_count());
+    }
+
+    EXPECT_EQ(buddy.free_page_count(), buddy.page_count());
+  }
+
+  TEST(FrtCoreAllocatorsBuddy, Move) {
+    auto region = Region{};
+    auto buddy = Buddy{region.data(), region.size()};
+    auto* p = buddy.allocate_pages(2);
+    auto moved = frt::move(buddy);
+
+    EXPECT_EQ(buddy.page_count(), 0);
+    EXPECT_EQ(buddy.allocate_pages(1), nullptr);
+
+    moved.deallocate_pages(p, 2);
+    EXPECT_EQ(moved.free_page_count(), moved.page_count());
+  }
+} // namespace
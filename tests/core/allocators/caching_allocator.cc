@@ -0,0 +1,178 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "frt/core/allocators/caching_allocator.h"
+#include "test_allocators.h"
+#include "gtest/gtest.h"
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+  using Heap = frt::CachingHeap<CountingAllocator<int>>;
+  using Cache = frt::MagazineCache<CountingAllocator<int>, 8>;
+
+  static_assert(frt::Allocator<frt::CachingAllocator<CountingAllocator<int>>>);
+  static_assert(frt::Allocator<frt::CachingAllocator<CountingAllocator<int>>::rebind<double>::other>);
+
+  TEST(FrtCoreAllocatorsCaching, Reuse) {
+    auto before = counts;
+
+    {
+      auto heap = Heap{};
+      auto cache = Cache{heap};
+      auto* a = cache.allocate(1);
+
+      // refilled with half a magazine
+      EXPECT_EQ(counts.total_allocations, before.total_allocations + 4);
+
+      cache.deallocate(a, 1);
+      EXPECT_EQ(cache.allocate(1), a);
+
+      // 3 and 4 share a size class
+      auto* b = cache.allocate(3);
+
+      cache.deallocate(b, 3);
+      EXPECT_EQ(cache.allocate(4), b);
+      cache.deallocate(b, 4);
+      cache.deallocate(a, 1);
+
+      EXPECT_EQ(counts.total_allocations, before.total_allocations + 8);
+    }
+
+    EXPECT_EQ(counts.live_allocations, before.live_allocations);
+    EXPECT_EQ(counts.live_bytes, before.live_bytes);
+  }
+
+  TEST(FrtCoreAllocatorsCaching, OverflowAndLarge) {
+    auto before = counts;
+
+    {
+      auto heap = Heap{};
+      auto cache = Cache{heap};
+      auto blocks = std::vector<int*>{};
+
+      for (auto i = 0; i < 100; ++i) {
+        blocks.push_back(cache.allocate(2));
+      }
+
+      for (auto* p : blocks) {
+        cache.deallocate(p, 2);
+      }
+
+      // only a magazine's worth of blocks stays cached, the rest was given back
+      EXPECT_LE(counts.live_allocations - before.live_allocations, 8);
+
+      // big blocks aren't cached at all
+      auto total = counts.total_allocations;
+      auto* big = cache.allocate(1000);
+
+      EXPECT_EQ(counts.total_allocations, total + 1);
+
+      cache.deallocate(big, 1000);
+      EXPECT_LE(counts.live_allocations - before.live_allocations, 8);
+    }
+
+    EXPECT_EQ(counts.live_allocations, before.live_allocations);
+  }
+
+  TEST(FrtCoreAllocatorsCaching, CacheOutlivesHeap) {
+    auto before = counts;
+    auto heap = std::make_unique<Heap>();
+    auto cache = Cache{*heap};
+    auto other = Heap{};
+
+    cache.deallocate(cache.allocate(1), 1);
+    EXPECT_GT(counts.live_allocations, before.live_allocations);
+    EXPECT_TRUE(cache.is_in_front_of(*heap));
+
+    heap.reset();
+
+    // the heap took back everything that was cached, and the cache doesn't refer to it anymore
+    EXPECT_EQ(counts.live_allocations, before.live_allocations);
+    EXPECT_FALSE(cache.is_in_front_of(other));
+  }
+
+  TEST(FrtCoreAllocatorsCaching, Threads) {
+    auto heap = frt::CachingHeap<SharedAllocator<long>>{};
+    auto alloc = frt::CachingAllocator<SharedAllocator<long>>{heap};
+    auto threads = std::vector<std::thread>{};
+    auto blocks = shared_live_blocks.load();
+
+    for (auto t = 0; t < 4; ++t) {
+      threads.emplace_back([alloc, t]() mutable {
+        auto live = std::vector<long*>{};
+
+        for (auto i = 0; i < 10000; ++i) {
+          if (i % 3 == 2) {
+            auto* p = live.back();
+
+            EXPECT_EQ(*p, t);
+            live.pop_back();
+            alloc.deallocate(p, 1);
+          } else {
+            auto* p = alloc.allocate(1);
+
+            *p = t;
+            live.push_back(p);
+          }
+        }
+
+        for (auto* p : live) {
+          alloc.deallocate(p, 1);
+        }
+      });
+    }
+
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    // every thread's cache was flushed when it exited
+    EXPECT_EQ(shared_live_blocks.load(), blocks);
+  }
+
+  TEST(FrtCoreAllocatorsCaching, FreeOnAnotherThread) {
+    auto heap = frt::CachingHeap<SharedAllocator<long>>{};
+    auto alloc = frt::CachingAllocator<SharedAllocator<long>>{heap};
+    auto blocks = shared_live_blocks.load();
+    auto allocated = std::vector<long*>{};
+    auto wide = std::vector<double*>{};
+
+    auto producer = std::thread{[alloc, &allocated, &wide]() mutable {
+      auto doubles = frt::CachingAllocator<SharedAllocator<long>>::rebind<double>::other{alloc};
+
+      for (auto i = 0; i < 1000; ++i) {
+        auto* p = alloc.allocate(1 + i % 4);
+
+        *p = i;
+        allocated.push_back(p);
+        wide.push_back(doubles.allocate(2));
+      }
+    }};
+
+    producer.join();
+
+    auto consumer = std::thread{[alloc, &allocated, &wide]() mutable {
+      auto doubles = frt::CachingAllocator<SharedAllocator<long>>::rebind<double>::other{alloc};
+
+      for (auto i = 0; i < 1000; ++i) {
+        EXPECT_EQ(*allocated[static_cast<frt::usize>(i)], i);
+        alloc.deallocate(allocated[static_cast<frt::usize>(i)], 1 + i % 4);
+        doubles.deallocate(wide[static_cast<frt::usize>(i)], 2);
+      }
+    }};
+
+    consumer.join();
+
+    // nothing was lost or double-freed between the two threads' caches
+    EXPECT_EQ(shared_live_blocks.load(), blocks);
+  }
+} // namespace
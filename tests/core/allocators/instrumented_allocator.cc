@@ -0,0 +1,147 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "frt/core/allocators/instrumented_allocator.h"
+#include "test_allocators.h"
+#include "gtest/gtest.h"
+#include <thread>
+#include <vector>
+
+namespace {
+  using Instrumented = frt::InstrumentedAllocator<CountingAllocator<int>>;
+
+  static_assert(frt::Allocator<Instrumented>);
+
+  TEST(FrtCoreAllocatorsInstrumented, Buckets) {
+    EXPECT_EQ(frt::AllocationStats::size_bucket(0), 0);
+    EXPECT_EQ(frt::AllocationStats::size_bucket(1), 0);
+    EXPECT_EQ(frt::AllocationStats::size_bucket(2), 1);
+    EXPECT_EQ(frt::AllocationStats::size_bucket(16), 4);
+    EXPECT_EQ(frt::AllocationStats::size_bucket(17), 5);
+    EXPECT_EQ(frt::AllocationStats::size_bucket(frt::usize{1} << 40), frt::AllocationSnapshot::size_buckets - 1);
+    EXPECT_EQ(frt::AllocationStats::latency_bucket(0), 0);
+    EXPECT_EQ(frt::AllocationStats::latency_bucket(100), 7);
+  }
+
+  TEST(FrtCoreAllocatorsInstrumented, Counts) {
+    auto stats = frt::AllocationStats{};
+    auto ints = Instrumented{stats};
+    auto chars = frt::AllocatorTraits<Instrumented>::rebind_alloc<char>{ints};
+
+    auto* a = ints.allocate(4);  // 16 bytes
+    auto* b = ints.allocate(10); // 40 bytes
+    auto* c = chars.allocate(3);
+
+    ints.deallocate(a, 4);
+
+    auto* d = ints.allocate(1);
+
+    auto snapshot = stats.snapshot();
+
+    EXPECT_EQ(snapshot.allocations, 4);
+    EXPECT_EQ(snapshot.deallocations, 1);
+    EXPECT_EQ(snapshot.live_bytes, 40 + 3 + 4);
+    EXPECT_EQ(snapshot.peak_bytes, 16 + 40 + 3);
+    EXPECT_EQ(snapshot.total_bytes, 16 + 40 + 3 + 4);
+    EXPECT_EQ(snapshot.sizes[4], 1);
+    EXPECT_EQ(snapshot.sizes[6], 1);
+    EXPECT_EQ(snapshot.sizes[2], 2);
+
+    auto latencies = frt::usize{0};
+
+    for (auto count : snapshot.latencies) {
+      latencies += count;
+    }
+
+    EXPECT_EQ(latencies, 4);
+
+    ints.deallocate(b, 10);
+    ints.deallocate(d, 1);
+    chars.deallocate(c, 3);
+
+    EXPECT_EQ(stats.snapshot().live_bytes, 0);
+    EXPECT_EQ(stats.snapshot().peak_bytes, 16 + 40 + 3);
+  }
+
+  TEST(FrtCoreAllocatorsInstrumented, Failures) {
+    auto stats = frt::AllocationStats{};
+    auto alloc = frt::InstrumentedAllocator<NullAllocator<int>>{stats};
+
+    EXPECT_EQ(alloc.allocate(4), nullptr);
+    EXPECT_EQ(alloc.allocate_aligned(4, 64), nullptr);
+
+    auto snapshot = stats.snapshot();
+
+    EXPECT_EQ(snapshot.failed_allocations, 2);
+    EXPECT_EQ(snapshot.allocations, 0);
+    EXPECT_EQ(snapshot.live_bytes, 0);
+    EXPECT_EQ(snapshot.peak_bytes, 0);
+    EXPECT_EQ(snapshot.total_bytes, 0);
+    EXPECT_EQ(snapshot.sizes[4], 0);
+  }
+
+  TEST(FrtCoreAllocatorsInstrumented, NullDeallocate) {
+    auto stats = frt::AllocationStats{};
+    auto alloc = Instrumented{stats};
+    auto* p = alloc.allocate(4);
+    auto before = stats.snapshot();
+
+    alloc.deallocate(nullptr, 4);
+    frt::AllocatorTraits<Instrumented>::deallocate_aligned(alloc, nullptr, 4, alignof(int));
+    alloc.deallocate_aligned(nullptr, 4, 64);
+
+    auto after = stats.snapshot();
+
+    EXPECT_EQ(after.allocations, before.allocations);
+    EXPECT_EQ(after.deallocations, before.deallocations);
+    EXPECT_EQ(after.live_bytes, before.live_bytes);
+    EXPECT_EQ(after.peak_bytes, before.peak_bytes);
+    EXPECT_EQ(after.total_bytes, before.total_bytes);
+
+    alloc.deallocate(p, 4);
+    EXPECT_EQ(stats.snapshot().live_bytes, 0);
+  }
+
+  TEST(FrtCoreAllocatorsInstrumented, Equality) {
+    auto stats = frt::AllocationStats{};
+    auto other = frt::AllocationStats{};
+
+    EXPECT_EQ(Instrumented{stats}, Instrumented{stats});
+    EXPECT_NE(Instrumented{stats}, Instrumented{other});
+  }
+
+  TEST(FrtCoreAllocatorsInstrumented, Threads) {
+    auto stats = frt::AllocationStats{};
+    auto threads = std::vector<std::thread>{};
+
+    for (auto t = 0; t < 4; ++t) {
+      threads.emplace_back([&stats] {
+        auto alloc = frt::InstrumentedAllocator<SharedAllocator<long>>{stats};
+
+        for (auto i = 0; i < 1000; ++i) {
+          alloc.deallocate(alloc.allocate(2), 2);
+        }
+      });
+    }
+
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    auto snapshot = stats.snapshot();
+
+    EXPECT_EQ(snapshot.allocations, 4000);
+    EXPECT_EQ(snapshot.deallocations, 4000);
+    EXPECT_EQ(snapshot.live_bytes, 0);
+    EXPECT_EQ(snapshot.sizes[4], 4000);
+    EXPECT_GE(snapshot.peak_bytes, 16);
+    EXPECT_LE(snapshot.peak_bytes, 64);
+  }
+} // namespace
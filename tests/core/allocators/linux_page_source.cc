@@ -0,0 +1,157 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "frt/core/allocators/linux_page_source.h"
+
+#if defined(FRT_OS_LINUX)
+
+#include "frt/core/allocators/buddy_allocator.h"
+#include "frt/core/allocators/page_source.h"
+#include "frt/core/allocators/small_object_allocator.h"
+#include "test_allocators.h"
+#include "gtest/gtest.h"
+
+namespace {
+  constexpr frt::usize huge_page_size = frt::usize{2} << 20;
+
+  using SmallPages = frt::LinuxPageSource<>;
+  using HugePages = frt::LinuxPageSource<huge_page_size>;
+  using BigPages = frt::LinuxPageSource<2 * huge_page_size>;
+
+  static_assert(frt::PageSource<SmallPages>);
+  static_assert(frt::PageSource<HugePages>);
+
+  TEST(FrtCoreAllocatorsLinuxPageSource, MapsPages) {
+    auto source = SmallPages{};
+    auto* pages = static_cast<frt::ubyte*>(source.allocate_pages(3));
+
+    ASSERT_NE(pages, nullptr);
+    EXPECT_TRUE(is_aligned(pages, SmallPages::page_size));
+
+    // anonymous mappings start out zeroed
+    for (auto i = frt::usize{0}; i < 3 * SmallPages::page_size; ++i) {
+      ASSERT_EQ(pages[i], 0);
+      pages[i] = 0xAB;
+    }
+
+    source.deallocate_pages(pages, 3);
+    source.deallocate_pages(nullptr, 3);
+
+    EXPECT_EQ(source.allocate_pages(0), nullptr);
+  }
+
+  TEST(FrtCoreAllocatorsLinuxPageSource, ReleaseZeroesPages) {
+    auto source = SmallPages{};
+    auto* pages = static_cast<frt::ubyte*>(source.allocate_pages(2));
+
+    ASSERT_NE(pages, nullptr);
+
+    pages[0] = 1;
+    pages[SmallPages::page_size] = 2;
+
+    source.release_pages(pages, 2);
+
+    // the mapping is still there and still writable, just empty
+    EXPECT_EQ(pages[0], 0);
+    EXPECT_EQ(pages[SmallPages::page_size], 0);
+
+    pages[0] = 3;
+
+    EXPECT_EQ(pages[0], 3);
+
+    source.deallocate_pages(pages, 2);
+  }
+
+  TEST(FrtCoreAllocatorsLinuxPageSource, HugePages) {
+    for (auto mode : {frt::LinuxHugePages::transparent, frt::LinuxHugePages::explicit_2m}) {
+      auto source = HugePages{frt::LinuxPageOptions{.huge_pages = mode, .populate = true}};
+      auto* pages = static_cast<frt::ubyte*>(source.allocate_pages(2));
+
+      // explicit pages fall back to transparent ones if the hugetlb pool is empty, so this always works
+      ASSERT_NE(pages, nullptr);
+      EXPECT_TRUE(is_aligned(pages, huge_page_size));
+
+      pages[0] = 1;
+      pages[2 * huge_page_size - 1] = 2;
+
+      EXPECT_EQ(pages[0] + pages[2 * huge_page_size - 1], 3);
+
+      source.deallocate_pages(pages, 2);
+    }
+
+    auto strict_options = frt::LinuxPageOptions{.huge_pages = frt::LinuxHugePages::explicit_2m, .huge_fallback = false};
+    auto strict = HugePages{strict_options};
+    auto* pages = strict.allocate_pages(1);
+
+    // whether this works depends on the machine's hugetlb pool, but it can't be misaligned either way
+    EXPECT_TRUE(is_aligned(pages, huge_page_size));
+
+    strict.deallocate_pages(pages, 1);
+  }
+
+  TEST(FrtCoreAllocatorsLinuxPageSource, PagesBiggerThanHugePages) {
+    for (auto fallback : {true, false}) {
+      auto options = frt::LinuxPageOptions{.huge_pages = frt::LinuxHugePages::explicit_2m, .huge_fallback = fallback};
+      auto source = BigPages{options};
+      auto* pages = static_cast<frt::ubyte*>(source.allocate_pages(2));
+
+      // hugetlb only aligns to 2MiB on its own, the source has to trim the mapping to get to 4MiB
+      EXPECT_TRUE(is_aligned(pages, BigPages::page_size));
+
+      if (fallback) {
+        ASSERT_NE(pages, nullptr);
+      }
+
+      if (pages != nullptr) {
+        pages[0] = 1;
+        pages[2 * BigPages::page_size - 1] = 2;
+
+        EXPECT_EQ(pages[0] + pages[2 * BigPages::page_size - 1], 3);
+      }
+
+      source.deallocate_pages(pages, 2);
+    }
+  }
+
+  TEST(FrtCoreAllocatorsLinuxPageSource, BacksAllocators) {
+    auto lazy = frt::LinuxPageOptions{.release = frt::LinuxPageRelease::free};
+    auto heap = frt::SmallObjectHeap<SmallPages>{SmallPages{lazy}};
+    auto* object = static_cast<int*>(heap.allocate(sizeof(int)));
+
+    ASSERT_NE(object, nullptr);
+
+    *object = 42;
+
+    EXPECT_EQ(*object, 42);
+
+    heap.deallocate(object, sizeof(int));
+
+    auto huge = HugePages{frt::LinuxPageOptions{.huge_pages = frt::LinuxHugePages::transparent}};
+    auto* region = huge.allocate_pages(1);
+
+    ASSERT_NE(region, nullptr);
+
+    // one huge page carved up by a buddy allocator into 4KiB pages
+    {
+      auto buddy = frt::BuddyAllocator<>{region, huge_page_size};
+      auto* page = buddy.allocate_pages(4);
+
+      ASSERT_NE(page, nullptr);
+      EXPECT_TRUE(is_aligned(page, 4096));
+
+      buddy.deallocate_pages(page, 4);
+      EXPECT_EQ(buddy.free_page_count(), buddy.page_count());
+    }
+
+    huge.deallocate_pages(region, 1);
+  }
+} // namespace
+
+#endif
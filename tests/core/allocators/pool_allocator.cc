@@ -0,0 +1,230 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "frt/core/allocators/pool_allocator.h"
+#include "frt/core/allocators/stack_allocator.h"
+#include "test_allocators.h"
+#include "gtest/gtest.h"
+#include <cstdint>
+#include <set>
+#include <vector>
+
+namespace {
+  struct Connection {
+    std::uint64_t id;
+    char buffer[40]; // NOLINT(modernize-avoid-c-arrays)
+  };
+
+  struct Pair {
+    Connection first;
+    Connection second;
+  };
+
+  using Pool = frt::PoolAllocator<Connection, 8, CountingAllocator<Connection>>;
+  using Growable = frt::GrowablePoolAllocator<Connection, CountingAllocator<Connection>>;
+
+  static_assert(frt::Allocator<frt::PoolAllocator<int, 16>>);
+  static_assert(frt::Allocator<Pool>);
+  static_assert(frt::Allocator<Growable>);
+  static_assert(frt::SameAs<frt::AllocatorTraits<Growable>::rebind_alloc<char>,
+      frt::GrowablePoolAllocator<char, CountingAllocator<Connection>, Connection>>);
+
+  // slots are exactly as big as the objects, there's no header
+  static_assert(sizeof(frt::internal::PoolSlot<Connection>) == sizeof(Connection));
+  static_assert(sizeof(Pool::arena_type) <= 8 * sizeof(Connection) + 2 * sizeof(void*));
+  static_assert(sizeof(frt::PoolAllocator<Connection, 8>) == sizeof(void*));
+
+  TEST(FrtCoreAllocatorsPoolAllocator, SlotsAreReused) {
+    auto arena = Pool::arena_type{};
+    auto pool = Pool{arena};
+    auto seen = std::set<Connection*>{};
+    Connection* slots[8]; // NOLINT(modernize-avoid-c-arrays)
+
+    for (auto*& slot : slots) {
+      slot = pool.allocate(1);
+      slot->id = 42;
+
+      EXPECT_TRUE(pool.owns(slot));
+      EXPECT_TRUE(seen.insert(slot).second);
+    }
+
+    // never-used slots are handed out in address order
+    EXPECT_EQ(slots[1], slots[0] + 1);
+
+    pool.deallocate(slots[3], 1);
+    pool.deallocate(slots[5], 1);
+
+    // LIFO reuse of freed slots
+    EXPECT_EQ(pool.allocate(1), slots[5]);
+    EXPECT_EQ(pool.allocate(1), slots[3]);
+  }
+
+  TEST(FrtCoreAllocatorsPoolAllocator, Fallback) {
+    auto before = counts;
+    auto arena = Pool::arena_type{};
+    auto pool = Pool{arena};
+    auto* array = pool.allocate(4); // not a single object
+
+    EXPECT_FALSE(pool.owns(array));
+    EXPECT_EQ(counts.live_allocations, before.live_allocations + 1);
+
+    auto slots = std::vector<Connection*>{};
+
+    for (auto i = 0; i < 9; ++i) {
+      slots.push_back(pool.allocate(1));
+    }
+
+    // the 9th single object overflowed
+    EXPECT_FALSE(pool.owns(slots.back()));
+    EXPECT_EQ(counts.live_allocations, before.live_allocations + 2);
+
+    for (auto* slot : slots) {
+      pool.deallocate(slot, 1);
+    }
+
+    pool.deallocate(array, 4);
+    EXPECT_EQ(counts.live_allocations, before.live_allocations);
+  }
+
+  TEST(FrtCoreAllocatorsPoolAllocator, CopiesAreInterchangeable) {
+    auto before = counts;
+    auto arena = Pool::arena_type{};
+    auto original = Pool{arena};
+    auto* slot = original.allocate(1);
+    auto copy = original;
+    auto moved = frt::move(original);
+
+    EXPECT_EQ(copy, moved);
+    EXPECT_TRUE(moved.owns(slot));
+
+    // the slot goes back to the shared pool, not to the fallback
+    moved.deallocate(slot, 1);
+    EXPECT_EQ(counts.live_allocations, before.live_allocations);
+    EXPECT_EQ(copy.allocate(1), slot);
+
+    // rebinds share the pool, and types that don't fit in a slot go to the fallback
+    auto bytes = frt::AllocatorTraits<Pool>::rebind_alloc<char>{copy};
+    auto* byte = bytes.allocate(1);
+
+    EXPECT_EQ(bytes.arena(), &arena);
+    EXPECT_TRUE(bytes.owns(byte));
+    EXPECT_EQ(Pool{bytes}, copy);
+
+    using Big = frt::AllocatorTraits<Pool>::rebind_alloc<Pair>;
+    auto big = Big{copy};
+    auto* pair = big.allocate(1);
+
+    EXPECT_FALSE(big.owns(pair));
+    EXPECT_EQ(counts.live_allocations, before.live_allocations + 1);
+
+    big.deallocate(pair, 1);
+    bytes.deallocate(byte, 1);
+    copy.deallocate(slot, 1);
+    EXPECT_EQ(counts.live_allocations, before.live_allocations);
+  }
+
+  TEST(FrtCoreAllocatorsGrowablePoolAllocator, Grows) {
+    auto before = counts;
+
+    {
+      auto arena = Growable::arena_type{4};
+      auto pool = Growable{arena};
+      auto slots = std::set<Connection*>{};
+
+      for (auto i = 0; i < 100; ++i) {
+        auto* slot = pool.allocate(1);
+
+        slot->id = static_cast<std::uint64_t>(i);
+        EXPECT_TRUE(slots.insert(slot).second);
+      }
+
+      // 4 + 8 + 16 + 32 + 64
+      EXPECT_EQ(arena.capacity(), 124);
+      EXPECT_EQ(counts.live_allocations, before.live_allocations + 5);
+
+      for (auto* slot : slots) {
+        pool.deallocate(slot, 1);
+      }
+
+      // everything comes from the free list now, no new chunks
+      for (auto i = 0; i < 100; ++i) {
+        EXPECT_EQ(slots.count(pool.allocate(1)), 1);
+      }
+
+      EXPECT_EQ(arena.capacity(), 124);
+    }
+
+    EXPECT_EQ(counts.live_allocations, before.live_allocations);
+    EXPECT_EQ(counts.live_bytes, before.live_bytes);
+  }
+
+  TEST(FrtCoreAllocatorsGrowablePoolAllocator, ArraysAndCopies) {
+    auto before = counts;
+
+    {
+      auto arena = Growable::arena_type{};
+      auto pool = Growable{arena};
+      auto* array = pool.allocate(3);
+      auto* single = pool.allocate(1);
+
+      single->id = 7;
+
+      auto moved = Growable{frt::move(pool)};
+      auto copy = moved;
+
+      EXPECT_EQ(copy, moved);
+      EXPECT_EQ(arena.capacity(), Growable::arena_type::default_chunk_blocks);
+      EXPECT_EQ(single->id, 7);
+
+      // every copy shares one free list, so a slot freed through one is reused through another
+      copy.deallocate(single, 1);
+      EXPECT_EQ(moved.allocate(1), single);
+
+      moved.deallocate(single, 1);
+      copy.deallocate(array, 3);
+      EXPECT_EQ(arena.capacity(), Growable::arena_type::default_chunk_blocks);
+    }
+
+    EXPECT_EQ(counts.live_allocations, before.live_allocations);
+  }
+
+  TEST(FrtCoreAllocatorsGrowablePoolAllocator, StatefulBackingAllocator) {
+    using Stack = frt::StackAllocator<long, 4096, CountingAllocator<long>>;
+
+    auto before = counts;
+    auto arena = Stack::arena_type{};
+
+    {
+      auto pool_arena = frt::GrowablePoolArena<long, Stack>{8, Stack{arena}};
+      auto pool = frt::GrowablePoolAllocator<long, Stack>{pool_arena};
+      auto* single = pool.allocate(1);
+      auto* array = pool.allocate(4);
+
+      // both the chunk and the array live in the arena, not in some temporary copy of the allocator
+      EXPECT_TRUE(pool.backing().owns(single));
+      EXPECT_TRUE(pool.backing().owns(array));
+      EXPECT_GT(arena.used(), 0);
+
+      *single = 42;
+
+      for (auto i = 0; i < 4; ++i) {
+        array[i] = i;
+      }
+
+      EXPECT_EQ(*single, 42);
+
+      pool.deallocate(array, 4);
+      pool.deallocate(single, 1);
+    }
+
+    EXPECT_EQ(arena.used(), 0);
+    EXPECT_EQ(counts.live_allocations, before.live_allocations);
+  }
+} // namespace
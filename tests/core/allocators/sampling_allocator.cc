@@ -0,0 +1,207 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "frt/core/allocators/sampling_allocator.h"
+#include "test_allocators.h"
+#include "gtest/gtest.h"
+#include <memory>
+#include <vector>
+
+namespace {
+  // this file is built with frame pointers, but gtest might not be. capturing the allocating function's
+  // frame and its caller stays inside of code from this file
+  constexpr frt::usize test_depth = 2;
+
+  using Profile = frt::HeapProfile<4096>;
+  using Sampled = frt::SampledAllocator<CountingAllocator<int>, Profile>;
+  using Traits = frt::AllocatorTraits<Sampled>;
+
+  static_assert(frt::Allocator<Sampled>);
+  static_assert(frt::SameAs<Traits::rebind_alloc<char>, frt::SampledAllocator<CountingAllocator<char>, Profile>>);
+
+  static_assert(frt::internal::sampler_log2(1) == 0);
+  static_assert(frt::internal::sampler_log2(2) == 256);
+  static_assert(frt::internal::sampler_log2(frt::u64{1} << 26) == 26 << 8);
+
+  double relative_error(frt::usize estimate, frt::usize actual) {
+    return (static_cast<double>(estimate) - static_cast<double>(actual)) / static_cast<double>(actual);
+  }
+
+  TEST(FrtCoreAllocatorsSampling, IntervalsAverageThePeriod) {
+    constexpr auto period = frt::usize{1} << 16;
+    constexpr auto draws = 100000;
+
+    auto state = frt::u64{0x123456789};
+    auto total = frt::usize{0};
+
+    for (auto i = 0; i < draws; ++i) {
+      auto interval = frt::internal::sampler_interval(state, period);
+
+      ASSERT_GT(interval, 0);
+      total += interval;
+    }
+
+    EXPECT_NEAR(relative_error(total / draws, period), 0.0, 0.02);
+  }
+
+  TEST(FrtCoreAllocatorsSampling, EstimatesLiveBytes) {
+    auto profile = std::make_unique<Profile>(4096, test_depth);
+    auto alloc = Sampled{*profile};
+    auto blocks = std::vector<int*>{};
+
+    // 640KiB in 64-byte blocks, about 160 samples
+    for (auto i = 0; i < 10000; ++i) {
+      blocks.push_back(Traits::allocate(alloc, 16));
+    }
+
+    auto live = profile->summary();
+
+    EXPECT_EQ(live.dropped_samples, 0);
+    EXPECT_EQ(live.live_samples, live.total_samples);
+    EXPECT_GT(live.live_samples, 50);
+    EXPECT_LT(live.live_samples, 1000);
+    EXPECT_NEAR(relative_error(live.estimated_live_bytes, 10000 * 64), 0.0, 0.3);
+
+    // free half of them, the estimate should roughly halve
+    for (auto i = 0; i < 10000; i += 2) {
+      Traits::deallocate(alloc, blocks[static_cast<frt::usize>(i)], 16);
+    }
+
+    auto half = profile->summary();
+
+    EXPECT_LT(half.live_samples, live.live_samples);
+    EXPECT_NEAR(relative_error(half.estimated_live_bytes, 5000 * 64), 0.0, 0.4);
+
+    for (auto i = 1; i < 10000; i += 2) {
+      Traits::deallocate(alloc, blocks[static_cast<frt::usize>(i)], 16);
+    }
+
+    auto none = profile->summary();
+
+    EXPECT_EQ(none.live_samples, 0);
+    EXPECT_EQ(none.estimated_live_bytes, 0);
+    EXPECT_EQ(none.total_samples, live.total_samples);
+  }
+
+  TEST(FrtCoreAllocatorsSampling, LargeAllocationsCarryMoreWeight) {
+    auto profile = std::make_unique<Profile>(4096, test_depth);
+    auto alloc = Sampled{*profile};
+
+    // a block 256x the period always has sample points in it, and the count is close to 256
+    auto* big = Traits::allocate(alloc, 1 << 18);
+    auto summary = profile->summary();
+
+    EXPECT_EQ(summary.live_samples, 1);
+    EXPECT_NEAR(relative_error(summary.estimated_live_bytes, frt::usize{1} << 20), 0.0, 0.3);
+
+    Traits::deallocate(alloc, big, 1 << 18);
+    EXPECT_EQ(profile->summary().live_samples, 0);
+  }
+
+  // `SampledAllocator::allocate` is always inlined, so these call it directly to know what the innermost frame is
+  FRT_NEVER_INLINE int* allocate_from_here(Sampled& alloc) {
+    return alloc.allocate(1 << 12);
+  }
+
+  TEST(FrtCoreAllocatorsSampling, DumpsSamples) {
+    auto profile = std::make_unique<Profile>(1, test_depth);
+    auto alloc = Sampled{*profile};
+    auto* ptr = allocate_from_here(alloc);
+    auto* other = alloc.allocate(1);
+    auto samples = std::vector<frt::HeapSample>(8);
+    auto count = profile->dump(samples.data(), samples.size());
+
+    // with a period of one byte, everything is sampled
+    ASSERT_EQ(count, 2);
+
+    for (auto i = frt::usize{0}; i < count; ++i) {
+      auto& sample = samples[i];
+
+      EXPECT_TRUE(sample.address == ptr || sample.address == other);
+      EXPECT_EQ(sample.size, sample.address == ptr ? (1 << 12) * sizeof(int) : sizeof(int));
+      EXPECT_GT(sample.estimated_bytes, 0);
+
+#if defined(FRT_ARCH_X86_64) || defined(FRT_ARCH_ARM64)
+      EXPECT_GE(sample.depth, 1);
+      EXPECT_LE(sample.depth, test_depth);
+
+      for (auto j = frt::usize{0}; j < sample.depth; ++j) {
+        EXPECT_NE(sample.frames[j], nullptr);
+      }
+#endif
+    }
+
+#if defined(FRT_ARCH_X86_64) || defined(FRT_ARCH_ARM64)
+    // the profiler's own frames are skipped, so the innermost frame is already where the allocations came from
+    EXPECT_NE(samples[0].frames[0], samples[1].frames[0]);
+#endif
+
+    Traits::deallocate(alloc, ptr, 1 << 12);
+    Traits::deallocate(alloc, other, 1);
+  }
+
+  TEST(FrtCoreAllocatorsSampling, CopiesShareTheProfile) {
+    auto profile = std::make_unique<Profile>(1, test_depth);
+    auto alloc = Sampled{*profile};
+    auto copy = alloc;
+    auto rebound = Traits::rebind_alloc<char>{alloc};
+
+    EXPECT_EQ(copy, alloc);
+    EXPECT_EQ(rebound.profile(), profile.get());
+
+    auto* p = Traits::allocate(copy, 4);
+    auto* q = frt::AllocatorTraits<decltype(rebound)>::allocate(rebound, 4);
+
+    EXPECT_EQ(profile->summary().live_samples, 2);
+
+    // memory can be freed through any of them
+    Traits::deallocate(alloc, p, 4);
+    frt::AllocatorTraits<decltype(rebound)>::deallocate(rebound, q, 4);
+
+    EXPECT_EQ(profile->summary().live_samples, 0);
+  }
+
+  TEST(FrtCoreAllocatorsSampling, AssignmentStartsSampling) {
+    auto profile = std::make_unique<Profile>(1, test_depth);
+    auto live = Sampled{*profile};
+    auto alloc = Sampled{};
+
+    // containers default-construct their allocator and then assign it
+    alloc = live;
+
+    auto* p = Traits::allocate(alloc, 4);
+
+    EXPECT_EQ(profile->summary().live_samples, 1);
+
+    Traits::deallocate(alloc, p, 4);
+    EXPECT_EQ(profile->summary().live_samples, 0);
+  }
+
+  TEST(FrtCoreAllocatorsSampling, DefaultConstructedDeallocate) {
+    auto alloc = Sampled{};
+
+    Traits::deallocate(alloc, nullptr, 0);
+  }
+
+  TEST(FrtCoreAllocatorsSampling, NullDeallocateKeepsSamples) {
+    auto profile = std::make_unique<Profile>(64, test_depth);
+    auto alloc = Sampled{*profile};
+    auto* block = Traits::allocate(alloc, 1024);
+
+    ASSERT_EQ(profile->summary().live_samples, 1);
+
+    Traits::deallocate(alloc, nullptr, 0);
+    Traits::deallocate(alloc, nullptr, 0);
+    EXPECT_EQ(profile->summary().live_samples, 1);
+
+    Traits::deallocate(alloc, block, 1024);
+    EXPECT_EQ(profile->summary().live_samples, 0);
+  }
+} // namespace
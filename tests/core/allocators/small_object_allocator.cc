@@ -0,0 +1,142 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "frt/core/allocators/small_object_allocator.h"
+#include "test_allocators.h"
+#include "gtest/gtest.h"
+#include <random>
+#include <vector>
+
+namespace {
+  using Heap = frt::SmallObjectHeap<TestPageSource>;
+
+  static_assert(frt::PageSource<TestPageSource>);
+  static_assert(frt::Allocator<frt::SmallObjectAllocator<int, TestPageSource>>);
+
+  // a page source that's out of memory
+  struct EmptyPageSource {
+    inline static constexpr frt::usize page_size = 4096;
+
+    [[nodiscard]] void* allocate_pages(frt::usize /*unused*/) noexcept {
+      return nullptr;
+    }
+
+    void deallocate_pages(void* /*unused*/, frt::usize /*unused*/) noexcept {}
+  };
+
+  static_assert(frt::PageSource<EmptyPageSource>);
+
+  TEST(FrtCoreAllocatorsSmallObject, SizeClasses) {
+    auto previous = frt::usize{0};
+
+    for (auto i = frt::usize{0}; i < frt::internal::small_class_count; ++i) {
+      auto size = frt::internal::small_class_size(i);
+
+      EXPECT_GT(size, previous);
+      EXPECT_EQ(frt::internal::small_class_index(size), i);
+      EXPECT_EQ(frt::internal::small_class_index(previous + 1), i);
+
+      previous = size;
+    }
+
+    EXPECT_EQ(previous, Heap::max_small_size);
+    EXPECT_EQ(Heap::usable_size(1, 1), 8);
+    EXPECT_EQ(Heap::usable_size(100, 8), 112);
+    EXPECT_EQ(Heap::usable_size(129, 8), 160);
+    EXPECT_EQ(Heap::usable_size(40, 32), 64);
+    EXPECT_EQ(Heap::usable_size(5000, 8), 8192);
+  }
+
+  TEST(FrtCoreAllocatorsSmallObject, Reuse) {
+    auto heap = Heap{};
+    auto before = TestPageSource::live_pages;
+    auto* a = heap.allocate(24, 8);
+    auto* b = heap.allocate(24, 8);
+
+    EXPECT_NE(a, b);
+
+    heap.deallocate(a, 24, 8);
+    EXPECT_EQ(heap.allocate(20, 8), a); // same class
+
+    // only one slab was needed
+    EXPECT_EQ(TestPageSource::live_pages, before + 1);
+  }
+
+  TEST(FrtCoreAllocatorsSmallObject, MixedSizes) {
+    auto heap = Heap{};
+
+    allocation_churn(
+        20000,
+        [&heap](std::mt19937& rng) {
+          auto size = churn_size(rng);
+          auto align = frt::usize{1} << (rng() % 7);
+          auto* p = static_cast<unsigned char*>(heap.allocate(size, align));
+
+          EXPECT_NE(p, nullptr);
+
+          return ChurnBlock{p, size, align};
+        },
+        [&heap](ChurnBlock block) {
+          heap.deallocate(block.ptr, block.size, block.align);
+        });
+  }
+
+  TEST(FrtCoreAllocatorsSmallObject, Allocator) {
+    auto heap = Heap{};
+    auto ints = frt::SmallObjectAllocator<int, TestPageSource>{heap};
+    auto chars = frt::AllocatorTraits<decltype(ints)>::rebind_alloc<char>{ints};
+
+    auto* i = ints.allocate(10);
+    auto* c = chars.allocate(3);
+
+    EXPECT_TRUE(is_aligned(i, alignof(int)));
+
+    ints.deallocate(i, 10);
+    chars.deallocate(c, 3);
+
+    EXPECT_EQ(ints.allocate(9), i);
+  }
+
+  TEST(FrtCoreAllocatorsSmallObject, AllocateAtLeastFailure) {
+    auto heap = frt::SmallObjectHeap<EmptyPageSource>{};
+
+    for (auto size : {frt::usize{8}, frt::usize{1000}, frt::usize{20000}}) {
+      auto [ptr, count] = heap.allocate_at_least(size);
+
+      EXPECT_EQ(ptr, nullptr);
+      EXPECT_EQ(count, 0);
+    }
+  }
+
+  TEST(FrtCoreAllocatorsSmallObject, ReturnsPages) {
+    auto before = TestPageSource::live_pages;
+
+    {
+      auto heap = Heap{};
+
+      for (auto size : {8, 100, 1000, 4000}) {
+        for (auto i = 0; i < 100; ++i) {
+          ASSERT_NE(heap.allocate(static_cast<frt::usize>(size), 8), nullptr);
+        }
+      }
+
+      auto slab_pages = TestPageSource::live_pages;
+      auto* big = heap.allocate(20000, 4096);
+
+      EXPECT_TRUE(is_aligned(big, 4096));
+      EXPECT_EQ(TestPageSource::live_pages, slab_pages + 5);
+
+      heap.deallocate(big, 20000, 4096);
+      EXPECT_EQ(TestPageSource::live_pages, slab_pages);
+    }
+
+    EXPECT_EQ(TestPageSource::live_pages, before);
+  }
+} // namespace
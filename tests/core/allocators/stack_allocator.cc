@@ -0,0 +1,126 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "frt/core/allocators/alloc_ref.h"
+#include "frt/core/allocators/stack_allocator.h"
+#include "test_allocators.h"
+#include "gtest/gtest.h"
+
+namespace {
+  using Arena = frt::StackArena<64>;
+  using Stack = frt::StackAllocator<int, 64>;
+
+  static_assert(frt::Allocator<Stack>);
+  static_assert(frt::Allocator<frt::StackAllocator<double, 512, CountingAllocator<double>>>);
+  static_assert(frt::Allocator<frt::FailingAllocator<int>>);
+  static_assert(frt::SameAs<frt::AllocatorTraits<Stack>::rebind_alloc<char>,
+      frt::StackAllocator<char, 64, frt::FailingAllocator<char>>>);
+  static_assert(frt::Allocator<frt::AllocRef<Arena, int>>);
+
+  TEST(FrtCoreAllocatorsStackAllocator, LIFOReclamation) {
+    auto arena = Arena{};
+    auto alloc = Stack{arena};
+    auto* a = alloc.allocate(4);
+    auto* b = alloc.allocate(4);
+
+    EXPECT_EQ(b, a + 4);
+    EXPECT_EQ(arena.used(), 8 * sizeof(int));
+    EXPECT_TRUE(alloc.owns(a));
+
+    // out of order, `a` can't be reclaimed until `b` is gone
+    alloc.deallocate(a, 4);
+    EXPECT_EQ(arena.used(), 8 * sizeof(int));
+
+    alloc.deallocate(b, 4);
+    EXPECT_EQ(arena.used(), 4 * sizeof(int));
+    EXPECT_EQ(alloc.allocate(4), a + 4);
+
+    // exactly filling the buffer
+    EXPECT_EQ(alloc.allocate(8), a + 8);
+    EXPECT_EQ(arena.used(), 64);
+  }
+
+  TEST(FrtCoreAllocatorsStackAllocator, ExpandInPlace) {
+    auto arena = Arena{};
+    auto alloc = Stack{arena};
+    auto* a = alloc.allocate(4);
+    auto* b = alloc.allocate(4);
+
+    EXPECT_FALSE(alloc.try_expand_in_place(a, 4, 5)); // not the top block
+    EXPECT_TRUE(alloc.try_expand_in_place(b, 4, 12));
+    EXPECT_EQ(arena.used(), 64);
+    EXPECT_FALSE(alloc.try_expand_in_place(b, 12, 13)); // doesn't fit
+    EXPECT_TRUE(alloc.try_expand_in_place(b, 12, 4));   // shrinking works too
+    EXPECT_EQ(alloc.allocate(1), b + 4);
+  }
+
+  TEST(FrtCoreAllocatorsStackAllocator, Fallback) {
+    auto before = counts;
+    auto arena = frt::StackArena<16>{};
+    auto alloc = frt::StackAllocator<int, 16, CountingAllocator<int>>{arena};
+    auto* a = alloc.allocate(3);
+    auto* b = alloc.allocate(3); // doesn't fit in what's left
+
+    EXPECT_TRUE(alloc.owns(a));
+    EXPECT_FALSE(alloc.owns(b));
+    EXPECT_EQ(counts.live_allocations, before.live_allocations + 1);
+    EXPECT_FALSE(alloc.try_expand_in_place(b, 3, 4));
+
+    alloc.deallocate(b, 3);
+    alloc.deallocate(a, 3);
+
+    EXPECT_EQ(counts.live_allocations, before.live_allocations);
+    EXPECT_EQ(arena.used(), 0);
+  }
+
+  TEST(FrtCoreAllocatorsStackAllocator, CopiesAreInterchangeable) {
+    auto arena = Arena{};
+    auto other = Arena{};
+    auto alloc = Stack{arena};
+    auto* a = alloc.allocate(4);
+    auto copy = alloc;
+
+    EXPECT_EQ(copy, alloc);
+    EXPECT_NE(copy, Stack{other});
+    EXPECT_TRUE(copy.owns(a));
+
+    // the copy allocates after `a` and can free it
+    auto* b = copy.allocate(4);
+
+    EXPECT_EQ(b, a + 4);
+
+    copy.deallocate(b, 4);
+    copy.deallocate(a, 4);
+    EXPECT_EQ(arena.used(), 0);
+
+    auto rebound = frt::AllocatorTraits<Stack>::rebind_alloc<char>{alloc};
+    auto* c = rebound.allocate(3);
+
+    EXPECT_EQ(rebound.arena(), &arena);
+    EXPECT_EQ(frt::AllocatorTraits<decltype(rebound)>::rebind_alloc<int>{rebound}, alloc);
+    EXPECT_TRUE(alloc.owns(reinterpret_cast<int*>(c)));
+
+    rebound.deallocate(c, 3);
+    EXPECT_EQ(arena.used(), 0);
+  }
+
+  TEST(FrtCoreAllocatorsStackAllocator, ArenaAlignment) {
+    auto arena = frt::StackArena<256>{};
+    auto* a = arena.allocate(1);
+    auto* b = arena.allocate(1, 64);
+
+    EXPECT_EQ(reinterpret_cast<frt::usize>(a) % Arena::alignment, 0);
+    EXPECT_EQ(reinterpret_cast<frt::usize>(b) % 64, 0);
+    EXPECT_EQ(arena.allocate(257), nullptr);
+
+    arena.reset();
+    EXPECT_EQ(arena.used(), 0);
+  }
+} // namespace
@@ -0,0 +1,245 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "frt/core/allocators/tlsf_allocator.h"
+#include "test_allocators.h"
+#include "gtest/gtest.h"
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#if defined(FRT_OS_LINUX)
+#include <sys/mman.h>
+#endif
+
+namespace {
+  static_assert(frt::Allocator<frt::TLSFAllocator<int>>);
+
+  bool in_region(const void* ptr, frt::usize size, const std::vector<unsigned char>& region) {
+    auto* p = static_cast<const unsigned char*>(ptr);
+
+    return p >= region.data() && p + size <= region.data() + region.size();
+  }
+
+  TEST(FrtCoreAllocatorsTLSF, Basic) {
+    auto region = std::vector<unsigned char>(4096);
+    frt::TLSFHeap heap{region.data(), region.size()};
+
+    auto* a = heap.allocate(100);
+    auto* b = heap.allocate(1);
+    auto* c = heap.allocate(0);
+
+    ASSERT_NE(a, nullptr);
+    ASSERT_NE(b, nullptr);
+    ASSERT_NE(c, nullptr);
+    EXPECT_TRUE(in_region(a, 100, region));
+    EXPECT_TRUE(in_region(b, 1, region));
+    EXPECT_GE(frt::TLSFHeap::usable_size(a), 100);
+    EXPECT_NE(a, b);
+    EXPECT_NE(b, c);
+
+    heap.deallocate(b, 1);
+    EXPECT_EQ(heap.allocate(1), b);
+
+    heap.deallocate(nullptr, 0);
+  }
+
+  TEST(FrtCoreAllocatorsTLSF, Exhaustion) {
+    auto region = std::vector<unsigned char>(1024);
+    frt::TLSFHeap heap{region.data(), region.size()};
+
+    EXPECT_EQ(heap.allocate(2048), nullptr);
+    EXPECT_EQ(heap.allocate(static_cast<frt::usize>(-1)), nullptr);
+
+    auto blocks = std::vector<void*>{};
+
+    while (auto* p = heap.allocate(64)) {
+      ASSERT_TRUE(in_region(p, 64, region));
+      blocks.push_back(p);
+    }
+
+    EXPECT_GE(blocks.size(), 10);
+
+    // a tiny region just can't allocate anything
+    frt::TLSFHeap empty{region.data(), 8};
+
+    EXPECT_EQ(empty.allocate(1), nullptr);
+  }
+
+  TEST(FrtCoreAllocatorsTLSF, Coalescing) {
+    auto region = std::vector<unsigned char>(64 * 1024);
+    frt::TLSFHeap heap{region.data(), region.size()};
+    auto blocks = std::vector<void*>{};
+
+    while (auto* p = heap.allocate(200)) {
+      blocks.push_back(p);
+    }
+
+    // freeing every other block leaves the heap fragmented, nothing bigger can fit
+    for (auto i = std::size_t{0}; i < blocks.size(); i += 2) {
+      heap.deallocate(blocks[i], 200);
+    }
+
+    EXPECT_EQ(heap.allocate(1000), nullptr);
+
+    // once the rest are freed, everything merges back into one block
+    for (auto i = std::size_t{1}; i < blocks.size(); i += 2) {
+      heap.deallocate(blocks[i], 200);
+    }
+
+    auto* big = heap.allocate(60 * 1024);
+
+    ASSERT_NE(big, nullptr);
+    EXPECT_TRUE(in_region(big, 60 * 1024, region));
+  }
+
+  TEST(FrtCoreAllocatorsTLSF, Alignment) {
+    auto region = std::vector<unsigned char>(64 * 1024);
+    frt::TLSFHeap heap{region.data() + 3, region.size() - 3};
+
+    for (auto align = frt::usize{1}; align <= 4096; align *= 2) {
+      auto* p = heap.allocate(24, align);
+
+      ASSERT_NE(p, nullptr);
+      EXPECT_TRUE(is_aligned(p, align));
+      EXPECT_TRUE(in_region(p, 24, region));
+    }
+  }
+
+  TEST(FrtCoreAllocatorsTLSF, MixedSizes) {
+    auto region = std::vector<unsigned char>(1024 * 1024);
+    frt::TLSFHeap heap{region.data(), region.size()};
+
+    allocation_churn(
+        20000,
+        [&heap, &region](std::mt19937& rng) {
+          auto size = churn_size(rng);
+          auto align = frt::usize{1} << (rng() % 8);
+          auto* p = static_cast<unsigned char*>(heap.allocate(size, align));
+
+          if (p != nullptr) {
+            EXPECT_TRUE(in_region(p, size, region));
+            EXPECT_GE(frt::TLSFHeap::usable_size(p), size);
+          }
+
+          return ChurnBlock{p, size, align};
+        },
+        [&heap](ChurnBlock block) {
+          heap.deallocate(block.ptr, block.size);
+        });
+
+    // with everything freed, it's all one block again
+    EXPECT_NE(heap.allocate(1000 * 1024), nullptr);
+  }
+
+  TEST(FrtCoreAllocatorsTLSF, SplitThreshold) {
+    constexpr auto word = sizeof(void*);
+    constexpr auto free_block = 4 * word; // the smallest block that can be split off and put on a free list
+    constexpr auto size = frt::usize{128};
+
+    auto region = std::vector<unsigned char>(4096);
+    frt::TLSFHeap heap{region.data(), region.size()};
+
+    // small blocks are binned exactly, so this leaves a free block of exactly `size` bytes
+    auto* block = static_cast<unsigned char*>(heap.allocate(size));
+    auto* guard = heap.allocate(size);
+
+    ASSERT_NE(block, nullptr);
+    ASSERT_NE(guard, nullptr);
+    heap.deallocate(block, size);
+
+    // a remainder that's exactly big enough is split off, and can be allocated
+    ASSERT_EQ(heap.allocate(size - free_block), block);
+    EXPECT_EQ(frt::TLSFHeap::usable_size(block), size - free_block);
+
+    auto* rest = heap.allocate(1);
+
+    EXPECT_EQ(rest, block + size - free_block + word);
+
+    heap.deallocate(rest, 1);
+    heap.deallocate(block, size - free_block);
+
+    // anything smaller stays part of the block
+    ASSERT_EQ(heap.allocate(size - free_block + word), block);
+    EXPECT_EQ(frt::TLSFHeap::usable_size(block), size);
+  }
+
+  TEST(FrtCoreAllocatorsTLSF, AlignedGapTooSmall) {
+    constexpr auto word = sizeof(void*);
+    constexpr auto align = frt::usize{256};
+
+    auto region = std::vector<unsigned char>(64 * 1024);
+    auto* start = region.data() + (align - reinterpret_cast<std::uintptr_t>(region.data()) % align);
+    frt::TLSFHeap heap{start, region.size() - align};
+
+    // leaves the free block's payload one word short of an aligned address, too close to split off the gap
+    auto* first = heap.allocate(align - 3 * word);
+
+    ASSERT_EQ(first, start + word);
+
+    auto* aligned = heap.allocate(64, align);
+
+    // the payload is pushed to the next aligned address, so the gap can be a free block of its own
+    EXPECT_EQ(aligned, start + 2 * align);
+
+    auto* gap = heap.allocate(align - 7 * word);
+
+    EXPECT_EQ(gap, start + align - word);
+    EXPECT_EQ(frt::TLSFHeap::usable_size(gap), align - 7 * word);
+  }
+
+#if defined(FRT_OS_LINUX)
+  TEST(FrtCoreAllocatorsTLSF, ClampsToMaxBlockSize) {
+    constexpr auto bytes = frt::TLSFHeap::max_block_size + (frt::usize{1} << 20);
+
+    // only the pages that the heap touches are ever backed by memory
+    auto* region = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+    ASSERT_NE(region, MAP_FAILED);
+
+    {
+      frt::TLSFHeap heap{region, bytes};
+
+      EXPECT_EQ(heap.allocate(frt::TLSFHeap::max_block_size), nullptr);
+
+      // the heap only uses the first `max_block_size` bytes, so only that many chunks (minus overhead) fit
+      constexpr auto chunk = frt::TLSFHeap::max_block_size / 16;
+      auto* end = static_cast<unsigned char*>(region) + frt::TLSFHeap::max_block_size;
+      auto count = 0;
+
+      while (auto* p = static_cast<unsigned char*>(heap.allocate(chunk))) {
+        EXPECT_LE(p + chunk, end);
+        ++count;
+      }
+
+      EXPECT_EQ(count, 15);
+    }
+
+    ::munmap(region, bytes);
+  }
+#endif
+
+  TEST(FrtCoreAllocatorsTLSF, Allocator) {
+    auto region = std::vector<unsigned char>(4096);
+    frt::TLSFHeap heap{region.data(), region.size()};
+    auto ints = frt::TLSFAllocator<int>{heap};
+    auto doubles = frt::AllocatorTraits<decltype(ints)>::rebind_alloc<double>{ints};
+
+    auto* i = ints.allocate(10);
+    auto* d = doubles.allocate(3);
+
+    EXPECT_TRUE(is_aligned(i, alignof(int)));
+    EXPECT_TRUE(is_aligned(d, alignof(double)));
+    EXPECT_EQ(ints, decltype(ints){heap});
+
+    ints.deallocate(i, 10);
+    doubles.deallocate(d, 3);
+  }
+} // namespace
@@ -0,0 +1,201 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "frt/core/bump_alloc.h"
+#include "test_allocators.h"
+#include "gtest/gtest.h"
+#include <cstring>
+
+namespace {
+  using Arena = frt::BumpAllocator<CountingAllocator<int>>;
+
+  TEST(FrtCoreBumpAlloc, AllocatesLazily) {
+    auto before = counts;
+
+    {
+      auto arena = Arena{};
+
+      EXPECT_EQ(arena.chunk_count(), 0);
+      EXPECT_EQ(counts.live_allocations, before.live_allocations);
+
+      auto* p = arena.allocate(0);
+
+      EXPECT_NE(p, nullptr);
+      EXPECT_EQ(arena.chunk_count(), 1);
+    }
+
+    EXPECT_EQ(counts.live_allocations, before.live_allocations);
+    EXPECT_EQ(counts.live_bytes, before.live_bytes);
+  }
+
+  TEST(FrtCoreBumpAlloc, AlignmentAndDisjointness) {
+    auto arena = Arena{256};
+    unsigned char* previous_end = nullptr;
+
+    for (auto i = frt::usize{0}; i < 1000; ++i) {
+      auto size = (i * 7) % 61 + 1;
+      auto align = frt::usize{1} << (i % 7);
+      auto* p = static_cast<unsigned char*>(arena.allocate(size, align));
+
+      ASSERT_NE(p, nullptr);
+      EXPECT_TRUE(is_aligned(p, align));
+
+      // allocations within a chunk never overlap with the one before them
+      if (previous_end != nullptr && p > previous_end - size) {
+        EXPECT_GE(p, previous_end);
+      }
+
+      std::memset(p, static_cast<int>(i), size);
+      previous_end = p + size;
+    }
+
+    auto* values = arena.allocate<double>(3);
+
+    EXPECT_TRUE(is_aligned(values, alignof(double)));
+    EXPECT_EQ(arena.allocate<double>(~frt::usize{0}), nullptr);
+  }
+
+  TEST(FrtCoreBumpAlloc, GeometricGrowth) {
+    auto arena = Arena{1024};
+
+    for (auto i = 0; i < 64; ++i) {
+      ASSERT_NE(arena.allocate(1000, 8), nullptr);
+    }
+
+    // 64 * 1000 bytes in chunks of 1k, 2k, 4k, ... only needs a handful of chunks
+    EXPECT_LE(arena.chunk_count(), 8);
+    EXPECT_GE(arena.capacity(), 64 * 1000);
+
+    // oversized allocations get a chunk big enough to fit them
+    auto* big = arena.allocate(1 << 20, 64);
+
+    ASSERT_NE(big, nullptr);
+    EXPECT_TRUE(is_aligned(big, 64));
+    std::memset(big, 0xFF, 1 << 20);
+  }
+
+  TEST(FrtCoreBumpAlloc, ResetKeepsNewestChunk) {
+    auto before = counts;
+    auto arena = Arena{512};
+
+    for (auto i = 0; i < 100; ++i) {
+      ASSERT_NE(arena.allocate(100), nullptr);
+    }
+
+    EXPECT_GT(arena.chunk_count(), 1);
+
+    auto total = counts.total_allocations;
+
+    arena.reset();
+
+    EXPECT_EQ(arena.chunk_count(), 1);
+    EXPECT_EQ(counts.live_allocations, before.live_allocations + 1);
+
+    // the kept chunk is the biggest one, so it's reused without going back to `A`
+    for (auto i = 0; i < 50; ++i) {
+      ASSERT_NE(arena.allocate(100), nullptr);
+    }
+
+    EXPECT_EQ(arena.chunk_count(), 1);
+    EXPECT_EQ(counts.total_allocations, total);
+  }
+
+  TEST(FrtCoreBumpAlloc, ResetCyclesStopAllocating) {
+    auto arena = Arena{256};
+
+    auto cycle = [&arena] {
+      for (auto i = 0; i < 10; ++i) {
+        ASSERT_NE(arena.allocate(1000), nullptr);
+      }
+
+      arena.reset();
+    };
+
+    for (auto i = 0; i < 4; ++i) {
+      cycle();
+    }
+
+    auto total = counts.total_allocations;
+    auto capacity = arena.capacity();
+
+    for (auto i = 0; i < 100; ++i) {
+      cycle();
+    }
+
+    // after warming up, every cycle is served from the one kept chunk
+    EXPECT_EQ(counts.total_allocations, total);
+    EXPECT_EQ(arena.capacity(), capacity);
+    EXPECT_EQ(arena.chunk_count(), 1);
+  }
+
+  TEST(FrtCoreBumpAlloc, MarkAndRewind) {
+    auto arena = Arena{512};
+    auto* a = arena.allocate(32);
+    auto marker = arena.mark();
+    auto chunks = arena.chunk_count();
+    auto* b = arena.allocate(32);
+
+    for (auto i = 0; i < 100; ++i) {
+      ASSERT_NE(arena.allocate(100), nullptr);
+    }
+
+    arena.rewind(marker);
+
+    EXPECT_EQ(arena.chunk_count(), chunks);
+    EXPECT_EQ(arena.allocate(32), b);
+    EXPECT_NE(a, b);
+
+    // a marker from before the first chunk rewinds to the very beginning
+    auto empty = Arena{};
+    auto start = empty.mark();
+    auto* c = empty.allocate(8);
+
+    empty.rewind(start);
+    EXPECT_EQ(empty.allocate(8), c);
+  }
+
+  TEST(FrtCoreBumpAlloc, DeallocateLast) {
+    auto arena = Arena{};
+    auto* a = arena.allocate(24, 8);
+    auto* b = arena.allocate(24, 8);
+
+    arena.deallocate(a, 24); // not the last, nothing happens
+    EXPECT_NE(arena.allocate(8, 8), a);
+
+    auto* c = arena.allocate(24, 8);
+
+    arena.deallocate(c, 24);
+    EXPECT_EQ(arena.allocate(24, 8), c);
+    EXPECT_NE(b, c);
+  }
+
+  TEST(FrtCoreBumpAlloc, Move) {
+    auto before = counts;
+
+    {
+      auto arena = Arena{};
+      auto* p = static_cast<int*>(arena.allocate(sizeof(int), alignof(int)));
+
+      *p = 5;
+
+      auto other = Arena{frt::move(arena)};
+
+      EXPECT_EQ(arena.chunk_count(), 0); // NOLINT(bugprone-use-after-move)
+      EXPECT_EQ(other.chunk_count(), 1);
+      EXPECT_EQ(*p, 5);
+
+      arena = frt::move(other);
+
+      EXPECT_EQ(arena.chunk_count(), 1);
+    }
+
+    EXPECT_EQ(counts.live_allocations, before.live_allocations);
+  }
+} // namespace
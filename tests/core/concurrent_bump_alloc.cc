@@ -0,0 +1,149 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "frt/core/allocators/alloc_ref.h"
+#include "frt/core/concurrent_bump_alloc.h"
+#include "test_allocators.h"
+#include "gtest/gtest.h"
+#include <thread>
+#include <vector>
+
+namespace {
+  using Arena = frt::ConcurrentBumpAllocator<SharedAllocator<int>>;
+
+  static_assert(frt::internal::ByteResource<Arena>);
+  static_assert(frt::Allocator<frt::AllocRef<Arena, int>>);
+
+  TEST(FrtCoreConcurrentBumpAlloc, AllocatesLazily) {
+    {
+      auto arena = Arena{};
+
+      EXPECT_EQ(arena.chunk_count(), 0);
+      EXPECT_EQ(shared_live_blocks.load(), 0);
+      EXPECT_NE(arena.allocate(0), nullptr);
+      EXPECT_EQ(arena.chunk_count(), 1);
+      EXPECT_EQ(arena.capacity(), Arena::default_chunk_size);
+    }
+
+    EXPECT_EQ(shared_live_blocks.load(), 0);
+  }
+
+  TEST(FrtCoreConcurrentBumpAlloc, AlignmentAndGrowth) {
+    auto arena = Arena{256};
+    auto* previous = static_cast<unsigned char*>(nullptr);
+
+    for (auto i = frt::usize{0}; i < 1000; ++i) {
+      auto size = (i * 7) % 61 + 1;
+      auto align = frt::usize{1} << (i % 8);
+      auto* p = static_cast<unsigned char*>(arena.allocate(size, align));
+
+      ASSERT_NE(p, nullptr);
+      EXPECT_TRUE(is_aligned(p, align));
+      EXPECT_TRUE(is_aligned(p, Arena::default_alignment));
+      EXPECT_NE(p, previous);
+
+      previous = p;
+    }
+
+    // chunks double, so 1000 small allocations only need a handful
+    EXPECT_GT(arena.chunk_count(), 1);
+    EXPECT_LT(arena.chunk_count(), 10);
+
+    auto* ints = arena.allocate<int>(4);
+
+    EXPECT_TRUE(is_aligned(ints, alignof(int)));
+  }
+
+  TEST(FrtCoreConcurrentBumpAlloc, OversizedKeepsCurrentChunk) {
+    auto arena = Arena{};
+    auto* first = static_cast<unsigned char*>(arena.allocate(16));
+    auto* huge = arena.allocate(1 << 20, 4096);
+
+    ASSERT_NE(huge, nullptr);
+    EXPECT_TRUE(is_aligned(huge, 4096));
+    EXPECT_EQ(arena.chunk_count(), 2);
+
+    // the small chunk is still the current one
+    EXPECT_EQ(arena.allocate(16), first + 16);
+
+    arena.reset();
+
+    EXPECT_EQ(arena.chunk_count(), 1);
+    EXPECT_EQ(shared_live_blocks.load(), 1);
+    EXPECT_EQ(arena.allocate(16), first);
+    EXPECT_EQ(arena.allocate(~frt::usize{0}), nullptr);
+  }
+
+  TEST(FrtCoreConcurrentBumpAlloc, ResetKeepsNewestChunk) {
+    auto arena = Arena{256};
+
+    for (auto i = 0; i < 100; ++i) {
+      ASSERT_NE(arena.allocate(64), nullptr);
+    }
+
+    auto chunks = arena.chunk_count();
+
+    arena.reset();
+
+    EXPECT_EQ(arena.chunk_count(), 1);
+    EXPECT_EQ(shared_live_blocks.load(), 1);
+
+    // the biggest chunk was kept, so the same allocations fit without any new ones
+    for (auto i = 0; i < 20; ++i) {
+      ASSERT_NE(arena.allocate(64), nullptr);
+    }
+
+    EXPECT_EQ(arena.chunk_count(), 1);
+    EXPECT_GT(chunks, 1);
+  }
+
+  TEST(FrtCoreConcurrentBumpAlloc, ThreadsGetDisjointMemory) {
+    constexpr auto thread_count = 8;
+    constexpr auto per_thread = 20000;
+
+    auto arena = Arena{256};
+    auto blocks = std::vector<std::vector<frt::usize*>>(thread_count);
+    auto threads = std::vector<std::thread>{};
+
+    for (auto t = 0; t < thread_count; ++t) {
+      threads.emplace_back([&arena, &blocks, t] {
+        for (auto i = 0; i < per_thread; ++i) {
+          auto count = static_cast<frt::usize>(i % 5 + 1);
+          auto* block = arena.allocate<frt::usize>(count);
+
+          ASSERT_NE(block, nullptr);
+
+          for (auto j = frt::usize{0}; j < count; ++j) {
+            block[j] = static_cast<frt::usize>(t * per_thread + i);
+          }
+
+          blocks[static_cast<frt::usize>(t)].push_back(block);
+        }
+      });
+    }
+
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    // if any two blocks overlapped, one of them would have been overwritten
+    for (auto t = 0; t < thread_count; ++t) {
+      for (auto i = 0; i < per_thread; ++i) {
+        auto* block = blocks[static_cast<frt::usize>(t)][static_cast<frt::usize>(i)];
+
+        for (auto j = 0; j < i % 5 + 1; ++j) {
+          ASSERT_EQ(block[j], static_cast<frt::usize>(t * per_thread + i));
+        }
+      }
+    }
+
+    EXPECT_EQ(shared_live_blocks.load(), static_cast<frt::isize>(arena.chunk_count()));
+  }
+} // namespace
@@ -0,0 +1,381 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "frt/core/memory.h"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace {
+  // every size up to a few blocks past the medium size class, and then a handful of sizes
+  // that are big enough to hit the large loop / `rep movsb` paths
+  std::vector<std::size_t> test_sizes() {
+    auto sizes = std::vector<std::size_t>{};
+
+    for (auto i = std::size_t{0}; i <= 300; ++i) {
+      sizes.push_back(i);
+    }
+
+    for (auto i : {511, 512, 513, 1000, 2047, 2048, 2049, 4096, 4111, 65536 + 7}) {
+      sizes.push_back(static_cast<std::size_t>(i));
+    }
+
+    return sizes;
+  }
+
+  // fills a buffer with a pattern that won't repeat at any power-of-two period we care about
+  void fill_pattern(std::vector<unsigned char>& buffer, unsigned seed) {
+    for (auto i = std::size_t{0}; i < buffer.size(); ++i) {
+      buffer[i] = static_cast<unsigned char>((i * 7 + seed) % 251);
+    }
+  }
+
+  TEST(FrtCoreMemory, MemCopy) {
+    constexpr auto padding = std::size_t{64};
+
+    for (auto size : test_sizes()) {
+      for (auto dst_offset : {0, 1, 7, 16, 31}) {
+        for (auto src_offset : {0, 3, 8, 17}) {
+          auto src = std::vector<unsigned char>(size + padding * 2);
+          auto dst = std::vector<unsigned char>(size + padding * 2);
+          fill_pattern(src, 1);
+          fill_pattern(dst, 2);
+
+          auto expected = dst;
+
+          for (auto i = std::size_t{0}; i < size; ++i) {
+            expected[padding + dst_offset + i] = src[padding + src_offset + i];
+          }
+
+          auto* result = frt::__frt_mem_copy(dst.data() + padding + dst_offset, src.data() + padding + src_offset, size);
+
+          ASSERT_EQ(result, dst.data() + padding + dst_offset);
+          ASSERT_EQ(dst, expected) << "size = " << size << ", dst_offset = " << dst_offset
+                                   << ", src_offset = " << src_offset;
+        }
+      }
+    }
+  }
+
+  TEST(FrtCoreMemory, MemMove) {
+    constexpr auto padding = std::size_t{64};
+
+    for (auto size : test_sizes()) {
+      // negative shifts move towards the start of the buffer, positive towards the end. the
+      // small shifts force overlap, the shift past `size` is the non-overlapping case
+      for (auto shift : {-33, -17, -8, -1, 0, 1, 5, 32, 100}) {
+        auto buffer = std::vector<unsigned char>(size + padding * 4);
+        fill_pattern(buffer, 3);
+
+        auto src_index = padding * 2;
+        auto dst_index = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(src_index) + shift);
+        auto expected = buffer;
+
+        for (auto i = std::size_t{0}; i < size; ++i) {
+          expected[dst_index + i] = buffer[src_index + i];
+        }
+
+        auto* result = frt::__frt_mem_move(buffer.data() + dst_index, buffer.data() + src_index, size);
+
+        ASSERT_EQ(result, buffer.data() + dst_index);
+        ASSERT_EQ(buffer, expected) << "size = " << size << ", shift = " << shift;
+      }
+    }
+  }
+
+  TEST(FrtCoreMemory, MemSet) {
+    constexpr auto padding = std::size_t{64};
+
+    auto sizes = test_sizes();
+    sizes.push_back(std::size_t{8} << 20); // past the default streaming threshold
+
+    for (auto size : sizes) {
+      for (auto offset : {0, 1, 9, 31}) {
+        auto buffer = std::vector<unsigned char>(size + padding * 2);
+        fill_pattern(buffer, 4);
+
+        auto expected = buffer;
+
+        for (auto i = std::size_t{0}; i < size; ++i) {
+          expected[padding + offset + i] = 0xAB;
+        }
+
+        auto* result = frt::__frt_mem_set(buffer.data() + padding + offset, 0xAB, size);
+
+        ASSERT_EQ(result, buffer.data() + padding + offset);
+        ASSERT_EQ(buffer, expected) << "size = " << size << ", offset = " << offset;
+      }
+    }
+  }
+
+  TEST(FrtCoreMemory, MemStream) {
+    constexpr auto padding = std::size_t{64};
+
+    auto sizes = test_sizes();
+    sizes.push_back(std::size_t{1} << 20);
+
+    for (auto size : sizes) {
+      for (auto offset : {0, 5, 32}) {
+        auto src = std::vector<unsigned char>(size + padding * 2);
+        auto dst = std::vector<unsigned char>(size + padding * 2);
+        fill_pattern(src, 10);
+        fill_pattern(dst, 11);
+
+        auto expected = dst;
+        std::copy(src.begin() + padding, src.begin() + padding + size, expected.begin() + padding + offset);
+
+        auto* result = frt::mem_copy_stream(dst.data() + padding + offset, src.data() + padding, size);
+
+        ASSERT_EQ(result, dst.data() + padding + offset);
+        ASSERT_EQ(dst, expected) << "size = " << size << ", offset = " << offset;
+
+        std::fill(expected.begin() + padding + offset, expected.begin() + padding + offset + size, 0x3C);
+
+        result = frt::mem_set_stream(dst.data() + padding + offset, 0x3C, size);
+
+        ASSERT_EQ(result, dst.data() + padding + offset);
+        ASSERT_EQ(dst, expected) << "size = " << size << ", offset = " << offset;
+      }
+    }
+  }
+
+  int reference_compare(const unsigned char* lhs, const unsigned char* rhs, std::size_t size) {
+    for (auto i = std::size_t{0}; i < size; ++i) {
+      if (lhs[i] != rhs[i]) {
+        return (lhs[i] < rhs[i]) ? -1 : 1;
+      }
+    }
+
+    return 0;
+  }
+
+  int sign(int value) {
+    return (value > 0) - (value < 0);
+  }
+
+  TEST(FrtCoreMemory, MemCompare) {
+    for (auto size : test_sizes()) {
+      auto lhs = std::vector<unsigned char>(size + 1);
+      fill_pattern(lhs, 5);
+
+      auto rhs = lhs;
+
+      EXPECT_EQ(frt::__frt_mem_compare(lhs.data() + 1, rhs.data() + 1, size), 0) << "size = " << size;
+      EXPECT_TRUE(frt::__frt_mem_equal(lhs.data() + 1, rhs.data() + 1, size)) << "size = " << size;
+
+      // walk a single differing byte across the whole range, in both directions. the
+      // differences are chosen so the first different byte disagrees with later ones
+      for (auto i = std::size_t{0}; i < size; i += (size > 300) ? 37 : 1) {
+        for (auto delta : {1, 255}) {
+          auto changed = rhs;
+          changed[i + 1] = static_cast<unsigned char>(changed[i + 1] + delta);
+
+          if (i + 1 < size) {
+            changed[size] = static_cast<unsigned char>(changed[size] - delta);
+          }
+
+          auto expected = reference_compare(lhs.data() + 1, changed.data() + 1, size);
+
+          ASSERT_EQ(sign(frt::__frt_mem_compare(lhs.data() + 1, changed.data() + 1, size)), expected)
+              << "size = " << size << ", i = " << i;
+          ASSERT_EQ(sign(frt::__frt_mem_compare(changed.data() + 1, lhs.data() + 1, size)), -expected)
+              << "size = " << size << ", i = " << i;
+          ASSERT_FALSE(frt::__frt_mem_equal(lhs.data() + 1, changed.data() + 1, size))
+              << "size = " << size << ", i = " << i;
+        }
+      }
+    }
+  }
+  // these go through the inline kernels for small sizes with `FRT_INLINE_MEM_INTRINS`, and are
+  // just wrappers around the libc names otherwise. they should behave the same either way
+  TEST(FrtCoreMemory, Wrappers) {
+    for (auto size : test_sizes()) {
+      auto src = std::vector<unsigned char>(size + 8);
+      auto dst = std::vector<unsigned char>(size + 8);
+      fill_pattern(src, 6);
+      fill_pattern(dst, 7);
+
+      auto length = static_cast<frt::isize>(size);
+
+      EXPECT_EQ(frt::mem_copy(dst.data() + 1, src.data() + 3, length), dst.data() + 1);
+      EXPECT_TRUE(std::equal(dst.begin() + 1, dst.begin() + 1 + length, src.begin() + 3)) << "size = " << size;
+      EXPECT_EQ(frt::mem_compare(dst.data() + 1, src.data() + 3, length), 0) << "size = " << size;
+      EXPECT_TRUE(frt::mem_equal(dst.data() + 1, src.data() + 3, length)) << "size = " << size;
+
+      if (size != 0) {
+        dst[size] = static_cast<unsigned char>(dst[size] + 1);
+
+        EXPECT_GT(frt::mem_compare(dst.data() + 1, src.data() + 3, length), 0) << "size = " << size;
+        EXPECT_FALSE(frt::mem_equal(dst.data() + 1, src.data() + 3, length)) << "size = " << size;
+      }
+
+      auto expected = src;
+
+      for (auto i = std::size_t{0}; i < size; ++i) {
+        expected[i + 4] = src[i + 1];
+      }
+
+      EXPECT_EQ(frt::mem_move(src.data() + 4, src.data() + 1, length), src.data() + 4);
+      EXPECT_EQ(src, expected) << "size = " << size;
+
+      EXPECT_EQ(frt::mem_set(dst.data(), 0x5A, length), dst.data());
+      EXPECT_EQ(std::count(dst.begin(), dst.begin() + length, 0x5A), length) << "size = " << size;
+    }
+  }
+
+  template <std::size_t N> void check_fixed_size() {
+    constexpr auto padding = std::size_t{40};
+
+    auto src = std::vector<unsigned char>(N + padding * 2);
+    auto dst = std::vector<unsigned char>(N + padding * 2);
+    fill_pattern(src, 8);
+    fill_pattern(dst, 9);
+
+    auto expected = dst;
+    std::copy(src.begin() + padding + 1, src.begin() + padding + 1 + N, expected.begin() + padding);
+
+    EXPECT_EQ(frt::mem_copy<N>(dst.data() + padding, src.data() + padding + 1), dst.data() + padding);
+    EXPECT_EQ(dst, expected) << "N = " << N;
+    EXPECT_EQ((frt::mem_compare<N>(dst.data() + padding, src.data() + padding + 1)), 0) << "N = " << N;
+    EXPECT_TRUE((frt::mem_equal<N>(dst.data() + padding, src.data() + padding + 1))) << "N = " << N;
+
+    if constexpr (N != 0) {
+      dst[padding + N - 1] = static_cast<unsigned char>(dst[padding + N - 1] - 1);
+
+      EXPECT_LT((frt::mem_compare<N>(dst.data() + padding, src.data() + padding + 1)), 0) << "N = " << N;
+      EXPECT_FALSE((frt::mem_equal<N>(dst.data() + padding, src.data() + padding + 1))) << "N = " << N;
+    }
+
+    // overlapping in both directions
+    for (auto shift : {-33, -1, 1, 7, 32}) {
+      auto buffer = src;
+      auto from = padding;
+      auto to = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(padding) + shift);
+      auto moved = buffer;
+      std::copy(buffer.begin() + from, buffer.begin() + from + N, moved.begin() + to);
+
+      EXPECT_EQ(frt::mem_move<N>(buffer.data() + to, buffer.data() + from), buffer.data() + to);
+      EXPECT_EQ(buffer, moved) << "N = " << N << ", shift = " << shift;
+    }
+
+    auto set = dst;
+    std::fill(set.begin() + 3, set.begin() + 3 + N, 0xC3);
+
+    EXPECT_EQ(frt::mem_set<N>(dst.data() + 3, 0xC3), dst.data() + 3);
+    EXPECT_EQ(dst, set) << "N = " << N;
+
+    // `void*` is the most common way these get called, and can't be evaluated elementwise
+    void* raw = dst.data() + padding;
+    const void* raw_src = src.data() + padding;
+
+    EXPECT_EQ(frt::mem_copy<N>(raw, raw_src), raw);
+    EXPECT_EQ(frt::mem_move<N>(raw, raw_src), raw);
+    EXPECT_EQ((frt::mem_compare<N>(static_cast<const void*>(raw), raw_src)), 0) << "N = " << N;
+    EXPECT_TRUE((frt::mem_equal<N>(static_cast<const void*>(raw), raw_src))) << "N = " << N;
+    EXPECT_EQ(frt::mem_set<N>(raw, 0xC3), raw);
+    EXPECT_EQ(std::count(dst.begin() + padding, dst.begin() + padding + N, 0xC3), static_cast<std::ptrdiff_t>(N)) << "N = " << N;
+  }
+
+  template <std::size_t... Ns> void check_fixed_sizes() {
+    (check_fixed_size<Ns>(), ...);
+  }
+
+  TEST(FrtCoreMemory, FixedSize) {
+    check_fixed_sizes<0, 1, 2, 3, 4, 5, 7, 8, 12, 16, 17, 24, 31, 32, 33, 48, 63, 64, 65, 100, 128, 255, 256, 257, 1000>();
+  }
+
+  constexpr bool fixed_size_constexpr() {
+    char a[8] = {'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h'};
+    char b[8] = {};
+
+    frt::mem_copy<8>(b, a);
+    frt::mem_move<6>(b + 2, b);
+    frt::mem_set<2>(b, 'z');
+
+    return frt::mem_compare<8>(b, "zzabcdef") == 0 && frt::mem_equal<4>(a, "abcd") && frt::mem_compare<1>(a, b) < 0;
+  }
+
+  static_assert(fixed_size_constexpr());
+
+  TEST(FrtCoreMemory, MemFindByte) {
+    for (auto size : test_sizes()) {
+      auto buffer = std::vector<unsigned char>(size + 2, 0x11);
+      auto* data = buffer.data() + 1;
+      auto length = static_cast<frt::isize>(size);
+
+      // the padding on both sides is the byte being searched for, so reading past the range would find it
+      buffer.front() = 0xEE;
+      buffer.back() = 0xEE;
+
+      EXPECT_EQ(frt::mem_find_byte(data, 0xEE, length), nullptr) << "size = " << size;
+      EXPECT_EQ(frt::mem_rfind_byte(data, 0xEE, length), nullptr) << "size = " << size;
+      EXPECT_EQ(frt::mem_count_byte(data, 0xEE, length), 0) << "size = " << size;
+      EXPECT_EQ(frt::mem_count_byte(data, 0x11, length), length) << "size = " << size;
+
+      for (auto i = std::size_t{0}; i < size; i += (size > 300) ? 29 : 1) {
+        data[i] = 0xEE;
+
+        EXPECT_EQ(frt::mem_find_byte(data, 0xEE, length), data + i) << "size = " << size << ", i = " << i;
+        EXPECT_EQ(frt::mem_rfind_byte(data, 0xEE, length), data + i) << "size = " << size << ", i = " << i;
+        EXPECT_EQ(frt::mem_count_byte(data, 0xEE, length), 1) << "size = " << size << ", i = " << i;
+
+        // a second match after the first one shouldn't change `find`, only `rfind`
+        if (i + 1 < size) {
+          data[size - 1] = 0xEE;
+
+          EXPECT_EQ(frt::mem_find_byte(data, 0xEE, length), data + i) << "size = " << size << ", i = " << i;
+          EXPECT_EQ(frt::mem_rfind_byte(data, 0xEE, length), data + size - 1) << "size = " << size << ", i = " << i;
+          EXPECT_EQ(frt::mem_count_byte(data, 0xEE, length), 2) << "size = " << size << ", i = " << i;
+
+          data[size - 1] = 0x11;
+        }
+
+        data[i] = 0x11;
+      }
+    }
+  }
+
+  TEST(FrtCoreMemory, MemFindAnyOf) {
+    const unsigned char small_set[] = {'\n', '\r', ',', '"'};
+    auto large_set = std::vector<unsigned char>{};
+
+    for (auto i = 0; i < 40; ++i) {
+      large_set.push_back(static_cast<unsigned char>(0x80 + i * 3));
+    }
+
+    for (auto size : test_sizes()) {
+      auto buffer = std::vector<unsigned char>(size, 'a');
+      auto length = static_cast<frt::isize>(size);
+
+      EXPECT_EQ(frt::mem_find_any_of(buffer.data(), length, small_set, 4), nullptr) << "size = " << size;
+      EXPECT_EQ(frt::mem_find_any_of(buffer.data(), length, large_set.data(), 40), nullptr) << "size = " << size;
+      EXPECT_EQ(frt::mem_find_any_of(buffer.data(), length, small_set, 0), nullptr) << "size = " << size;
+
+      for (auto i = std::size_t{0}; i < size; i += (size > 300) ? 31 : 1) {
+        buffer[i] = small_set[i % 4];
+
+        if (i + 1 < size) {
+          buffer[size - 1] = small_set[(i + 1) % 4];
+        }
+
+        EXPECT_EQ(frt::mem_find_any_of(buffer.data(), length, small_set, 4), buffer.data() + i)
+            << "size = " << size << ", i = " << i;
+
+        buffer[i] = large_set[i % 40];
+
+        EXPECT_EQ(frt::mem_find_any_of(buffer.data(), length, large_set.data(), 40), buffer.data() + i)
+            << "size = " << size << ", i = " << i;
+
+        std::fill(buffer.begin(), buffer.end(), 'a');
+      }
+    }
+  }
+} // namespace
@@ -0,0 +1,57 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "frt/platform/cache.h"
+#include "gtest/gtest.h"
+
+namespace {
+  constexpr bool is_power_of_two(frt::usize value) {
+    return value != 0 && (value & (value - 1)) == 0;
+  }
+
+  static_assert(is_power_of_two(frt::cache_line_size));
+  static_assert(is_power_of_two(frt::hardware_destructive_interference_size));
+  static_assert(is_power_of_two(frt::hardware_constructive_interference_size));
+  static_assert(frt::hardware_destructive_interference_size >= frt::cache_line_size);
+
+  TEST(FrtPlatformCache, PrefetchNeverFaults) {
+    auto value = 5;
+
+    frt::prefetch_read(&value);
+    frt::prefetch_read<frt::Locality::none>(&value);
+    frt::prefetch_write<frt::Locality::low>(&value);
+
+    // prefetches are only hints, they're allowed to point anywhere
+    frt::prefetch_read(nullptr);
+    frt::prefetch_write<frt::Locality::moderate>(reinterpret_cast<const void*>(0x10));
+
+    EXPECT_EQ(value, 5);
+  }
+
+  TEST(FrtPlatformCache, FlushKeepsContents) {
+    alignas(frt::cache_line_size) int values[64] = {};
+
+    for (auto i = 0; i < 64; ++i) {
+      values[i] = i * 3;
+    }
+
+    for (auto i = 0; i < 64; i += 16) {
+      frt::cache_line_writeback(values + i);
+    }
+
+    frt::cache_line_flush(values);
+    frt::cache_line_flush(values + 32);
+    frt::cache_line_fence();
+
+    for (auto i = 0; i < 64; ++i) {
+      EXPECT_EQ(values[i], i * 3);
+    }
+  }
+} // namespace
@@ -0,0 +1,51 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#include "frt/platform/cpu.h"
+#include "gtest/gtest.h"
+
+namespace {
+  TEST(FrtPlatformCPU, FeatureSet) {
+    auto features = frt::CPUFeatures{};
+
+    EXPECT_FALSE(features.has(frt::CPUFeature::x86_avx2));
+
+    features.add(frt::CPUFeature::x86_avx2);
+    features.add(frt::CPUFeature::arm64_mops);
+
+    EXPECT_TRUE(features.has(frt::CPUFeature::x86_avx2));
+    EXPECT_TRUE(features.has(frt::CPUFeature::arm64_mops));
+    EXPECT_FALSE(features.has(frt::CPUFeature::x86_erms));
+    EXPECT_EQ(frt::CPUFeatures{features.bits()}.bits(), features.bits());
+  }
+
+  TEST(FrtPlatformCPU, DetectionIsCached) {
+    EXPECT_EQ(frt::cpu_features().bits(), frt::detect_cpu_features().bits());
+    EXPECT_EQ(frt::cpu_features().bits(), frt::cpu_features().bits());
+  }
+
+#if defined(FRT_ARCH_X86_64)
+  TEST(FrtPlatformCPU, MatchesCompilerDetection) {
+    auto features = frt::cpu_features();
+
+    // the compiler runtime does its own `cpuid`/`xgetbv` checks, we should agree with it
+    EXPECT_EQ(features.has(frt::CPUFeature::x86_sse42), __builtin_cpu_supports("sse4.2") != 0);
+    EXPECT_EQ(features.has(frt::CPUFeature::x86_popcnt), __builtin_cpu_supports("popcnt") != 0);
+    EXPECT_EQ(features.has(frt::CPUFeature::x86_avx), __builtin_cpu_supports("avx") != 0);
+    EXPECT_EQ(features.has(frt::CPUFeature::x86_avx2), __builtin_cpu_supports("avx2") != 0);
+    EXPECT_EQ(features.has(frt::CPUFeature::x86_bmi2), __builtin_cpu_supports("bmi2") != 0);
+    EXPECT_EQ(features.has(frt::CPUFeature::x86_avx512f), __builtin_cpu_supports("avx512f") != 0);
+  }
+#elif defined(FRT_ARCH_ARM64)
+  TEST(FrtPlatformCPU, HasNeon) {
+    EXPECT_TRUE(frt::cpu_features().has(frt::CPUFeature::arm64_neon));
+  }
+#endif
+} // namespace
@@ -0,0 +1,196 @@
+//======---------------------------------------------------------------======//
+//                                                                           //
+// Copyright 2021-2022 Evan Cox <evanacox00@gmail.com>. All rights reserved. //
+//                                                                           //
+// Use of this source code is governed by a BSD-style license that can be    //
+// found in the LICENSE.txt file at the root of this project, or at the      //
+// following link: https://opensource.org/licenses/BSD-3-Clause              //
+//                                                                           //
+//======---------------------------------------------------------------======//
+
+#pragma once
+
+#include "frt/core/allocator.h"
+#include "frt/platform/macros.h"
+#include "frt/sync/atomic.h"
+#include "frt/types/basic.h"
+#include "gtest/gtest.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <random>
+
+/// Checks if `ptr` is aligned to `align`
+inline bool is_aligned(const void* ptr, frt::usize align) {
+  return reinterpret_cast<std::uintptr_t>(ptr) % align == 0;
+}
+
+/// Live allocation statistics for every `CountingAllocator` specialization
+struct AllocationCounts {
+  frt::isize live_allocations = 0;
+  frt::isize live_bytes = 0;
+  frt::isize total_allocations = 0;
+};
+
+inline AllocationCounts counts; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+/// `malloc`-backed allocator that keeps track of what's live in `counts`
+template <typename T> struct CountingAllocator { // NOLINT(fuchsia-trailing-return)
+  using value_type = T;
+
+  CountingAllocator() = default;
+
+  template <typename U> explicit CountingAllocator(const CountingAllocator<U>& /*unused*/) noexcept {}
+
+  [[nodiscard]] T* allocate(frt::isize n) noexcept {
+    ++counts.live_allocations;
+    ++counts.total_allocations;
+    counts.live_bytes += n * static_cast<frt::isize>(sizeof(T));
+
+    return static_cast<T*>(std::malloc(static_cast<frt::usize>(n) * sizeof(T)));
+  }
+
+  // kept out of line: once inlined into a fallback path, GCC can't see that `ptr` never points into the
+  // stack allocator's arena and warns about `free`ing it (-Wfree-nonheap-object)
+  FRT_NEVER_INLINE void deallocate(T* ptr, frt::isize n) noexcept {
+    --counts.live_allocations;
+    counts.live_bytes -= n * static_cast<frt::isize>(sizeof(T));
+
+    std::free(ptr);
+  }
+
+  friend bool operator==(const CountingAllocator&, const CountingAllocator&) = default;
+};
+
+static_assert(frt::Allocator<CountingAllocator<int>>);
+
+/// Live block count for every `SharedAllocator` specialization
+inline frt::Atomic<frt::isize> shared_live_blocks{0}; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+/// `malloc`-backed allocator that can be used from any number of threads at once. `CountingAllocator`
+/// isn't thread-safe, so this only keeps an atomic count of live blocks in `shared_live_blocks`
+template <typename T> struct SharedAllocator {
+  using value_type = T;
+
+  SharedAllocator() = default;
+
+  template <typename U> explicit SharedAllocator(const SharedAllocator<U>& /*unused*/) noexcept {}
+
+  [[nodiscard]] T* allocate(frt::isize n) noexcept {
+    shared_live_blocks.fetch_add(1);
+
+    return static_cast<T*>(std::malloc(static_cast<frt::usize>(n) * sizeof(T)));
+  }
+
+  void deallocate(T* ptr, frt::isize /*unused*/) noexcept {
+    shared_live_blocks.fetch_sub(1);
+
+    std::free(ptr);
+  }
+
+  friend bool operator==(const SharedAllocator&, const SharedAllocator&) = default;
+};
+
+static_assert(frt::Allocator<SharedAllocator<int>>);
+
+/// Allocator that always returns `nullptr`, for testing how failures are handled. Unlike
+/// `frt::FailingAllocator`, this doesn't call `__frt_tried_alloc`
+template <typename T> struct NullAllocator {
+  using value_type = T;
+
+  NullAllocator() = default;
+
+  template <typename U> explicit NullAllocator(const NullAllocator<U>& /*unused*/) noexcept {}
+
+  [[nodiscard]] T* allocate(frt::isize /*unused*/) noexcept {
+    return nullptr;
+  }
+
+  void deallocate(T* /*unused*/, frt::isize /*unused*/) noexcept {}
+
+  friend bool operator==(const NullAllocator&, const NullAllocator&) = default;
+};
+
+static_assert(frt::Allocator<NullAllocator<int>>);
+
+/// `aligned_alloc`-backed page source that keeps track of how many pages are live across every instance
+struct TestPageSource {
+  inline static constexpr frt::usize page_size = 4096;
+
+  inline static frt::isize live_pages = 0; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+  [[nodiscard]] void* allocate_pages(frt::usize count) noexcept {
+    live_pages += static_cast<frt::isize>(count);
+
+    return std::aligned_alloc(page_size, count * page_size);
+  }
+
+  void deallocate_pages(void* pages, frt::usize count) noexcept {
+    live_pages -= static_cast<frt::isize>(count);
+
+    std::free(pages);
+  }
+};
+
+/// A block handed out during `allocation_churn`
+struct ChurnBlock {
+  unsigned char* ptr;
+  frt::usize size;
+  frt::usize align;
+};
+
+/// The mix of sizes `allocation_churn` usually uses: mostly small blocks, with the occasional big one
+inline frt::usize churn_size(std::mt19937& rng) {
+  return frt::usize{1} + rng() % (rng() % 8 == 0 ? 10000 : 300);
+}
+
+/// Randomly allocates and frees blocks `iterations` times, to shake out bookkeeping bugs. `allocate(rng)`
+/// makes a new block (a null `ptr` means the allocator is out of memory), and `deallocate(block)` frees one.
+///
+/// Each block is filled with a random byte that's checked right before it's freed, so overlapping blocks
+/// get caught. Everything still live at the end is freed too.
+///
+/// \param iterations The number of allocations and frees
+/// \param allocate Makes a `ChurnBlock`
+/// \param deallocate Frees a `ChurnBlock`
+template <typename Allocate, typename Deallocate>
+void allocation_churn(int iterations, Allocate allocate, Deallocate deallocate) {
+  auto live = std::map<unsigned char*, std::pair<ChurnBlock, unsigned char>>{};
+  auto rng = std::mt19937{1234};
+
+  for (auto i = 0; i < iterations; ++i) {
+    if (!live.empty() && rng() % 2 == 0) {
+      auto it = live.begin();
+
+      std::advance(it, static_cast<long>(rng() % live.size()));
+
+      auto [block, fill] = it->second;
+
+      for (auto j = frt::usize{0}; j < block.size; ++j) {
+        ASSERT_EQ(block.ptr[j], fill);
+      }
+
+      deallocate(block);
+      live.erase(it);
+    } else {
+      auto block = allocate(rng);
+      auto fill = static_cast<unsigned char>(rng());
+
+      if (block.ptr == nullptr) {
+        continue;
+      }
+
+      ASSERT_TRUE(is_aligned(block.ptr, block.align));
+      ASSERT_EQ(live.count(block.ptr), 0);
+
+      std::memset(block.ptr, fill, block.size);
+      live.emplace(block.ptr, std::pair{block, fill});
+    }
+  }
+
+  for (auto& [ptr, entry] : live) {
+    deallocate(entry.first);
+  }
+}